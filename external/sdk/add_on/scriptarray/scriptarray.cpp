@@ -28,6 +28,55 @@ void CScriptArray::SetMemoryFunctions(asALLOCFUNC_t allocFunc, asFREEFUNC_t free
 	userFree = freeFunc;
 }
 
+// Per-thread write range, see SetScriptArrayWriteRange
+struct SArrayWriteRange
+{
+	bool   active;
+	asUINT begin;
+	asUINT end;
+	// Arrays created while the range is active get this id, they are private to the job and not restricted
+	int    job;
+};
+
+static thread_local SArrayWriteRange g_writeRange;
+static int g_lastWriteRangeJob = 0;
+
+void SetScriptArrayWriteRange(asUINT begin, asUINT end)
+{
+	g_writeRange.active = true;
+	g_writeRange.begin = begin;
+	g_writeRange.end = end;
+	// Unique across threads, 0 is reserved for arrays created outside of jobs
+	g_writeRange.job = asAtomicInc(g_lastWriteRangeJob);
+	if( g_writeRange.job == 0 )
+		g_writeRange.job = asAtomicInc(g_lastWriteRangeJob);
+}
+
+void ClearScriptArrayWriteRange()
+{
+	g_writeRange.active = false;
+}
+
+static int GetWriteRangeJob()
+{
+	return g_writeRange.active ? g_writeRange.job : 0;
+}
+
+// Returns false and raises a script exception if [begin, end) may not be modified on this thread
+static bool CheckWriteRange(int job, asUINT begin, asUINT end)
+{
+	if( !g_writeRange.active || job == g_writeRange.job )
+		return true;
+
+	if( begin >= g_writeRange.begin && end <= g_writeRange.end && begin < end )
+		return true;
+
+	asIScriptContext *ctx = asGetActiveContext();
+	if( ctx )
+		ctx->SetException("Array modified outside of the parallel job range");
+	return false;
+}
+
 static void RegisterScriptArray_Native(asIScriptEngine *engine);
 static void RegisterScriptArray_Generic(asIScriptEngine *engine);
 
@@ -357,6 +406,9 @@ static void RegisterScriptArray_Native(asIScriptEngine *engine)
 
 CScriptArray &CScriptArray::operator=(const CScriptArray &other)
 {
+	if( !CheckWriteRange(writeRangeJob, 0, 0xFFFFFFFF) )
+		return *this;
+
 	// Only perform the copy if the array types are the same
 	if( &other != this &&
 		other.GetArrayObjectType() == GetArrayObjectType() )
@@ -373,6 +425,8 @@ CScriptArray &CScriptArray::operator=(const CScriptArray &other)
 
 CScriptArray::CScriptArray(asITypeInfo *ti, void *buf)
 {
+	writeRangeJob = GetWriteRangeJob();
+
 	// The object type should be the template instance of the array
 	assert( ti && string(ti->GetName()) == "array" );
 
@@ -466,6 +520,8 @@ CScriptArray::CScriptArray(asITypeInfo *ti, void *buf)
 
 CScriptArray::CScriptArray(asUINT length, asITypeInfo *ti)
 {
+	writeRangeJob = GetWriteRangeJob();
+
 	// The object type should be the template instance of the array
 	assert( ti && string(ti->GetName()) == "array" );
 
@@ -499,6 +555,8 @@ CScriptArray::CScriptArray(asUINT length, asITypeInfo *ti)
 
 CScriptArray::CScriptArray(const CScriptArray &other)
 {
+	writeRangeJob = GetWriteRangeJob();
+
 	refCount = 1;
 	gcFlag = false;
 	objType = other.objType;
@@ -520,6 +578,8 @@ CScriptArray::CScriptArray(const CScriptArray &other)
 
 CScriptArray::CScriptArray(asUINT length, void *defVal, asITypeInfo *ti)
 {
+	writeRangeJob = GetWriteRangeJob();
+
 	// The object type should be the template instance of the array
 	assert( ti && string(ti->GetName()) == "array" );
 
@@ -644,6 +704,9 @@ void CScriptArray::Reserve(asUINT maxElements)
 	if( maxElements <= buffer->maxElements )
 		return;
 
+	if( !CheckWriteRange(writeRangeJob, 0, 0xFFFFFFFF) )
+		return;
+
 	if( !CheckMaxSize(maxElements) )
 		return;
 
@@ -686,6 +749,9 @@ void CScriptArray::RemoveRange(asUINT start, asUINT count)
 	if (count == 0)
 		return;
 
+	if( !CheckWriteRange(writeRangeJob, 0, 0xFFFFFFFF) )
+		return;
+
 	if( buffer == 0 || start > buffer->numElements )
 	{
 		// If this is called from a script we raise a script exception
@@ -712,6 +778,9 @@ void CScriptArray::RemoveRange(asUINT start, asUINT count)
 // Internal
 void CScriptArray::Resize(int delta, asUINT at)
 {
+	if( !CheckWriteRange(writeRangeJob, 0, 0xFFFFFFFF) )
+		return;
+
 	if( delta < 0 )
 	{
 		if( -delta > (int)buffer->numElements )
@@ -936,6 +1005,9 @@ const void *CScriptArray::At(asUINT index) const
 }
 void *CScriptArray::At(asUINT index)
 {
+	if( !CheckWriteRange(writeRangeJob, index, index + 1) )
+		return 0;
+
 	return const_cast<void*>(const_cast<const CScriptArray *>(this)->At(index));
 }
 
@@ -1068,6 +1140,9 @@ void CScriptArray::Reverse()
 {
 	asUINT size = GetSize();
 
+	if( size >= 2 && !CheckWriteRange(writeRangeJob, 0, size) )
+		return;
+
 	if( size >= 2 )
 	{
 		asBYTE TEMP[16];
@@ -1430,6 +1505,9 @@ void CScriptArray::SortDesc(asUINT startAt, asUINT count)
 // internal
 void CScriptArray::Sort(asUINT startAt, asUINT count, bool asc)
 {
+	if( count >= 2 && !CheckWriteRange(writeRangeJob, startAt, startAt + count) )
+		return;
+
 	// Subtype isn't primitive and doesn't have opCmp
 	SArrayCache *cache = reinterpret_cast<SArrayCache*>(objType->GetUserData(ARRAY_CACHE));
 	if( subTypeId & ~asTYPEID_MASK_SEQNBR )
@@ -1589,6 +1667,9 @@ void CScriptArray::Sort(asIScriptFunction *func, asUINT startAt, asUINT count)
 	if (count < 2)
 		return;
 
+	if( !CheckWriteRange(writeRangeJob, startAt, startAt + count) )
+		return;
+
 	// Check if we could access invalid item while sorting
 	asUINT start = startAt;
 	asUINT end = asQWORD(startAt) + asQWORD(count) >= (asQWORD(1)<<32) ? 0xFFFFFFFF : startAt + count;
@@ -112,6 +112,7 @@ protected:
 	SArrayBuffer   *buffer;
 	int             elementSize;
 	int             subTypeId;
+	int             writeRangeJob;
 
 	// Constructors
 	CScriptArray(asITypeInfo *ot, void *initBuf); // Called from script when initialized with list
@@ -138,6 +139,11 @@ protected:
 
 void RegisterScriptArray(asIScriptEngine *engine, bool defaultArray);
 
+// Restricts, on the calling thread, modifications of arrays that existed before the call to
+// elements in [begin, end). Used by the host to run range-partitioned parallel jobs.
+void SetScriptArrayWriteRange(asUINT begin, asUINT end);
+void ClearScriptArrayWriteRange();
+
 END_AS_NAMESPACE
 
 #endif
@@ -414,6 +414,17 @@ typedef void (*asCLEANSCRIPTOBJECTFUNC_t)(asIScriptObject *);
 typedef asIScriptContext *(*asREQUESTCONTEXTFUNC_t)(asIScriptEngine *, void *);
 typedef void (*asRETURNCONTEXTFUNC_t)(asIScriptEngine *, asIScriptContext *, void *);
 typedef void (*asCIRCULARREFFUNC_t)(asITypeInfo *, const void *, void *);
+// Called when the execution quota of a context runs out, returning false aborts the execution
+typedef bool (*asQUOTACALLBACKFUNC_t)(asIScriptContext *ctx, void *param);
+// Called with begin = true when a script calls a script function and with begin = false when the function returns or
+// is unwound by an exception, see asSetScriptCallHook
+typedef void (*asSCRIPTCALLHOOKFUNC_t)(asIScriptContext *ctx, asIScriptFunction *func, bool begin, void *param);
+// Called by the thread executing a script after a sample was requested, see asSetSampleHook
+typedef void (*asSAMPLEHOOKFUNC_t)(asIScriptContext *ctx, void *param);
+#ifdef AS_NATIVE_CALL_HOOK
+// Called with begin = true before and begin = false after every call of a registered application function
+typedef void (*asNATIVECALLHOOKFUNC_t)(asIScriptFunction *func, asIScriptContext *ctx, bool begin, void *param);
+#endif
 
 struct asSVMRegisters;
 typedef void (*asJITFunction)(asSVMRegisters* registers, asPWORD jitArg);
@@ -583,9 +594,24 @@ extern "C"
 	AS_API int   asResetGlobalMemoryFunctions();
 	AS_API void *asAllocMem(size_t size);
 	AS_API void  asFreeMem(void *mem);
+	// Allocation of script class instances made by script code, freed with the global free function.
+	// It may return null, the script gets an out of memory exception. A null function restores the default.
+	AS_API int   asSetScriptObjectAllocFunction(asALLOCFUNC_t allocFunc);
 
 	// Auxiliary
 	AS_API asILockableSharedBool *asCreateLockableSharedBool();
+
+	// Sampling profilers. Every executing context checks *request at script calls, returns and backward jumps and
+	// calls the hook with its registers stored, so the callstack can be read. The hook clears the request.
+	// A null hook disables it.
+	AS_API void asSetSampleHook(asSAMPLEHOOKFUNC_t hook, void *param, volatile int *request);
+	// Script call tracing, the function a context is prepared with is not reported. A null hook disables it.
+	AS_API void asSetScriptCallHook(asSCRIPTCALLHOOKFUNC_t hook, void *param);
+
+#ifdef AS_NATIVE_CALL_HOOK
+	// Native call tracing, a null hook disables it
+	AS_API void asSetNativeCallHook(asNATIVECALLHOOKFUNC_t hook, void *param);
+#endif
 }
 #endif // ANGELSCRIPT_DLL_MANUAL_IMPORT
 
@@ -947,6 +973,14 @@ public:
 	// Debugging
 	virtual int                SetLineCallback(asSFuncPtr callback, void *obj, int callConv) = 0;
 	virtual void               ClearLineCallback() = 0;
+	// Execution quota, script calls and backward jumps are counted and the callback is called after every
+	// `ticks` of them. The count restarts in each Execute(). Zero ticks disables the quota.
+	virtual int                SetQuotaCallback(asQUOTACALLBACKFUNC_t callback, void *param, asUINT ticks) = 0;
+	// Profiling, executed bytecode instructions and calls of script functions since the context was created
+	virtual asQWORD            GetExecutedInstructionCount() const = 0;
+	virtual asQWORD            GetScriptCallCount() const = 0;
+	// Bytes of all stack blocks, the stack grows as needed and is freed only with the context
+	virtual asUINT             GetStackMemorySize() const = 0;
 	virtual asUINT             GetCallstackSize() const = 0;
 	virtual asIScriptFunction *GetFunction(asUINT stackLevel = 0) = 0;
 	virtual int                GetLineNumber(asUINT stackLevel = 0, int *column = 0, const char **sectionName = 0) = 0;
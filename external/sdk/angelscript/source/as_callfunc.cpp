@@ -554,6 +554,33 @@ int PrepareSystemFunction(asCScriptFunction *func, asSSystemFunctionInterface *i
 	return 0;
 }
 
+#ifdef AS_NATIVE_CALL_HOOK
+
+// All calls of application functions go through CallSystemFunction, so the hook wraps it.
+// The implementations below are renamed to CallSystemFunctionUnhooked.
+int CallSystemFunctionUnhooked(int id, asCContext *context);
+
+static asNATIVECALLHOOKFUNC_t g_nativeCallHook      = 0;
+static void                  *g_nativeCallHookParam = 0;
+
+int CallSystemFunction(int id, asCContext *context)
+{
+	asNATIVECALLHOOKFUNC_t hook = g_nativeCallHook;
+	if( hook == 0 )
+		return CallSystemFunctionUnhooked(id, context);
+
+	asCScriptFunction *func = context->m_engine->scriptFunctions[id];
+	void *param = g_nativeCallHookParam;
+	hook(func, context, true, param);
+	int popSize = CallSystemFunctionUnhooked(id, context);
+	hook(func, context, false, param);
+	return popSize;
+}
+
+#define CallSystemFunction CallSystemFunctionUnhooked
+
+#endif // AS_NATIVE_CALL_HOOK
+
 #ifdef AS_MAX_PORTABILITY
 
 int CallSystemFunction(int id, asCContext *context)
@@ -947,5 +974,18 @@ int CallSystemFunction(int id, asCContext *context)
 
 #endif // AS_MAX_PORTABILITY
 
+#ifdef AS_NATIVE_CALL_HOOK
+
+#undef CallSystemFunction
+
+// Interface
+AS_API void asSetNativeCallHook(asNATIVECALLHOOKFUNC_t hook, void *param)
+{
+	g_nativeCallHookParam = param;
+	g_nativeCallHook      = hook;
+}
+
+#endif // AS_NATIVE_CALL_HOOK
+
 END_AS_NAMESPACE
 
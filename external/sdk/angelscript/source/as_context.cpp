@@ -195,6 +195,12 @@ asCContext::asCContext(asCScriptEngine *engine, bool holdRef)
 	m_initialFunction           = 0;
 	m_lineCallback              = false;
 	m_exceptionCallback         = false;
+	m_quotaCallback             = 0;
+	m_quotaParam                = 0;
+	m_quotaTicks                = 0;
+	m_quotaCountdown            = 0;
+	m_instructionCount          = 0;
+	m_scriptCallCount           = 0;
 	m_regs.doProcessSuspend     = false;
 	m_doSuspend                 = false;
 	m_exceptionWillBeCaught     = false;
@@ -1493,6 +1499,10 @@ int asCContext::Execute()
 	if( m_engine->ep.autoGarbageCollect )
 		m_engine->gc.GetStatistics(&gcPreObjects, 0, 0, 0, 0);
 
+	// A nested execution continues the quota of the outer one when it returns
+	asUINT outerQuotaCountdown = m_quotaCountdown;
+	m_quotaCountdown = m_quotaTicks ? m_quotaTicks : asUINT(-1);
+
 	while (m_status == asEXECUTION_ACTIVE)
 	{
 		ExecuteNext();
@@ -1531,6 +1541,8 @@ int asCContext::Execute()
 		}
 	}
 
+	m_quotaCountdown = outerQuotaCountdown;
+
 	// Pop the active context
 	asPopActiveContext(tld, this);
 
@@ -1830,8 +1842,17 @@ int asCContext::PushCallState()
 }
 
 // internal
+// See asSetScriptCallHook
+static asSCRIPTCALLHOOKFUNC_t g_scriptCallHook      = 0;
+static void                  *g_scriptCallHookParam = 0;
+
 void asCContext::PopCallState()
 {
+	// PopState restores the caller of a nested execution after Unprepare, without a current function
+	asSCRIPTCALLHOOKFUNC_t hook = g_scriptCallHook;
+	if( hook && m_currentFunction )
+		hook(this, m_currentFunction, false, g_scriptCallHookParam);
+
 	// See comments in PushCallState about pointer aliasing and data cache trashing
 	asUINT newLength = m_callStack.GetLength() - CALLSTACK_FRAME_SIZE;
 
@@ -2055,6 +2076,11 @@ void asCContext::CallScriptFunction(asCScriptFunction *func)
 	// so the exception handler will know what to do if there is a stack overflow
 	m_currentFunction = func;
 	m_regs.programPointer = m_currentFunction->scriptData->byteCode.AddressOf();
+	m_scriptCallCount++;
+
+	asSCRIPTCALLHOOKFUNC_t hook = g_scriptCallHook;
+	if( hook )
+		hook(this, func, true, g_scriptCallHookParam);
 
 	PrepareScriptFunction();
 }
@@ -2194,16 +2220,56 @@ void asCContext::CallInterfaceMethod(asCScriptFunction *func)
 #define asUSE_COMPUTED_GOTOS 0
 #endif
 
+// Instructions are counted as they are dispatched, the first one at the top of the loop
 #if asUSE_COMPUTED_GOTOS
 #define INSTRUCTION(x) case_##x
-#define NEXT_INSTRUCTION() goto *dispatch_table[*(asBYTE*)l_bc]
-#define BEGIN() NEXT_INSTRUCTION();
+#define NEXT_INSTRUCTION() { m_instructionCount++; goto *dispatch_table[*(asBYTE*)l_bc]; }
+#define BEGIN() goto *dispatch_table[*(asBYTE*)l_bc];
 #else
 #define INSTRUCTION(x) case x
 #define NEXT_INSTRUCTION() break
 #define BEGIN() switch( *(asBYTE*)l_bc )
 #endif
 
+// Sample requests, see asSetSampleHook. Without a hook the request points to a flag that is never set.
+static volatile int        g_noSampleRequest = 0;
+static volatile int       *g_sampleRequest   = &g_noSampleRequest;
+static asSAMPLEHOOKFUNC_t  g_sampleHook      = 0;
+static void               *g_sampleHookParam = 0;
+
+// Lets the sample hook read the callstack at the current instruction
+#define SAMPLE_POINT() \
+	if( *g_sampleRequest ) \
+	{ \
+		m_regs.programPointer    = l_bc; \
+		m_regs.stackPointer      = l_sp; \
+		m_regs.stackFramePointer = l_fp; \
+		CallSampleHook(); \
+	}
+
+// Counts a call or a backward jump against the execution quota, leaves ExecuteNext if it was aborted
+#define QUOTA_TICK() \
+	{ \
+		if( --m_quotaCountdown == 0 ) \
+		{ \
+			m_regs.programPointer    = l_bc; \
+			m_regs.stackPointer      = l_sp; \
+			m_regs.stackFramePointer = l_fp; \
+			if( !ContinueAfterQuota() ) \
+				return; \
+		} \
+		SAMPLE_POINT() \
+	}
+
+// Relative jump, backward ones close loops and are counted
+#define QUOTA_JUMP() \
+	{ \
+		int offset = asBC_INTARG(l_bc); \
+		l_bc += offset + 2; \
+		if( offset < 0 ) \
+			QUOTA_TICK() \
+	}
+
 void asCContext::ExecuteNext()
 {
 #if asUSE_COMPUTED_GOTOS
@@ -2283,6 +2349,7 @@ static const void *const dispatch_table[256] = {
 
 	for(;;)
 	{
+	m_instructionCount++;
 
 #ifdef AS_DEBUG
 	// Gather statistics on executed bytecode
@@ -2389,6 +2456,7 @@ static const void *const dispatch_table[256] = {
 
 	// Begin execution of a script function
 	INSTRUCTION(asBC_CALL):
+		QUOTA_TICK()
 		{
 			int i = asBC_INTARG(l_bc);
 			l_bc += 2;
@@ -2416,6 +2484,7 @@ static const void *const dispatch_table[256] = {
 
 	// Return to the caller, and remove the arguments from the stack
 	INSTRUCTION(asBC_RET):
+		SAMPLE_POINT()
 		{
 			// Return if this was the first function, or a nested execution
 			if( m_callStack.GetLength() == 0 ||
@@ -2442,7 +2511,7 @@ static const void *const dispatch_table[256] = {
 
 	// Jump to a relative position
 	INSTRUCTION(asBC_JMP):
-		l_bc += 2 + asBC_INTARG(l_bc);
+		QUOTA_JUMP()
 		NEXT_INSTRUCTION();
 
 //----------------
@@ -2451,7 +2520,7 @@ static const void *const dispatch_table[256] = {
 	// Jump to a relative position if the value in the register is 0
 	INSTRUCTION(asBC_JZ):
 		if( *(int*)&m_regs.valueRegister == 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -2459,7 +2528,7 @@ static const void *const dispatch_table[256] = {
 	// Jump to a relative position if the value in the register is not 0
 	INSTRUCTION(asBC_JNZ):
 		if( *(int*)&m_regs.valueRegister != 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -2467,7 +2536,7 @@ static const void *const dispatch_table[256] = {
 	// Jump to a relative position if the value in the register is negative
 	INSTRUCTION(asBC_JS):
 		if( *(int*)&m_regs.valueRegister < 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -2475,7 +2544,7 @@ static const void *const dispatch_table[256] = {
 	// Jump to a relative position if the value in the register it not negative
 	INSTRUCTION(asBC_JNS):
 		if( *(int*)&m_regs.valueRegister >= 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -2483,7 +2552,7 @@ static const void *const dispatch_table[256] = {
 	// Jump to a relative position if the value in the register is greater than 0
 	INSTRUCTION(asBC_JP):
 		if( *(int*)&m_regs.valueRegister > 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -2491,7 +2560,7 @@ static const void *const dispatch_table[256] = {
 	// Jump to a relative position if the value in the register is not greater than 0
 	INSTRUCTION(asBC_JNP):
 		if( *(int*)&m_regs.valueRegister <= 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -2965,6 +3034,7 @@ static const void *const dispatch_table[256] = {
 		NEXT_INSTRUCTION();
 
 	INSTRUCTION(asBC_CALLSYS):
+		SAMPLE_POINT()
 		{
 			// Get function ID from the argument
 			int i = asBC_INTARG(l_bc);
@@ -3006,6 +3076,7 @@ static const void *const dispatch_table[256] = {
 		NEXT_INSTRUCTION();
 
 	INSTRUCTION(asBC_CALLBND):
+		SAMPLE_POINT()
 		{
 			// TODO: Clean-up: This code is very similar to asBC_CallPtr. Create a shared method for them
 			// Get the function ID from the stack
@@ -3108,7 +3179,18 @@ static const void *const dispatch_table[256] = {
 				m_regs.stackFramePointer = l_fp;
 
 				// Pre-allocate the memory
-				asDWORD *mem = (asDWORD*)m_engine->CallAlloc(objType);
+				asDWORD *mem = (asDWORD*)m_engine->CallAllocScriptObject(objType);
+				if( mem == 0 )
+				{
+					// Push a null object pointer so the constructor arguments can be cleaned up
+					m_regs.stackPointer -= AS_PTR_SIZE;
+					*(asPWORD*)m_regs.stackPointer = 0;
+					m_regs.programPointer += 2+AS_PTR_SIZE;
+
+					m_needToCleanupArgs = true;
+					SetInternalException(TXT_OUT_OF_MEMORY);
+					return;
+				}
 
 				// Pre-initialize the memory by calling the constructor for asCScriptObject
 				ScriptObject_Construct(objType, (asCScriptObject*)mem);
@@ -3872,6 +3954,7 @@ static const void *const dispatch_table[256] = {
 		NEXT_INSTRUCTION();
 
 	INSTRUCTION(asBC_CALLINTF):
+		QUOTA_TICK()
 		{
 			int i = asBC_INTARG(l_bc);
 			l_bc += 2;
@@ -4288,6 +4371,7 @@ static const void *const dispatch_table[256] = {
 		NEXT_INSTRUCTION();
 
 	INSTRUCTION(asBC_CallPtr):
+		QUOTA_TICK()
 		{
 			// Get the function pointer from the local variable
 			asCScriptFunction *func = *(asCScriptFunction**)(l_fp - asBC_SWORDARG0(l_bc));
@@ -4576,14 +4660,14 @@ static const void *const dispatch_table[256] = {
 
 	INSTRUCTION(asBC_JLowZ):
 		if( *(asBYTE*)&m_regs.valueRegister == 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
 
 	INSTRUCTION(asBC_JLowNZ):
 		if( *(asBYTE*)&m_regs.valueRegister != 0 )
-			l_bc += asBC_INTARG(l_bc) + 2;
+			QUOTA_JUMP()
 		else
 			l_bc += 2;
 		NEXT_INSTRUCTION();
@@ -5323,6 +5407,12 @@ void asCContext::CleanArgsOnStack()
 		int funcId = asBC_INTARG(prevInstr);
 		func = m_engine->importedFunctions[funcId & ~FUNC_IMPORTED]->importedFunctionSignature;
 	}
+	else if( bc == asBC_ALLOC )
+	{
+		// Constructor of a script object whose allocation failed, the object pointer was pushed as null
+		int funcId = asBC_INTARG(prevInstr+AS_PTR_SIZE);
+		func = m_engine->scriptFunctions[funcId];
+	}
 	else if( bc == asBC_CallPtr )
 	{
 		asUINT v;
@@ -5777,6 +5867,79 @@ void asCContext::ClearLineCallback()
 	m_regs.doProcessSuspend = m_doSuspend;
 }
 
+// interface
+int asCContext::SetQuotaCallback(asQUOTACALLBACKFUNC_t callback, void *param, asUINT ticks)
+{
+	m_quotaCallback = ticks ? callback : 0;
+	m_quotaParam    = param;
+	m_quotaTicks    = ticks;
+	return 0;
+}
+
+// internal
+// Called by ExecuteNext when m_quotaCountdown reaches zero, the registers must be stored in m_regs
+bool asCContext::ContinueAfterQuota()
+{
+	if( m_quotaTicks == 0 || m_quotaCallback == 0 || m_quotaCallback(this, m_quotaParam) )
+	{
+		m_quotaCountdown = m_quotaTicks ? m_quotaTicks : asUINT(-1);
+		return true;
+	}
+
+	m_doAbort = true;
+	m_status = asEXECUTION_ABORTED;
+	return false;
+}
+
+// interface
+asQWORD asCContext::GetExecutedInstructionCount() const
+{
+	return m_instructionCount;
+}
+
+// interface
+asQWORD asCContext::GetScriptCallCount() const
+{
+	return m_scriptCallCount;
+}
+
+// interface
+asUINT asCContext::GetStackMemorySize() const
+{
+	// block n holds m_stackBlockSize << n dwords
+	asUINT size = 0;
+	for( asUINT n = 0; n < m_stackBlocks.GetLength(); n++ )
+		size += (m_stackBlockSize << n) * sizeof(asDWORD);
+	return size;
+}
+
+// internal
+// Called by ExecuteNext when a sample was requested, the registers must be stored in m_regs
+void asCContext::CallSampleHook()
+{
+	asSAMPLEHOOKFUNC_t hook = g_sampleHook;
+	if( hook )
+		hook(this, g_sampleHookParam);
+}
+
+// Interface
+AS_API void asSetScriptCallHook(asSCRIPTCALLHOOKFUNC_t hook, void *param)
+{
+	g_scriptCallHookParam = param;
+	g_scriptCallHook      = hook;
+}
+
+// Interface
+AS_API void asSetSampleHook(asSAMPLEHOOKFUNC_t hook, void *param, volatile int *request)
+{
+	if( hook == 0 )
+		g_sampleRequest = &g_noSampleRequest;
+	g_sampleHookParam = param;
+	g_sampleHook      = hook;
+	if( hook )
+		g_sampleRequest = request ? request : &g_noSampleRequest;
+}
+
 // interface
 void asCContext::ClearExceptionCallback()
 {
@@ -110,6 +110,10 @@ public:
 	// Debugging
 	int                SetLineCallback(asSFuncPtr callback, void *obj, int callConv);
 	void               ClearLineCallback();
+	int                SetQuotaCallback(asQUOTACALLBACKFUNC_t callback, void *param, asUINT ticks);
+	asQWORD            GetExecutedInstructionCount() const;
+	asQWORD            GetScriptCallCount() const;
+	asUINT             GetStackMemorySize() const;
 	asUINT             GetCallstackSize() const;
 	asIScriptFunction *GetFunction(asUINT stackLevel);
 	int                GetLineNumber(asUINT stackLevel, int *column, const char **sectionName);
@@ -155,6 +159,8 @@ public:
 
 	void CallLineCallback();
 	void CallExceptionCallback();
+	bool ContinueAfterQuota();
+	void CallSampleHook();
 
 	int  CallGeneric(asCScriptFunction *func);
 #ifndef AS_NO_EXCEPTIONS
@@ -238,6 +244,16 @@ public:
 	asSSystemFunctionInterface m_exceptionCallbackFunc;
 	void *                     m_exceptionCallbackObj;
 
+	// Execution quota, m_quotaCountdown is decremented by calls and backward jumps
+	asQUOTACALLBACKFUNC_t      m_quotaCallback;
+	void *                     m_quotaParam;
+	asUINT                     m_quotaTicks;
+	asUINT                     m_quotaCountdown;
+
+	// Profiling counters, see GetExecutedInstructionCount
+	asQWORD                    m_instructionCount;
+	asQWORD                    m_scriptCallCount;
+
 	asCArray<asPWORD> m_userData;
 
 	// Registers available to JIT compiler functions
@@ -136,6 +136,8 @@ asFREEALIGNEDFUNC_t  userFreeAligned  = alignedFree;
 #endif
 #endif
 
+asALLOCFUNC_t userAllocScriptObject = 0;
+
 extern "C"
 {
 
@@ -179,6 +181,13 @@ void asFreeMem(void *mem)
 	asDELETEARRAY(mem);
 }
 
+// interface
+int asSetScriptObjectAllocFunction(asALLOCFUNC_t allocFunc)
+{
+	userAllocScriptObject = allocFunc;
+	return 0;
+}
+
 } // extern "C"
 
 asCMemoryMgr::asCMemoryMgr()
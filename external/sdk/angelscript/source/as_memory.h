@@ -47,6 +47,8 @@ BEGIN_AS_NAMESPACE
 
 extern asALLOCFUNC_t userAlloc;
 extern asFREEFUNC_t  userFree;
+// Null unless set with asSetScriptObjectAllocFunction
+extern asALLOCFUNC_t userAllocScriptObject;
 
 #ifdef WIP_16BYTE_ALIGN
 
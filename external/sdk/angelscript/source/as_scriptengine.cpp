@@ -4782,6 +4782,22 @@ void *asCScriptEngine::CallAlloc(const asCObjectType *type) const
 #endif
 }
 
+// internal
+// Script class instances created by script code, returns null if the application refuses the allocation
+void *asCScriptEngine::CallAllocScriptObject(const asCObjectType *type) const
+{
+#ifndef WIP_16BYTE_ALIGN
+	if( userAllocScriptObject )
+	{
+		asUINT size = type->size;
+		if( size & 0x3 )
+			size += 4 - (size & 0x3);
+		return userAllocScriptObject(size);
+	}
+#endif
+	return CallAlloc(type);
+}
+
 void asCScriptEngine::CallFree(void *obj) const
 {
 #ifndef WIP_16BYTE_ALIGN
@@ -225,6 +225,7 @@ public:
 	int VerifyVarTypeNotInFunction(asCScriptFunction *func);
 
 	void *CallAlloc(const asCObjectType *objType) const;
+	void *CallAllocScriptObject(const asCObjectType *objType) const;
 	void  CallFree(void *obj) const;
 
 	void *CallGlobalFunctionRetPtr(int func) const;
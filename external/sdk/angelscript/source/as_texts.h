@@ -371,6 +371,7 @@
 #define TXT_EXCEPTION_CAUGHT              "Caught an exception from the application"
 #define TXT_MISMATCH_IN_VALUE_ASSIGN      "Mismatching types in value assignment"
 #define TXT_TOO_MANY_NESTED_CALLS         "Too many nested calls"
+#define TXT_OUT_OF_MEMORY                 "Out of memory"
 
 // Error codes
 #define ERROR_NAME(x) #x
@@ -1,3 +1,8 @@
+newoption {
+	trigger = "angelscript-native-trace",
+	description = "Build AngelScript with the hook used to trace calls of registered native functions"
+}
+
 project "angelscript"
 	libType()
 	files { 
@@ -88,13 +93,18 @@ project "angelscript"
         "external/sdk/angelscript/source/as_typeinfo.h",
         "external/sdk/angelscript/source/as_variablescope.cpp",
         "external/sdk/angelscript/source/as_variablescope.h",
+        "external/sdk/add_on/scriptarray/scriptarray.cpp",
+        "external/sdk/add_on/scriptarray/scriptarray.h",
 		"src/**.c",
 		"src/**.cpp",
 		"src/**.h",
 		"genie.lua"
 	}
-    includedirs { "external/sdk/angelscript/include" }
+    includedirs { "external/sdk/angelscript/include", "external/sdk/add_on" }
 	defines { "BUILDING_ANGELSCRIPT", "ANGELSCRIPT_EXPORT", "AS_NO_EXCEPTIONS" }
+	if _OPTIONS["angelscript-native-trace"] then
+		defines { "AS_NATIVE_CALL_HOOK" }
+	end
 	links { "engine" }
 	defaultConfigurations()
     configuration "Debug"
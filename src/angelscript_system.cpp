@@ -1,863 +1,5007 @@
 #include "angelscript_system.h"
 #include "angelscript_wrapper.h"
+#include "as_bundle.h"
+#include "as_heap_snapshot.h"
+#include "as_memory.h"
+#include "as_network.h"
+#include "as_trace.h"
 #include "as_script.h"
 #include "core/allocator.h"
 #include "core/array.h"
 #include "core/associative_array.h"
+#include "core/atomic.h"
+#include "core/command_line_parser.h"
 #include "core/hash.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/os.h"
 #include "core/profiler.h"
 #include "core/stream.h"
 #include "core/string.h"
+#include "core/sync.h"
+#include "core/thread.h"
 #include "engine/engine.h"
+#include "engine/file_system.h"
 #include "engine/input_system.h"
 #include "engine/plugin.h"
 #include "engine/reflection.h"
 #include "engine/resource_manager.h"
 #include "engine/world.h"
 #include <angelscript.h>
+#include <scriptarray/scriptarray.h>
+#include <stdio.h>
 
 namespace Lumix
 {
 
 static const ComponentType ANGELSCRIPT_TYPE = reflection::getComponentType("angelscript");
 static const ComponentType ANGELSCRIPT_INLINE_TYPE = reflection::getComponentType("angelscript_inline");
+// memory of all inline scripts is reported under this name
+static const Path INLINE_SCRIPT_PATH("angelscript_inline");
 
-enum class AngelScriptModuleVersion : i32
+// asIScriptContext user data slots
+enum ContextUserData : asPWORD
 {
-	HASH64,
-	INLINE_SCRIPT,
-
-	LATEST
+	CONTEXT_SCRIPT_COMPONENT = 1,
+	// 1 + number of script calls open in a context run by executeProfiled, 0 if calls are not tracked
+	CONTEXT_PROFILER_DEPTH = 2,
+	// pooled context of parallel_for, runs on worker threads
+	CONTEXT_PARALLEL_JOB = 4,
+	// AngelScriptSystemImpl, set on contexts made by createContext() to track them
+	CONTEXT_SYSTEM = 5,
+	// ASMemoryTag of the script owning the context
+	CONTEXT_MEMORY_TAG = 6,
+	// ExecutionBudget of the running call, checked by the watchdog
+	CONTEXT_WATCHDOG = 7
 };
 
-struct ASScriptManager final : ResourceManager
+// asIScriptFunction user data slots
+enum FunctionUserData : asPWORD
 {
-	ASScriptManager(IAllocator& allocator)
-		: ResourceManager(allocator)
-		, m_allocator(allocator)
-	{
-	}
-
-	Resource* createResource(const Path& path) override
-	{
-		return LUMIX_NEW(m_allocator, ASScript)(path, *this, m_allocator);
-	}
+	FUNCTION_PARALLEL_SAFETY = 1,
+	FUNCTION_PROFILER_NAME = 2,
+	// index + 1 into m_function_stats
+	FUNCTION_STATS = 3
+};
 
-	void destroyResource(Resource& resource) override { LUMIX_DELETE(m_allocator, static_cast<ASScript*>(&resource)); }
+// asIScriptModule user data slots
+enum ModuleUserData : asPWORD
+{
+	// MessageHandlers of the module, freed with the module
+	MODULE_MESSAGE_HANDLERS = 1
+};
 
-	IAllocator& m_allocator;
+enum EngineUserData : asPWORD
+{
+	// AngelScriptSystem, used by the API
+	ENGINE_SYSTEM = 1,
+	// StringFactory owned by an engine made by createCompileEngine
+	ENGINE_STRING_FACTORY = 2
 };
 
-void messageCallback(const asSMessageInfo* msg, void* param)
+// Whether a function may run in a parallel_for job, cached in FUNCTION_PARALLEL_SAFETY
+enum class ParallelSafety : asPWORD
 {
-	const char* type = "Error";
-	if (msg->type == asMSGTYPE_WARNING)
-		type = "Warning";
-	else if (msg->type == asMSGTYPE_INFORMATION)
-		type = "Info";
+	UNKNOWN,
+	CHECKING,
+	SAFE,
+	UNSAFE
+};
 
-	logError("AngelScript ", type, " (", msg->row, ", ", msg->col, "): ", msg->message);
+static ParallelSafety getParallelSafety(asIScriptFunction* func)
+{
+	return (ParallelSafety)(asPWORD)func->GetUserData(FUNCTION_PARALLEL_SAFETY);
 }
 
-struct AngelScriptSystemImpl final : AngelScriptSystem
+static void setParallelSafety(asIScriptFunction* func, ParallelSafety safety)
 {
-	explicit AngelScriptSystemImpl(Engine& engine);
-	virtual ~AngelScriptSystemImpl();
-
-	void createModules(World& world) override;
-	const char* getName() const override { return "angelscript"; }
-	ASScriptManager& getScriptManager() { return m_script_manager; }
-	void serialize(OutputMemoryStream& stream) const override {}
-	bool deserialize(i32 version, InputMemoryStream& stream) override { return version == 0; }
-	asIScriptEngine* getEngine() override { return m_engine; }
+	func->SetUserData((void*)(asPWORD)safety, FUNCTION_PARALLEL_SAFETY);
+}
 
-	void update(float dt) override
+// Marks all methods and behaviours of a registered type as callable from parallel_for jobs
+static void markParallelSafe(asIScriptEngine* engine, const char* type_name)
+{
+	asITypeInfo* type = engine->GetTypeInfoByName(type_name);
+	ASSERT(type);
+	for (asUINT i = 0, c = type->GetMethodCount(); i < c; ++i)
 	{
-		// Update any timers, contexts, etc.
+		setParallelSafety(type->GetMethodByIndex(i), ParallelSafety::SAFE);
 	}
-
-	void unloadASResource(ASResourceHandle resource) override
+	for (asUINT i = 0, c = type->GetBehaviourCount(); i < c; ++i)
 	{
-		auto iter = m_as_resources.find(resource);
-		if (!iter.isValid()) return;
-		Resource* res = iter.value();
-		m_as_resources.erase(iter);
-		res->decRefCount();
+		setParallelSafety(type->GetBehaviourByIndex(i, nullptr), ParallelSafety::SAFE);
 	}
+}
 
-	ASResourceHandle addASResource(const Path& path, ResourceType type) override
+// Walks the bytecode of a job and everything it calls. A job may read globals, use locals, string literals, arrays
+// and the functions and types marked by markParallelSafe. Arrays, including global ones, may be written only through
+// their methods, which check the job's write range at runtime. Anything else (writes to other globals, storing
+// handles in globals, handles to functions, interface calls, allocating script objects, other registered functions)
+// is rejected.
+struct ParallelVerifier
+{
+	struct Global
 	{
-		Resource* res = m_engine_ref.getResourceManager().load(type, path);
-		if (!res) return 0xffFFffFF;
-		++m_last_as_resource_idx;
-		ASSERT(m_last_as_resource_idx != 0xffFFffFF);
-		m_as_resources.insert(m_last_as_resource_idx, res);
-		return m_last_as_resource_idx;
-	}
+		int type_id;
+		bool is_const;
+	};
 
-	Resource* getASResource(ASResourceHandle resource) const override
+	ParallelVerifier(asIScriptEngine* engine, IAllocator& allocator)
+		: engine(engine)
+		, visited(allocator)
+		, globals(allocator)
+		, global_modules(allocator)
 	{
-		auto iter = m_as_resources.find(resource);
-		if (iter.isValid()) return iter.value();
-		return nullptr;
 	}
 
-	TagAllocator m_allocator;
-	asIScriptEngine* m_engine;
-	Engine& m_engine_ref;
-	ASScriptManager m_script_manager;
-	AngelScriptWrapper::StringFactory m_string_factory;
-	HashMap<int, Resource*> m_as_resources;
-	u32 m_last_as_resource_idx = 0;
-};
+	static bool isArrayType(asITypeInfo* type) { return type && equalStrings(type->GetName(), "array"); }
 
-struct AngelScriptModuleImpl final : AngelScriptModule
-{
-	struct ScriptComponent;
+	// Globals are found by address, collected on the first access of each module
+	const Global* findGlobal(asIScriptFunction* func, asPWORD address)
+	{
+		if (global_modules.empty())
+		{
+			for (asUINT i = 0, c = engine->GetGlobalPropertyCount(); i < c; ++i)
+			{
+				Global global;
+				void* ptr;
+				engine->GetGlobalPropertyByIndex(i, nullptr, nullptr, &global.type_id, &global.is_const, nullptr, &ptr);
+				if (!globals.find((u64)(asPWORD)ptr).isValid()) globals.insert((u64)(asPWORD)ptr, global);
+			}
+			global_modules.push(nullptr);
+		}
 
-	struct ScriptEnvironment
+		asIScriptModule* module = func->GetModule();
+		if (module && global_modules.indexOf(module) < 0)
+		{
+			for (asUINT i = 0, c = module->GetGlobalVarCount(); i < c; ++i)
+			{
+				Global global;
+				module->GetGlobalVar(i, nullptr, nullptr, &global.type_id, &global.is_const);
+				const u64 address = (u64)(asPWORD)module->GetAddressOfGlobalVar(i);
+				if (!globals.find(address).isValid()) globals.insert(address, global);
+			}
+			global_modules.push(module);
+		}
+
+		auto iter = globals.find((u64)address);
+		return iter.isValid() ? &iter.value() : nullptr;
+	}
+
+	// Const globals are read only. A global array is pushed to call its methods, the address must be dereferenced
+	// right away, anything else could store a new handle in the global.
+	bool isReadOnlyGlobal(const Global& global, const asDWORD* next, const asDWORD* end)
 	{
-		asIScriptModule* m_script_module = nullptr;
-		asIScriptContext* m_script_context = nullptr;
-	};
+		if (global.is_const) return true;
+		if (!isArrayType(engine->GetTypeInfoById(global.type_id))) return false;
+		if (!next) return true;
+		if (next < end && (asEBCInstr)*(asBYTE*)next == asBC_ChkRefS) next += asBCTypeSize[asBCInfo[asBC_ChkRefS].type];
+		return next < end && (asEBCInstr)*(asBYTE*)next == asBC_RDSPtr;
+	}
 
-	struct ScriptInstance : ScriptEnvironment
+	static bool isRead(const asDWORD* instr, const asDWORD* end)
 	{
-		enum Flags : u32
+		if (instr >= end) return false;
+		switch ((asEBCInstr)*(asBYTE*)instr)
 		{
-			NONE = 0,
-			ENABLED = 1 << 0,
-			LOADED = 1 << 1,
-			MOVED_FROM = 1 << 2
-		};
+			case asBC_RDR1:
+			case asBC_RDR2:
+			case asBC_RDR4:
+			case asBC_RDR8: return true;
+			default: return false;
+		}
+	}
 
-		explicit ScriptInstance(ScriptComponent& cmp, IAllocator& allocator)
-			: m_properties(allocator)
-			, m_cmp(&cmp)
+	// The address returned in the register is read and never written through before the register is overwritten,
+	// e.g. `a[i] += x` reads the element and then writes it through the same address
+	static bool isReadOnlyAddress(const asDWORD* instr, const asDWORD* end)
+	{
+		if (!isRead(instr, end)) return false;
+		while (instr < end)
 		{
-			AngelScriptModuleImpl& module = cmp.m_module;
-			asIScriptEngine* engine = module.m_system.m_engine;
-
-			// Create script module for this instance
-			static int module_counter = 0;
-			m_module_name = StaticString<64>("ScriptInstance", module_counter++);
-			m_script_module = engine->GetModule(m_module_name, asGM_CREATE_IF_NOT_EXISTS);
+			const asEBCInstr op = (asEBCInstr)*(asBYTE*)instr;
+			switch (op)
+			{
+				case asBC_WRTV1:
+				case asBC_WRTV2:
+				case asBC_WRTV4:
+				case asBC_WRTV8:
+				case asBC_INCi8:
+				case asBC_INCi16:
+				case asBC_INCi:
+				case asBC_INCi64:
+				case asBC_INCf:
+				case asBC_INCd:
+				case asBC_DECi8:
+				case asBC_DECi16:
+				case asBC_DECi:
+				case asBC_DECi64:
+				case asBC_DECf:
+				case asBC_DECd:
+				case asBC_PshRPtr:
+				case asBC_CpyRtoV4:
+				case asBC_CpyRtoV8:
+				// the address might be used after the jump
+				case asBC_JMP:
+				case asBC_JMPP:
+				case asBC_JZ:
+				case asBC_JNZ:
+				case asBC_JS:
+				case asBC_JNS:
+				case asBC_JP:
+				case asBC_JNP:
+				case asBC_JLowZ:
+				case asBC_JLowNZ:
+				case asBC_RET: return false;
+				// the register is overwritten
+				case asBC_CALL:
+				case asBC_CALLSYS:
+				case asBC_CALLBND:
+				case asBC_CALLINTF:
+				case asBC_CallPtr:
+				case asBC_Thiscall1:
+				case asBC_PopRPtr:
+				case asBC_LoadThisR:
+				case asBC_LoadRObjR:
+				case asBC_LoadVObjR:
+				case asBC_LdGRdR4:
+				case asBC_CpyVtoR4:
+				case asBC_CpyVtoR8:
+				case asBC_CMPi:
+				case asBC_CMPu:
+				case asBC_CMPf:
+				case asBC_CMPd:
+				case asBC_CMPi64:
+				case asBC_CMPu64:
+				case asBC_CMPIi:
+				case asBC_CMPIu:
+				case asBC_CMPIf:
+				case asBC_TZ:
+				case asBC_TNZ:
+				case asBC_TS:
+				case asBC_TNS:
+				case asBC_TP:
+				case asBC_TNP: return true;
+				default: break;
+			}
+			instr += asBCTypeSize[asBCInfo[op].type];
+		}
+		return true;
+	}
 
-			// Create context for execution
-			m_script_context = engine->CreateContext();
+	// Non-const opIndex of an array is limited to the job's range even when the element is only read, a call whose
+	// result is only read is switched to the const opIndex so jobs can read neighbouring elements.
+	// Only asBC_Thiscall1 is patched, it does not hold a reference to the called function like asBC_CALLSYS.
+	void patchReadOnlyIndex(asDWORD* instr, const asDWORD* end)
+	{
+		asIScriptFunction* func = engine->GetFunctionById(asBC_INTARG(instr));
+		if (!func || func->IsReadOnly() || !equalStrings(func->GetName(), "opIndex")) return;
+		asITypeInfo* type = func->GetObjectType();
+		if (!isArrayType(type)) return;
+		if (!isReadOnlyAddress(instr + asBCTypeSize[asBCInfo[asBC_Thiscall1].type], end)) return;
 
-			m_flags = Flags(m_flags | ENABLED);
+		for (asUINT i = 0, c = type->GetMethodCount(); i < c; ++i)
+		{
+			asIScriptFunction* method = type->GetMethodByIndex(i);
+			if (method->IsReadOnly() && equalStrings(method->GetName(), "opIndex"))
+			{
+				asBC_INTARG(instr) = method->GetId();
+				return;
+			}
 		}
+	}
 
-		ScriptInstance(const ScriptInstance&) = delete;
+	bool check(asIScriptFunction* func)
+	{
+		if (!func) return false;
 
-		ScriptInstance(ScriptInstance&& rhs) noexcept
-			: m_properties(rhs.m_properties.move())
-			, m_cmp(rhs.m_cmp)
-			, m_script(rhs.m_script)
-			, m_flags(rhs.m_flags) 
+		switch (getParallelSafety(func))
 		{
-			m_script_module = rhs.m_script_module;
-			m_script_context = rhs.m_script_context;
-			rhs.m_script = nullptr;
-			rhs.m_script_module = nullptr;
-			rhs.m_script_context = nullptr;
-			rhs.m_flags = Flags(rhs.m_flags | MOVED_FROM);
+			case ParallelSafety::SAFE:
+			case ParallelSafety::CHECKING: return true; // recursion, the result is decided by the outer call
+			case ParallelSafety::UNSAFE: return false;
+			case ParallelSafety::UNKNOWN: break;
 		}
 
-		void operator=(ScriptInstance&& rhs) noexcept
+		switch (func->GetFuncType())
 		{
-			m_properties = rhs.m_properties.move();
-			m_script_module = rhs.m_script_module;
-			m_script_context = rhs.m_script_context;
-			m_cmp = rhs.m_cmp;
-			m_script = rhs.m_script;
-			m_flags = rhs.m_flags;
-			rhs.m_script = nullptr;
-			rhs.m_script_module = nullptr;
-			rhs.m_script_context = nullptr;
-			rhs.m_flags = Flags(rhs.m_flags | MOVED_FROM);
+			case asFUNC_SYSTEM:
+				// array writes are guarded at runtime, see SetScriptArrayWriteRange
+				return isArrayType(func->GetObjectType())
+					|| isArrayType(engine->GetTypeInfoById(func->GetReturnTypeId()));
+			// the bound object is shared by all workers and its members are not guarded like array elements
+			case asFUNC_DELEGATE: return false;
+			case asFUNC_SCRIPT: break;
+			default: return false;
 		}
 
-		~ScriptInstance()
+		setParallelSafety(func, ParallelSafety::CHECKING);
+		visited.push(func);
+
+		asUINT length;
+		asDWORD* bc = func->GetByteCode(&length);
+		const asDWORD* end = bc + length;
+		for (asUINT i = 0; i < length;)
 		{
-			if (!(m_flags & MOVED_FROM))
+			const asEBCInstr op = (asEBCInstr)*(asBYTE*)&bc[i];
+			const asUINT size = asBCTypeSize[asBCInfo[op].type];
+			switch (op)
 			{
-				if (m_script)
-				{
-					m_script->getObserverCb().unbind<&ScriptComponent::onScriptLoaded>(m_cmp);
-					m_script->decRefCount();
-				}
-
-				if (m_script_context)
+				case asBC_Thiscall1:
+					patchReadOnlyIndex(&bc[i], end);
+					if (!check(engine->GetFunctionById(asBC_INTARG(&bc[i])))) return false;
+					break;
+				case asBC_CALL:
+				case asBC_CALLSYS:
+					if (!check(engine->GetFunctionById(asBC_INTARG(&bc[i])))) return false;
+					break;
+				case asBC_PGA:
 				{
-					m_script_context->Release();
+					// string literals are pushed by address too, they are not globals
+					const Global* global = findGlobal(func, asBC_PTRARG(&bc[i]));
+					if (global && !isReadOnlyGlobal(*global, &bc[i + size], end)) return false;
+					break;
 				}
-
-				if (m_script_module)
+				case asBC_PshGPtr:
 				{
-					m_script_module->Discard();
+					// pushes the object a global points to, only reads the global
+					const Global* global = findGlobal(func, asBC_PTRARG(&bc[i]));
+					if (!global || !isReadOnlyGlobal(*global, nullptr, end)) return false;
+					break;
 				}
+				case asBC_LDG:
+					// primitive globals, the address must be only read from
+					if (!isRead(&bc[i + size], end)) return false;
+					break;
+				case asBC_CALLBND:
+				case asBC_CALLINTF:
+				case asBC_CallPtr:
+				case asBC_FuncPtr:
+				case asBC_ALLOC:
+				case asBC_CpyVtoG4:
+				case asBC_SetG4: return false;
+				default: break;
 			}
+			i += size;
 		}
+		return true;
+	}
 
-		void onScriptUnloaded(AngelScriptModuleImpl& module,
-			struct ScriptComponent& cmp,
-			int scr_index)
+	// Only the root's negative result is cached, functions visited on the way might be safe on their own
+	bool verify(asIScriptFunction* root)
+	{
+		const bool safe = check(root);
+		for (asIScriptFunction* func : visited)
 		{
-			if (m_script_module)
-			{
-				m_script_module->Discard();
-				m_script_module = nullptr;
-			}
-
-			// Cleanup when script is unloaded
-			m_flags = Flags(m_flags & ~LOADED);
+			setParallelSafety(func, safe ? ParallelSafety::SAFE : ParallelSafety::UNKNOWN);
 		}
+		if (!safe && root) setParallelSafety(root, ParallelSafety::UNSAFE);
+		return safe;
+	}
 
-		void onScriptLoaded(AngelScriptModuleImpl& module,
-			struct ScriptComponent& cmp,
-			int scr_index)
-		{
-			if (/*!m_script_module || */ !m_script) return;
-
-			if (m_script_module)
-			{
-				m_script_module->Discard();
-			}
+	asIScriptEngine* engine;
+	Array<asIScriptFunction*> visited;
+	HashMap<u64, Global> globals;
+	// modules with globals in `globals`, null for the registered ones
+	Array<asIScriptModule*> global_modules;
+};
 
-			asIScriptEngine* engine = module.m_system.m_engine;
+enum class AngelScriptModuleVersion : i32
+{
+	HASH64,
+	INLINE_SCRIPT,
 
-			m_script_module = engine->GetModule(m_module_name, asGM_CREATE_IF_NOT_EXISTS);
+	LATEST
+};
 
-			bool is_reload = m_flags & LOADED;
+struct ASScriptManager final : ResourceManager
+{
+	ASScriptManager(const ASBundle& bundle, IAllocator& allocator)
+		: ResourceManager(allocator)
+		, m_allocator(allocator)
+		, m_bundle(bundle)
+		, m_bundle_scripts(allocator)
+	{
+	}
 
-			// Add script section and build
-			StringView source = m_script->getSourceCode();
-			int r = m_script_module->AddScriptSection(m_script->getPath().c_str(), source.begin, source.size());
-			if (r < 0)
-			{
-				logError("Failed to add script section for ", m_script->getPath());
-				return;
-			}
+	// Scripts in the bundle are ready when created, so the resource manager never reads their compiled asset
+	Resource* createResource(const Path& path) override
+	{
+		ASScript* script = LUMIX_NEW(m_allocator, ASScript)(path, *this, m_allocator);
+		ASBundle::Script data;
+		if (m_bundle.find(path, data) && script->loadFromBundle(data.header))
+		{
+			// an unloaded script would be loaded from its file again, they are kept until releaseBundleScripts
+			script->incRefCount();
+			m_bundle_scripts.push(script);
+		}
+		return script;
+	}
 
-			r = m_script_module->Build();
-			if (r < 0)
-			{
-				logError("Failed to build script ", m_script->getPath());
-				return;
-			}
+	void releaseBundleScripts()
+	{
+		for (ASScript* script : m_bundle_scripts) script->decRefCount();
+		m_bundle_scripts.clear();
+	}
 
-			m_flags = Flags(m_flags | LOADED);
+	void destroyResource(Resource& resource) override { LUMIX_DELETE(m_allocator, static_cast<ASScript*>(&resource)); }
 
-			// Call awake function if it exists
-			asIScriptFunction* awake_func = m_script_module->GetFunctionByName("awake");
-			if (awake_func && m_script_context)
-			{
-				m_script_context->Prepare(awake_func);
-				m_script_context->Execute();
-			}
-		}
+	IAllocator& m_allocator;
+	const ASBundle& m_bundle;
+	Array<ASScript*> m_bundle_scripts;
+};
 
-		ScriptComponent* m_cmp;
-		ASScript* m_script = nullptr;
-		StaticString<64> m_module_name;
-		Array<Property> m_properties;
-		Flags m_flags = Flags::NONE;
+// Hierarchical timing wheel, LEVELS x SLOTS buckets of doubly linked timers.
+// Insertion and cancellation are O(1), advancing touches only the bucket of the current tick
+// and, once per SLOTS ticks, cascades one bucket of the next level down.
+struct TimerWheel
+{
+	static constexpr u32 SLOT_BITS = 6;
+	static constexpr u32 SLOTS = 1 << SLOT_BITS;
+	static constexpr u32 LEVELS = 4;
+	static constexpr u64 MAX_DELTA = (1ULL << (SLOT_BITS * LEVELS)) - 1;
+	static constexpr double TICK = 0.01;
+	static constexpr u32 INVALID = 0xffFFffFF;
+	static constexpr u32 INDEX_BITS = 20;
+	static constexpr u32 INDEX_MASK = (1 << INDEX_BITS) - 1;
+
+	struct Timer
+	{
+		u64 expires = 0;
+		u64 interval = 0;
+		u32 bucket = INVALID;
+		u32 prev = INVALID;
+		u32 next = INVALID;
+		u32 owner = 0;
+		u32 owner_prev = INVALID;
+		u32 owner_next = INVALID;
+		u32 generation = 1;
+		asIScriptFunction* callback = nullptr;
+		void* user = nullptr;
 	};
 
-	struct InlineScriptComponent : ScriptEnvironment
+	explicit TimerWheel(IAllocator& allocator)
+		: m_timers(allocator)
+		, m_owner_heads(allocator)
+		, m_due(allocator)
 	{
-		InlineScriptComponent(EntityRef entity, AngelScriptModuleImpl& module, IAllocator& allocator)
-			: m_source(allocator)
-			, m_entity(entity)
-			, m_module(module)
-		{
-			asIScriptEngine* engine = module.m_system.m_engine;
-
-			// Create script module for this instance
-			static int module_counter = 0;
-			StaticString<64> module_name("InlineScript", module_counter++);
-			m_script_module = engine->GetModule(module_name, asGM_CREATE_IF_NOT_EXISTS);
+		for (u32& head : m_buckets) head = INVALID;
+	}
 
-			// Create context for execution
-			m_script_context = engine->CreateContext();
+	~TimerWheel()
+	{
+		for (Timer& timer : m_timers)
+		{
+			if (timer.callback) timer.callback->Release();
 		}
+	}
 
-		InlineScriptComponent(InlineScriptComponent&& rhs) noexcept
-			: m_module(rhs.m_module)
-			, m_source(rhs.m_source)
-			, m_entity(rhs.m_entity)
+	// Takes ownership of `callback`, returns 0 on failure
+	u32 add(asIScriptFunction* callback, void* user, u32 owner, float delay, bool repeat)
+	{
+		u32 idx = m_free_head;
+		if (idx != INVALID)
 		{
-			m_script_module = rhs.m_script_module;
-			m_script_context = rhs.m_script_context;
-			rhs.m_script_module = nullptr;
-			rhs.m_script_context = nullptr;
+			m_free_head = m_timers[idx].next;
 		}
-
-		void operator=(InlineScriptComponent&& rhs) = delete;
-
-		~InlineScriptComponent()
+		else
 		{
-			if (m_script_context)
+			// handles store idx + 1 in INDEX_BITS
+			if ((u32)m_timers.size() >= INDEX_MASK)
 			{
-				m_script_context->Release();
+				callback->Release();
+				return 0;
 			}
+			idx = m_timers.size();
+			m_timers.emplace();
+		}
 
-			if (m_script_module)
-			{
-				m_script_module->Discard();
-			}
-		}
-
-		void compileAndRun()
-		{
-			if (!m_script_module) return;
-
-			// Add script section and build
-			int r = m_script_module->AddScriptSection("main", m_source.c_str());
-			if (r < 0)
-			{
-				logError("Failed to add script section");
-				return;
-			}
+		const u64 ticks = maximum((u64)(maximum(delay, 0.f) / TICK + 0.5), (u64)1);
+		Timer& timer = m_timers[idx];
+		timer.expires = m_now + ticks;
+		timer.interval = repeat ? ticks : 0;
+		timer.callback = callback;
+		timer.user = user;
+		timer.owner = owner;
+		link(idx);
+		linkOwner(idx);
+		return handle(idx);
+	}
 
-			r = m_script_module->Build();
-			if (r < 0)
-			{
-				logError("Failed to build script");
-				return;
-			}
+	void cancel(u32 handle)
+	{
+		const u32 idx = (handle & INDEX_MASK) - 1;
+		if (idx >= (u32)m_timers.size()) return;
+		if (m_timers[idx].generation != (handle >> INDEX_BITS)) return;
+		if (!m_timers[idx].callback) return;
+		release(idx);
+	}
 
-			// Find and execute main function
-			asIScriptFunction* func = m_script_module->GetFunctionByDecl("void main()");
-			if (func)
-			{
-				m_script_context->Prepare(func);
-				m_script_context->Execute();
-			}
+	void cancelOwner(u32 owner)
+	{
+		auto iter = m_owner_heads.find(owner);
+		if (!iter.isValid()) return;
+		u32 idx = iter.value();
+		while (idx != INVALID)
+		{
+			const u32 next = m_timers[idx].owner_next;
+			release(idx);
+			idx = next;
 		}
+	}
 
-		AngelScriptModuleImpl& m_module;
-		EntityRef m_entity;
-		String m_source;
-	};
-
-	struct ScriptComponent
+	// One-shot timers held by resumeOwner's owner are due on the next tick
+	void resumeOwner(u32 owner)
 	{
-		ScriptComponent(AngelScriptModuleImpl& module, EntityRef entity, IAllocator& allocator)
-			: m_scripts(allocator)
-			, m_module(module)
-			, m_entity(entity)
+		auto iter = m_owner_heads.find(owner);
+		if (!iter.isValid()) return;
+		for (u32 idx = iter.value(); idx != INVALID; idx = m_timers[idx].owner_next)
 		{
+			Timer& timer = m_timers[idx];
+			if (timer.bucket != INVALID) continue;
+			timer.expires = m_now;
+			link(idx);
 		}
+	}
 
-		void onScriptLoaded(Resource::State old_state, Resource::State new_state, Resource& resource)
+	// `fire(asIScriptFunction*, void* user, u32 owner)` is called for each expired timer. It returns false if the
+	// owner can not run it now, a one-shot timer is then held outside the wheel until resumeOwner.
+	template <typename F> void advance(float dt, const F& fire)
+	{
+		m_time += dt;
+		const u64 target = (u64)(m_time / TICK);
+		while (m_now <= target)
 		{
-			for (int scr_index = 0, c = m_scripts.size(); scr_index < c; ++scr_index)
+			const u32 index = u32(m_now & (SLOTS - 1));
+			if (index == 0)
 			{
-				ScriptInstance& script = m_scripts[scr_index];
-
-				if (!script.m_script) continue;
-				if (script.m_script != &resource) continue;
-				if (new_state == Resource::State::READY)
+				for (u32 level = 1; level < LEVELS; ++level)
 				{
-					script.onScriptLoaded(m_module, *this, scr_index);
+					const u32 slot = u32((m_now >> (SLOT_BITS * level)) & (SLOTS - 1));
+					cascade(level * SLOTS + slot);
+					if (slot != 0) break;
 				}
-				else if (new_state == Resource::State::EMPTY)
+			}
+
+			m_due.clear();
+			for (u32 idx = m_buckets[index]; idx != INVALID; idx = m_timers[idx].next) m_due.push(idx);
+			m_buckets[index] = INVALID;
+			for (u32 idx : m_due) m_timers[idx].bucket = INVALID;
+			++m_now;
+
+			for (u32 idx : m_due)
+			{
+				// cancelled by an earlier callback in this batch
+				if (!m_timers[idx].callback || m_timers[idx].bucket != INVALID) continue;
+
+				asIScriptFunction* callback = m_timers[idx].callback;
+				void* user = m_timers[idx].user;
+				const u32 owner = m_timers[idx].owner;
+				const u32 generation = m_timers[idx].generation;
+				const bool repeat = m_timers[idx].interval > 0;
+				callback->AddRef();
+				if (repeat)
 				{
-					script.onScriptUnloaded(m_module, *this, scr_index);
+					m_timers[idx].expires += m_timers[idx].interval;
+					link(idx);
 				}
+				const bool fired = fire(callback, user, owner);
+				// the callback can cancel its own timer
+				const bool alive = m_timers[idx].callback && m_timers[idx].generation == generation;
+				if (!repeat && fired && alive) release(idx);
+				callback->Release();
 			}
 		}
+	}
 
-		Array<ScriptInstance> m_scripts;
-		AngelScriptModuleImpl& m_module;
-		EntityRef m_entity;
-	};
+	u32 getActiveCount() const { return m_active_count; }
 
-	struct FunctionCall : IFunctionCall
+private:
+	u32 handle(u32 idx) const { return (m_timers[idx].generation << INDEX_BITS) | (idx + 1); }
+
+	u32 bucketFor(u64 expires) const
 	{
-		void add(int parameter) override
+		if (expires < m_now) return u32(m_now & (SLOTS - 1));
+		u64 delta = expires - m_now;
+		if (delta > MAX_DELTA)
 		{
-			// TODO: Add parameter to context
-			++parameter_count;
+			// re-cascaded until it gets in range, `expires` keeps the real deadline
+			delta = MAX_DELTA;
+			expires = m_now + delta;
 		}
+		u32 level = 0;
+		while (delta >= (1ULL << (SLOT_BITS * (level + 1)))) ++level;
+		return level * SLOTS + u32((expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+	}
 
-		void add(EntityPtr parameter) override
-		{
-			// TODO: Add parameter to context
-			++parameter_count;
-		}
+	void link(u32 idx)
+	{
+		Timer& timer = m_timers[idx];
+		timer.bucket = bucketFor(timer.expires);
+		timer.prev = INVALID;
+		timer.next = m_buckets[timer.bucket];
+		if (timer.next != INVALID) m_timers[timer.next].prev = idx;
+		m_buckets[timer.bucket] = idx;
+	}
 
-		void add(bool parameter) override
-		{
-			// TODO: Add parameter to context
-			++parameter_count;
-		}
+	void unlink(u32 idx)
+	{
+		Timer& timer = m_timers[idx];
+		if (timer.bucket == INVALID) return;
+		if (timer.prev != INVALID)
+			m_timers[timer.prev].next = timer.next;
+		else
+			m_buckets[timer.bucket] = timer.next;
+		if (timer.next != INVALID) m_timers[timer.next].prev = timer.prev;
+		timer.bucket = INVALID;
+	}
 
-		void add(float parameter) override
+	void linkOwner(u32 idx)
+	{
+		Timer& timer = m_timers[idx];
+		auto iter = m_owner_heads.find(timer.owner);
+		timer.owner_prev = INVALID;
+		timer.owner_next = iter.isValid() ? iter.value() : INVALID;
+		if (timer.owner_next != INVALID) m_timers[timer.owner_next].owner_prev = idx;
+		if (iter.isValid())
+			iter.value() = idx;
+		else
+			m_owner_heads.insert(timer.owner, idx);
+		++m_active_count;
+	}
+
+	void unlinkOwner(u32 idx)
+	{
+		Timer& timer = m_timers[idx];
+		if (timer.owner_prev != INVALID)
 		{
-			// TODO: Add parameter to context
-			++parameter_count;
+			m_timers[timer.owner_prev].owner_next = timer.owner_next;
 		}
-
-		void add(void* parameter) override
+		else if (timer.owner_next != INVALID)
 		{
-			// TODO: Add parameter to context
-			++parameter_count;
+			m_owner_heads[timer.owner] = timer.owner_next;
 		}
-
-		void addEnvironment(asIScriptModule* module) override
+		else
 		{
-			this->module = module;
-			++parameter_count;
+			m_owner_heads.erase(timer.owner);
 		}
+		if (timer.owner_next != INVALID) m_timers[timer.owner_next].owner_prev = timer.owner_prev;
+		--m_active_count;
+	}
 
-		World* world = nullptr;
-		int parameter_count = 0;
-		asIScriptModule* module = nullptr;
-		asIScriptContext* context = nullptr;
-		bool is_in_progress = false;
-	};
+	void release(u32 idx)
+	{
+		unlink(idx);
+		unlinkOwner(idx);
+		Timer& timer = m_timers[idx];
+		timer.callback->Release();
+		timer.callback = nullptr;
+		timer.user = nullptr;
+		timer.generation = (timer.generation + 1) & (0xffFFffFF >> INDEX_BITS);
+		if (timer.generation == 0) timer.generation = 1;
+		timer.next = m_free_head;
+		m_free_head = idx;
+	}
 
-public:
-	AngelScriptModuleImpl(AngelScriptSystemImpl& system, World& world)
-		: m_system(system)
-		, m_world(world)
-		, m_scripts(system.m_allocator)
-		, m_inline_scripts(system.m_allocator)
-		, m_property_names(system.m_allocator)
-		, m_is_game_running(false)
+	void cascade(u32 bucket)
 	{
-		m_function_call.is_in_progress = false;
+		u32 idx = m_buckets[bucket];
+		m_buckets[bucket] = INVALID;
+		while (idx != INVALID)
+		{
+			const u32 next = m_timers[idx].next;
+			link(idx);
+			idx = next;
+		}
 	}
 
-	int getVersion() const override { return (int)AngelScriptModuleVersion::LATEST; }
-	const char* getName() const override { return "angelscript"; }
+	Array<Timer> m_timers;
+	HashMap<u32, u32> m_owner_heads;
+	Array<u32> m_due;
+	u32 m_buckets[LEVELS * SLOTS];
+	u32 m_free_head = INVALID;
+	u32 m_active_count = 0;
+	u64 m_now = 0;
+	double m_time = 0;
+};
 
-	IFunctionCall* beginFunctionCall(const ScriptEnvironment& env, const char* function)
+// Writes files on its own thread, blocking I/O must not stall the job system workers. Requests are processed one at a
+// time in submission order, so appends and stream chunks to the same file stay ordered. Results are picked up on
+// the main thread with popCompletions.
+struct AsyncFileWriter final : os::Thread
+{
+	enum class Op : u8
 	{
-		if (!env.m_script_module || !env.m_script_context) return nullptr;
+		WRITE,
+		APPEND,
+		STREAM_OPEN,
+		STREAM_WRITE,
+		STREAM_CLOSE
+	};
 
-		asIScriptFunction* func = env.m_script_module->GetFunctionByName(function);
-		if (!func) return nullptr;
+	struct Request
+	{
+		explicit Request(IAllocator& allocator)
+			: data(allocator)
+		{
+		}
 
-		m_function_call.context = env.m_script_context;
-		m_function_call.module = env.m_script_module;
-		m_function_call.world = &m_world;
-		m_function_call.is_in_progress = true;
-		m_function_call.parameter_count = 0;
+		Op op;
+		u32 id;     // request reported in completions, 0 if nobody waits for it
+		u32 stream; // STREAM_* only
+		Path path;
+		OutputMemoryStream data;
+	};
 
-		return &m_function_call;
-	}
+	struct Completion
+	{
+		u32 id;
+		bool success;
+	};
 
-	IFunctionCall* beginFunctionCallInlineScript(EntityRef entity, const char* function) override
+	// Writer side state of an open stream
+	struct Stream
 	{
-		ASSERT(!m_function_call.is_in_progress);
-		auto iter = m_inline_scripts.find(entity);
-		if (!iter.isValid()) return nullptr;
+		os::OutputFile file;
+		bool is_open = false;
+		bool failed = false;
+	};
 
-		InlineScriptComponent& script = iter.value();
-		return beginFunctionCall(script, function);
+	AsyncFileWriter(FileSystem& fs, IAllocator& allocator)
+		: os::Thread(allocator)
+		, m_fs(fs)
+		, m_allocator(allocator)
+		, m_queue(allocator)
+		, m_processing(allocator)
+		, m_completions(allocator)
+		, m_streams(allocator)
+		, m_append_files(allocator)
+		, m_semaphore(0, 0x7fffFFFF)
+	{
+		if (!create("angelscript_file_writer", false)) logError("Failed to create the script file writer thread");
 	}
 
-	IFunctionCall* beginFunctionCall(EntityRef entity, int scr_index, const char* function) override
+	~AsyncFileWriter()
 	{
-		ASSERT(!m_function_call.is_in_progress);
-		auto iter = m_scripts.find(entity);
-		if (!iter.isValid()) return nullptr;
+		// queued requests are written before the thread exits
+		m_quit = 1;
+		m_semaphore.signal();
+		destroy();
+		for (Stream* stream : m_streams) closeStream(stream);
+		for (FILE* file : m_append_files) fclose(file);
+	}
 
-		ScriptComponent* script_cmp = iter.value();
-		auto& script = script_cmp->m_scripts[scr_index];
-		return beginFunctionCall(script, function);
+	// Data is copied once into the request
+	void push(Op op, u32 id, u32 stream, const Path& path, Span<const u8> data)
+	{
+		{
+			MutexGuard guard(m_mutex);
+			Request& req = m_queue.emplace(m_allocator);
+			req.op = op;
+			req.id = id;
+			req.stream = stream;
+			req.path = path;
+			req.data.write(data.begin(), data.length());
+		}
+		m_semaphore.signal();
 	}
 
-	void endFunctionCall() override
+	void popCompletions(Array<Completion>& out)
 	{
-		ASSERT(m_function_call.is_in_progress);
-		m_function_call.is_in_progress = false;
-		// TODO: Execute the function call with parameters
+		MutexGuard guard(m_mutex);
+		for (const Completion& c : m_completions) out.push(c);
+		m_completions.clear();
 	}
 
-	int getPropertyCount(EntityRef entity, int scr_index) override
+	i32 task() override
 	{
-		return m_scripts[entity]->m_scripts[scr_index].m_properties.size();
+		for (;;)
+		{
+			m_semaphore.wait();
+			{
+				MutexGuard guard(m_mutex);
+				if (m_queue.empty())
+				{
+					if (m_quit) return 0;
+					continue;
+				}
+				swap(m_queue, m_processing);
+			}
+
+			PROFILE_BLOCK("angelscript file writes");
+			for (Request& req : m_processing)
+			{
+				const bool success = execute(req);
+				if (!req.id) continue;
+				MutexGuard guard(m_mutex);
+				m_completions.push({req.id, success});
+			}
+			m_processing.clear();
+		}
 	}
 
-	const char* getPropertyName(EntityRef entity, int scr_index, int prop_index) override
+	void closeStream(Stream* stream)
 	{
-		return getPropertyName(m_scripts[entity]->m_scripts[scr_index].m_properties[prop_index].name_hash);
+		if (stream->is_open) stream->file.close();
+		LUMIX_DELETE(m_allocator, stream);
 	}
 
-	ResourceType getPropertyResourceType(EntityRef entity, int scr_index, int prop_index) override
+	// Other writes to the file must not interleave with an append file left open
+	void closeAppendFile(const Path& path)
 	{
-		return m_scripts[entity]->m_scripts[scr_index].m_properties[prop_index].resource_type;
+		auto iter = m_append_files.find(path.getHash());
+		if (!iter.isValid()) return;
+		fclose(iter.value());
+		m_append_files.erase(iter);
 	}
 
-	Property::Type getPropertyType(EntityRef entity, int scr_index, int prop_index) override
+	// os::OutputFile can not append, the file is opened in append mode through stdio and stays open for later
+	// appends. A failed open is not remembered, the next append tries again.
+	FILE* getAppendFile(const Path& path)
 	{
-		return m_scripts[entity]->m_scripts[scr_index].m_properties[prop_index].type;
+		auto iter = m_append_files.find(path.getHash());
+		if (iter.isValid()) return iter.value();
+
+		const StaticString<MAX_PATH> full_path(m_fs.getBasePath(), path.c_str());
+		FILE* file = fopen(full_path.data, "ab");
+		if (file) m_append_files.insert(path.getHash(), file);
+		return file;
 	}
 
-	~AngelScriptModuleImpl()
+	// Writer thread only, m_streams and m_append_files are not touched by the main thread
+	bool execute(Request& req)
 	{
-		for (auto* script_cmp : m_scripts)
+		switch (req.op)
 		{
-			ASSERT(script_cmp);
-			LUMIX_DELETE(m_system.m_allocator, script_cmp);
+			case Op::WRITE:
+			{
+				closeAppendFile(req.path);
+				os::OutputFile file;
+				if (!m_fs.open(req.path.c_str(), file)) return false;
+				const bool success = file.write(req.data.data(), req.data.size());
+				file.close();
+				return success;
+			}
+			case Op::APPEND:
+			{
+				FILE* file = getAppendFile(req.path);
+				if (!file) return false;
+				// flushed so reads of the file see the data
+				const bool success = fwrite(req.data.data(), 1, req.data.size(), file) == req.data.size()
+					&& fflush(file) == 0;
+				if (!success) closeAppendFile(req.path);
+				return success;
+			}
+			case Op::STREAM_OPEN:
+			{
+				closeAppendFile(req.path);
+				Stream* stream = LUMIX_NEW(m_allocator, Stream);
+				stream->is_open = m_fs.open(req.path.c_str(), stream->file);
+				stream->failed = !stream->is_open;
+				m_streams.insert(req.stream, stream);
+				return stream->is_open;
+			}
+			case Op::STREAM_WRITE:
+			{
+				auto iter = m_streams.find(req.stream);
+				if (!iter.isValid()) return false;
+				Stream* stream = iter.value();
+				if (!stream->failed) stream->failed = !stream->file.write(req.data.data(), req.data.size());
+				return !stream->failed;
+			}
+			case Op::STREAM_CLOSE:
+			{
+				auto iter = m_streams.find(req.stream);
+				if (!iter.isValid()) return false;
+				Stream* stream = iter.value();
+				const bool success = !stream->failed;
+				closeStream(stream);
+				m_streams.erase(iter);
+				return success;
+			}
 		}
+		return false;
 	}
 
-	bool execute(EntityRef entity, i32 scr_index, StringView code) override
-	{
-		const ScriptInstance& script = m_scripts[entity]->m_scripts[scr_index];
+	FileSystem& m_fs;
+	IAllocator& m_allocator;
+	Mutex m_mutex;
+	Array<Request> m_queue;
+	Array<Request> m_processing;
+	Array<Completion> m_completions;
+	HashMap<u32, Stream*> m_streams;
+	HashMap<FilePathHash, FILE*> m_append_files;
+	Semaphore m_semaphore;
+	AtomicI32 m_quit = 0;
+};
 
-		if (!script.m_script_module || !script.m_script_context) return false;
+void messageCallback(const asSMessageInfo* msg, void* param)
+{
+	const char* type = "Error";
+	if (msg->type == asMSGTYPE_WARNING)
+		type = "Warning";
+	else if (msg->type == asMSGTYPE_INFORMATION)
+		type = "Info";
 
-		// Add code as script section and build
-		int r = script.m_script_module->AddScriptSection("temp", code.begin, code.size());
-		if (r < 0) return false;
+	logError("AngelScript ", type, " (", msg->row, ", ", msg->col, "): ", msg->message);
+}
 
-		r = script.m_script_module->Build();
-		if (r < 0) return false;
+// Sampling profiler. The thread only raises `requested`, the VM checks it and the script thread itself copies its
+// callstack from the sample hook into a single producer, single consumer ring, which is drained in
+// AngelScriptSystem::update.
+struct ScriptSampler final : os::Thread
+{
+	static constexpr u32 MAX_DEPTH = 32;
+	static constexpr i32 CAPACITY = 1024;
 
-		// Execute main function if it exists
-		asIScriptFunction* func = script.m_script_module->GetFunctionByDecl("void main()");
-		if (func)
-		{
-			script.m_script_context->Prepare(func);
-			r = script.m_script_context->Execute();
-			return r == asEXECUTION_FINISHED;
-		}
+	struct Sample
+	{
+		u32 depth;
+		// [0] is the innermost function
+		const char* functions[MAX_DEPTH];
+		i32 line;
+	};
 
-		return true;
+	ScriptSampler(u32 interval_ms, IAllocator& allocator)
+		: os::Thread(allocator)
+		, m_interval_ms(interval_ms > 0 ? interval_ms : 1)
+		, m_samples(allocator)
+	{
+		m_samples.resize(CAPACITY);
 	}
 
-	asIScriptContext* getContext(EntityRef entity, int scr_index) override
+	i32 task() override
 	{
-		return m_scripts[entity]->m_scripts[scr_index].m_script_context;
+		while (m_quit == 0)
+		{
+			os::sleep(m_interval_ms);
+			// nothing to sample between scripts, a stale request would be blamed on the next executed script
+			if (m_running > 0) m_requested = 1;
+		}
+		return 0;
 	}
 
-	asIScriptModule* getScriptModule(EntityRef entity, int scr_index) override
+	// Called only from the thread running scripts
+	Sample* beginWrite()
 	{
-		return m_scripts[entity]->m_scripts[scr_index].m_script_module;
+		if (m_write - m_read >= CAPACITY)
+		{
+			m_dropped.add(1);
+			return nullptr;
+		}
+		return &m_samples[m_write % CAPACITY];
 	}
 
-	World& getWorld() override { return m_world; }
+	void endWrite() { m_write.add(1); }
+
+	u32 m_interval_ms;
+	Array<Sample> m_samples;
+	AtomicI32 m_write = 0;
+	AtomicI32 m_read = 0;
+	AtomicI32 m_dropped = 0;
+	// read by every executing context, see asSetSampleHook
+	volatile i32 m_requested = 0;
+	// number of execute() calls on the stack
+	AtomicI32 m_running = 0;
+	AtomicI32 m_quit = 0;
+};
 
-	void startGame() override { m_is_game_running = true; }
+// Script `Resource` value, a counted reference to a slot of the AS resource table. Counting is done by the
+// behaviours registered in registerResourceAPI.
+struct ScriptResource
+{
+	AngelScriptSystem::ASResourceHandle handle;
+};
 
-	void stopGame() override { m_is_game_running = false; }
+struct AngelScriptSystemImpl final : AngelScriptSystem
+{
+	explicit AngelScriptSystemImpl(Engine& engine);
+	virtual ~AngelScriptSystemImpl();
 
-	void createInlineScriptComponent(EntityRef entity)
-	{
-		m_inline_scripts.insert(entity, InlineScriptComponent(entity, *this, m_system.m_allocator));
-		m_world.onComponentCreated(entity, ANGELSCRIPT_INLINE_TYPE, this);
-	}
-
-	void destroyInlineScriptComponent(EntityRef entity)
-	{
-		m_inline_scripts.erase(entity);
-		m_world.onComponentDestroyed(entity, ANGELSCRIPT_INLINE_TYPE, this);
-	}
+	void createModules(World& world) override;
+	const char* getName() const override { return "angelscript"; }
+	ASScriptManager& getScriptManager() { return m_script_manager; }
+	void serialize(OutputMemoryStream& stream) const override {}
+	bool deserialize(i32 version, InputMemoryStream& stream) override { return version == 0; }
+	asIScriptEngine* getEngine() override { return m_engine; }
 
-	void createScriptComponent(EntityRef entity)
+	// Built on the first use in a frame, modules update before systems and must not see the previous frame
+	const ASInputSnapshot& getInputSnapshot() override
 	{
-		auto& allocator = m_system.m_allocator;
-		ScriptComponent* script = LUMIX_NEW(allocator, ScriptComponent)(*this, entity, allocator);
-		m_scripts.insert(entity, script);
-		m_world.onComponentCreated(entity, ANGELSCRIPT_TYPE, this);
+		if (m_input_snapshot_frame != m_frame)
+		{
+			updateInputSnapshot();
+			m_input_snapshot_frame = m_frame;
+		}
+		return m_input_snapshot;
 	}
 
-	void destroyScriptComponent(EntityRef entity)
+	void update(float dt) override
 	{
-		ScriptComponent* cmp = m_scripts[entity];
-		LUMIX_DELETE(m_system.m_allocator, cmp);
-		m_scripts.erase(entity);
-		m_world.onComponentDestroyed(entity, ANGELSCRIPT_TYPE, this);
+		PROFILE_FUNCTION();
+		++m_frame;
+		if (m_sampler) drainSamples();
+		if (m_function_stats_mode == FunctionStatsMode::PER_FRAME) publishFunctionStats();
+		updateVMStats();
 	}
 
-	void setPropertyValue(EntityRef entity, int scr_index, const char* name, const char* value) override
+	static void setBit(u64* bits, u32 idx, bool value)
 	{
-		auto* script_cmp = m_scripts[entity];
-		if (!script_cmp) return;
-		Property& prop = getScriptProperty(entity, scr_index, name);
-		prop.stored_value = value;
+		if (idx >= 256) return;
+		const u64 mask = 1ULL << (idx & 63);
+		if (value)
+			bits[idx >> 6] |= mask;
+		else
+			bits[idx >> 6] &= ~mask;
 	}
 
-	void getPropertyValue(EntityRef entity, int scr_index, const char* property_name, Span<char> out) override
+	void updateInputSnapshot()
 	{
-		ASSERT(out.length() > 0);
-
-		const StableHash hash(property_name);
-		auto& inst = m_scripts[entity]->m_scripts[scr_index];
-		for (auto& prop : inst.m_properties)
+		ASInputSnapshot& snapshot = m_input_snapshot;
+		for (u64& bits : snapshot.keys_pressed) bits = 0;
+		for (u64& bits : snapshot.keys_released) bits = 0;
+		snapshot.events.clear();
+
+		const Span<const InputSystem::Event> events = m_engine_ref.getInputSystem().getEvents();
+		snapshot.events.reserve(events.length());
+		for (const InputSystem::Event& event : events)
 		{
-			if (prop.name_hash == hash)
+			ASInputEvent& dst = snapshot.events.emplace();
+			dst.type = (u32)event.type;
+			dst.device_type = event.device ? (u32)event.device->type : 0;
+			switch (event.type)
 			{
-				copyString(out, prop.stored_value);
-				return;
+				case InputSystem::Event::BUTTON:
+				{
+					const InputSystem::ButtonEvent& button = event.data.button;
+					dst.key_id = button.key_id;
+					dst.down = button.down;
+					dst.is_repeat = button.is_repeat;
+					dst.x = button.x;
+					dst.y = button.y;
+					if (!event.device || button.is_repeat) break;
+					if (event.device->type == InputSystem::Device::KEYBOARD)
+					{
+						setBit(snapshot.keys_down, button.key_id, button.down);
+						setBit(button.down ? snapshot.keys_pressed : snapshot.keys_released, button.key_id, true);
+					}
+					else if (event.device->type == InputSystem::Device::MOUSE && button.key_id < 32)
+					{
+						if (button.down)
+							snapshot.mouse_down |= 1 << button.key_id;
+						else
+							snapshot.mouse_down &= ~(1 << button.key_id);
+					}
+					break;
+				}
+				case InputSystem::Event::AXIS:
+					dst.x = event.data.axis.x;
+					dst.y = event.data.axis.y;
+					dst.x_abs = event.data.axis.x_abs;
+					dst.y_abs = event.data.axis.y_abs;
+					break;
+				case InputSystem::Event::TEXT_INPUT: dst.utf8 = event.data.text.utf8; break;
+				default: break;
 			}
 		}
-		out[0] = '\0';
 	}
 
-	const char* getPropertyName(StableHash name_hash) const
-	{
-		auto iter = m_property_names.find(name_hash);
-		if (iter.isValid()) return iter.value().c_str();
-		return "N/A";
-	}
+	bool scriptIsKeyDown(i32 keycode) { return getInputSnapshot().isKeyDown((u32)keycode); }
+	bool scriptWasKeyPressed(i32 keycode) { return getInputSnapshot().wasKeyPressed((u32)keycode); }
+	bool scriptWasKeyReleased(i32 keycode) { return getInputSnapshot().wasKeyReleased((u32)keycode); }
+	bool scriptIsMouseButtonDown(i32 button) { return getInputSnapshot().isMouseButtonDown((u32)button); }
+	u32 scriptGetInputEventCount() { return getInputSnapshot().events.size(); }
 
-	void serialize(OutputMemoryStream& serializer) override
+	const ASInputEvent& scriptGetInputEvent(u32 idx)
 	{
-		serializer.write(m_inline_scripts.size());
-		for (auto iter : m_inline_scripts.iterated())
-		{
-			serializer.write(iter.key());
-			serializer.write(iter.value().m_source);
-		}
-
-		serializer.write(m_scripts.size());
-		for (ScriptComponent* script_cmp : m_scripts)
+		const ASInputSnapshot& snapshot = getInputSnapshot();
+		if (idx >= (u32)snapshot.events.size())
 		{
-			serializer.write(script_cmp->m_entity);
-			serializer.write(script_cmp->m_scripts.size());
-			for (auto& scr : script_cmp->m_scripts)
-			{
-				serializer.writeString(scr.m_script ? scr.m_script->getPath() : Path());
-				serializer.write(scr.m_flags);
-				serializer.write(scr.m_properties.size());
-				for (Property& prop : scr.m_properties)
-				{
-					serializer.write(prop.name_hash);
-					serializer.write(prop.type);
-					serializer.writeString(prop.stored_value);
-				}
-			}
+			asGetActiveContext()->SetException("Input event index out of bounds");
+			static const ASInputEvent empty = {};
+			return empty;
 		}
+		return snapshot.events[idx];
 	}
 
-	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
-	{
-		const i32 inline_len = serializer.read<i32>();
-		m_inline_scripts.reserve(inline_len);
-		for (int i = 0; i < inline_len; ++i)
-		{
-			EntityRef entity;
-			serializer.read(entity);
-			entity = entity_map.get(entity);
-			auto iter = m_inline_scripts.insert(entity, InlineScriptComponent(entity, *this, m_system.m_allocator));
-			serializer.read(iter.value().m_source);
-			m_world.onComponentCreated(entity, ANGELSCRIPT_INLINE_TYPE, this);
-		}
+	void scriptParallelFor(u32 count, u32 grain, asIScriptFunction* job);
 
-		int len = serializer.read<int>();
-		m_scripts.reserve(len + m_scripts.size());
-		for (int i = 0; i < len; ++i)
-		{
-			auto& allocator = m_system.m_allocator;
-			EntityRef entity;
-			serializer.read(entity);
-			entity = entity_map.get(entity);
-			ScriptComponent* script = LUMIX_NEW(allocator, ScriptComponent)(*this, entity, allocator);
+	void setProfilerZones(ProfilerZones zones) override
+	{
+		m_profiler_zones = zones;
+		updateScriptCallHook();
+	}
+	ProfilerZones getProfilerZones() const override { return m_profiler_zones; }
+	const char* intern(StringView str);
+	const char* getProfilerName(asIScriptFunction* func);
+	void onScriptCall(asIScriptContext* ctx, asIScriptFunction* func, bool begin);
+	void updateScriptCallHook();
+	int execute(asIScriptContext* ctx);
+	int executeProfiled(asIScriptContext* ctx);
+	void setWatchdog(u32 ticks, u32 milliseconds) override;
+	u32 getWatchdogTicks() const override { return m_watchdog_ticks; }
+	u32 getWatchdogTime() const override { return m_watchdog_ms; }
+	static bool watchdogCallback(asIScriptContext* ctx, void* param);
+	void onWatchdogExpired(asIScriptContext* ctx, const char* reason);
+	int build(asIScriptModule* module, ASMemoryTag* tag);
+	bool loadFromBundle(asIScriptModule* module, const Path& path, ASMemoryTag* tag, int& result);
+	void openBundle(const char* path);
+	asIScriptContext* createContext();
+	ASMemoryTag* getMemoryTag(const Path& path);
+	void getScriptMemory(Array<ScriptMemory>& out) const override;
+	void setScriptMemoryLimit(const Path& path, u64 bytes) override;
+	const VMStats& getVMStats() const override { return m_vm_stats; }
+	void getObjectTypeCounts(Array<ObjectTypeCount>& counts) override;
+	void updateVMStats();
+	u64 countBytecodeBytes() const;
+
+	void startTrace() override { m_trace.start(); }
+	void stopTrace() override { m_trace.stop(); }
+	bool isTracing() const override { return m_trace.isEnabled(); }
+	void writeTrace(OutputMemoryStream& stream) const override { m_trace.writeJSON(stream); }
+	bool saveTrace(const char* path);
+	void writeHeapSnapshot(OutputMemoryStream& stream) override;
+	asIScriptEngine* createCompileEngine() override;
+	void destroyCompileEngine(asIScriptEngine* engine) override;
+	bool scriptSaveHeapSnapshot(const String& path);
+
+	bool isNativeCallTracingAvailable() const override;
+	void setNativeCallTracing(bool enable) override;
+	bool isNativeCallTracing() const override { return m_native_call_tracing; }
+	void setNativeTraceThreshold(u32 microseconds) override { m_native_trace_threshold = microseconds; }
+	u32 getNativeTraceThreshold() const override { return m_native_trace_threshold; }
+	void resetNativeCallStats() override;
+	void onNativeCall(asIScriptFunction* func, asIScriptContext* ctx, bool begin);
+
+	Span<const NativeCallStats> getNativeCallStats() const override
+	{
+		return Span<const NativeCallStats>(m_native_call_stats.begin(), m_native_call_stats.end());
+	}
+	bool scriptSaveTrace(const String& path);
+
+	void startSampling(u32 interval_ms) override;
+	void stopSampling() override;
+	bool isSampling() const override { return m_sampler.get() != nullptr; }
+	void clearSamples() override;
+	void sampleCallstack(asIScriptContext* ctx);
+	void drainSamples();
+	void writeFoldedStacks(OutputMemoryStream& stream) const override;
+	u32 getSampleCount() const override { return m_sample_count; }
+	u32 getDroppedSampleCount() const override { return m_dropped_samples; }
+
+	Span<const SampledStack> getSampledStacks() const override
+	{
+		return Span<const SampledStack>(m_sampled_stacks.begin(), m_sampled_stacks.end());
+	}
 
-			m_scripts.insert(script->m_entity, script);
-			int scr_count;
-			serializer.read(scr_count);
-			for (int scr_idx = 0; scr_idx < scr_count; ++scr_idx)
-			{
-				auto& scr = script->m_scripts.emplace(*script, allocator);
+	void setFunctionStatsMode(FunctionStatsMode mode) override;
+	FunctionStatsMode getFunctionStatsMode() const override { return m_function_stats_mode; }
+	void resetFunctionStats() override;
+	void publishFunctionStats();
+	u32 getFunctionStatsIndex(asIScriptFunction* func);
+	void enterFunction(asIScriptContext* ctx, asIScriptFunction* func, bool zones, bool stats);
+	void leaveFunction(asIScriptContext* ctx, bool zones, bool stats);
 
-				const char* path = serializer.readString();
-				serializer.read(scr.m_flags);
-				int prop_count;
-				serializer.read(prop_count);
-				scr.m_properties.reserve(prop_count);
-				for (int j = 0; j < prop_count; ++j)
-				{
-					Property& prop = scr.m_properties.emplace(allocator);
-					prop.type = Property::ANY;
-					serializer.read(prop.name_hash);
-					Property::Type type;
-					serializer.read(type);
-					const char* tmp = serializer.readString();
-					prop.stored_value = tmp;
-				}
-				setPath(*script, scr, Path(path));
-			}
-			m_world.onComponentCreated(script->m_entity, ANGELSCRIPT_TYPE, this);
-		}
+	Span<const FunctionStats> getFunctionStats() const override
+	{
+		const Array<FunctionStats>& stats =
+			m_function_stats_mode == FunctionStatsMode::PER_FRAME ? m_frame_function_stats : m_function_stats;
+		return Span<const FunctionStats>(stats.begin(), stats.end());
 	}
 
-	ISystem& getSystem() const override { return m_system; }
+	void registerAPI(asIScriptEngine* engine, AngelScriptWrapper::StringFactory* string_factory);
+	void registerInputAPI(asIScriptEngine* engine);
+	void registerMessageAPI(asIScriptEngine* engine);
+	void registerTimerAPI(asIScriptEngine* engine);
+	void registerWorldEventAPI(asIScriptEngine* engine);
+	void registerParallelAPI(asIScriptEngine* engine);
+	void registerResourceAPI(asIScriptEngine* engine);
+	void registerFileAPI(asIScriptEngine* engine);
+	void registerNetworkAPI(asIScriptEngine* engine);
+	void registerTraceAPI(asIScriptEngine* engine);
+
+	// Slot in m_as_resources, handles are (generation << AS_RESOURCE_INDEX_BITS) | (index + 1)
+	struct ASResourceSlot
+	{
+		Resource* resource = nullptr;
+		u32 ref_count = 0;
+		u32 generation = 1;
+		u32 next_free = 0xffFFffFF;
+	};
 
-	void update(float time_delta) override
+	static constexpr u32 AS_RESOURCE_INDEX_BITS = 20;
+	static constexpr u32 AS_RESOURCE_INDEX_MASK = (1 << AS_RESOURCE_INDEX_BITS) - 1;
+
+	// Returns index of a live slot, or -1 for invalid and stale handles
+	i32 getASResourceIndex(ASResourceHandle handle) const
 	{
-		PROFILE_FUNCTION();
-		if (!m_is_game_running) return;
-		// Update script timers, contexts, etc.
+		const u32 idx = (handle & AS_RESOURCE_INDEX_MASK) - 1;
+		if (idx >= (u32)m_as_resources.size()) return -1;
+		const ASResourceSlot& slot = m_as_resources[idx];
+		if (!slot.resource || slot.generation != (handle >> AS_RESOURCE_INDEX_BITS)) return -1;
+		return (i32)idx;
 	}
 
-	Property& getScriptProperty(EntityRef entity, int scr_index, const char* name)
+	void addASResourceRef(ASResourceHandle handle)
 	{
-		const StableHash name_hash(name);
-		ScriptComponent* script_cmp = m_scripts[entity];
-		for (auto& prop : script_cmp->m_scripts[scr_index].m_properties)
-		{
-			if (prop.name_hash == name_hash)
-			{
-				return prop;
-			}
-		}
-
-		script_cmp->m_scripts[scr_index].m_properties.emplace(m_system.m_allocator);
-		auto& prop = script_cmp->m_scripts[scr_index].m_properties.back();
-		prop.name_hash = name_hash;
-		prop.type = Property::ANY;
-		return prop;
+		const i32 idx = getASResourceIndex(handle);
+		if (idx >= 0) ++m_as_resources[idx].ref_count;
 	}
 
-	Path getScriptPath(EntityRef entity, int scr_index) override
+	// Releases one reference, the slot is freed and its generation bumped with the last one
+	void unloadASResource(ASResourceHandle handle) override
 	{
-		auto& tmp = m_scripts[entity]->m_scripts[scr_index];
-		return tmp.m_script ? tmp.m_script->getPath() : Path("");
+		const i32 idx = getASResourceIndex(handle);
+		if (idx < 0) return;
+		ASResourceSlot& slot = m_as_resources[idx];
+		if (--slot.ref_count > 0) return;
+
+		slot.resource->decRefCount();
+		slot.resource = nullptr;
+		// generation never reaches 0xfff, so no handle is equal to 0xffFFffFF
+		slot.generation = slot.generation + 1 < 0xfff ? slot.generation + 1 : 1;
+		slot.next_free = m_first_free_as_resource;
+		m_first_free_as_resource = idx;
 	}
 
-	void setPath(ScriptComponent& cmp, ScriptInstance& inst, const Path& path)
+	ASResourceHandle addASResource(const Path& path, ResourceType type) override
 	{
-		if (inst.m_script)
+		Resource* res = m_engine_ref.getResourceManager().load(type, path);
+		if (!res) return 0xffFFffFF;
+
+		u32 idx = m_first_free_as_resource;
+		if (idx != 0xffFFffFF)
 		{
-			auto& cb = inst.m_script->getObserverCb();
-			cb.unbind<&ScriptComponent::onScriptLoaded>(&cmp);
-			inst.m_script->decRefCount();
+			m_first_free_as_resource = m_as_resources[idx].next_free;
+		}
+		else
+		{
+			idx = m_as_resources.size();
+			ASSERT(idx < AS_RESOURCE_INDEX_MASK);
+			m_as_resources.emplace();
 		}
 
-		ResourceManagerHub& rm = m_system.m_engine_ref.getResourceManager();
-		inst.m_script = path.isEmpty() ? nullptr : rm.load<ASScript>(path);
-		if (inst.m_script) inst.m_script->onLoaded<&ScriptComponent::onScriptLoaded>(&cmp);
+		ASResourceSlot& slot = m_as_resources[idx];
+		slot.resource = res;
+		slot.ref_count = 1;
+		slot.next_free = 0xffFFffFF;
+		return (slot.generation << AS_RESOURCE_INDEX_BITS) | (idx + 1);
 	}
 
-	void setScriptPath(EntityRef entity, int scr_index, const Path& path) override
+	Resource* getASResource(ASResourceHandle handle) const override
 	{
-		auto* script_cmp = m_scripts[entity];
-		if (script_cmp->m_scripts.size() <= scr_index) return;
-		setPath(*script_cmp, script_cmp->m_scripts[scr_index], path);
+		const i32 idx = getASResourceIndex(handle);
+		return idx < 0 ? nullptr : m_as_resources[idx].resource;
 	}
 
-	int getScriptCount(EntityRef entity) override { return m_scripts[entity]->m_scripts.size(); }
+	void scriptResourceConstruct(ScriptResource* res) { res->handle = 0xffFFffFF; }
 
-	void insertScript(EntityRef entity, int idx) override
+	void scriptResourceLoad(ScriptResource* res, const String& path, const String& type)
 	{
-		ScriptComponent* cmp = m_scripts[entity];
-		cmp->m_scripts.emplaceAt(idx, *cmp, m_system.m_allocator);
+		res->handle = addASResource(Path(path.c_str()), ResourceType(type.c_str()));
 	}
 
-	int addScript(EntityRef entity, int scr_index) override
+	void scriptResourceCopy(ScriptResource* res, const ScriptResource& rhs)
 	{
-		ScriptComponent* script_cmp = m_scripts[entity];
-		if (scr_index == -1) scr_index = script_cmp->m_scripts.size();
-		script_cmp->m_scripts.emplaceAt(scr_index, *script_cmp, m_system.m_allocator);
-		return scr_index;
+		res->handle = rhs.handle;
+		addASResourceRef(res->handle);
 	}
 
-	void moveScript(EntityRef entity, int scr_index, bool up) override
-	{
-		auto* script_cmp = m_scripts[entity];
-		if (!up && scr_index > script_cmp->m_scripts.size() - 2) return;
-		if (up && scr_index == 0) return;
-		int other = up ? scr_index - 1 : scr_index + 1;
-		swap(script_cmp->m_scripts[scr_index], script_cmp->m_scripts[other]);
-	}
+	void scriptResourceDestruct(ScriptResource* res) { unloadASResource(res->handle); }
 
-	void enableScript(EntityRef entity, int scr_index, bool enable) override
+	ScriptResource& scriptResourceAssign(ScriptResource* res, const ScriptResource& rhs)
 	{
-		ScriptInstance& inst = m_scripts[entity]->m_scripts[scr_index];
-		setFlag(inst.m_flags, ScriptInstance::ENABLED, enable);
+		// add first, `rhs` might be the only other reference
+		addASResourceRef(rhs.handle);
+		unloadASResource(res->handle);
+		res->handle = rhs.handle;
+		return *res;
 	}
 
-	bool isScriptEnabled(EntityRef entity, int scr_index) override
+	bool scriptResourceIsValid(ScriptResource* res) { return getASResource(res->handle) != nullptr; }
+
+	bool scriptResourceIsReady(ScriptResource* res)
 	{
-		return m_scripts[entity]->m_scripts[scr_index].m_flags & ScriptInstance::ENABLED;
+		Resource* r = getASResource(res->handle);
+		return r && r->isReady();
 	}
 
-	void removeScript(EntityRef entity, int scr_index) override { m_scripts[entity]->m_scripts.swapAndPop(scr_index); }
-
-	const char* getInlineScriptCode(EntityRef entity) override { return m_inline_scripts[entity].m_source.c_str(); }
-
-	void setInlineScriptCode(EntityRef entity, const char* value) override
+	bool scriptResourceIsFailure(ScriptResource* res)
 	{
-		m_inline_scripts[entity].m_source = value;
+		Resource* r = getASResource(res->handle);
+		return !r || r->isFailure();
 	}
 
-	AngelScriptSystemImpl& m_system;
-	HashMap<EntityRef, ScriptComponent*> m_scripts;
-	HashMap<EntityRef, InlineScriptComponent> m_inline_scripts;
-	HashMap<StableHash, String> m_property_names;
-	World& m_world;
-	FunctionCall m_function_call;
-	bool m_is_game_running = false;
+	TagAllocator m_allocator;
+	// before all members that can own script memory, so tags outlive it
+	ASMemoryTag m_memory_fallback;
+	Array<UniquePtr<ASMemoryTag>> m_memory_tags;
+	HashMap<StableHash, ASMemoryTag*> m_memory_tag_map;
+	// limits set for specific paths, the rest have m_default_memory_limit
+	HashMap<StableHash, u64> m_memory_limits;
+	u64 m_default_memory_limit = 0;
+	asIScriptEngine* m_engine;
+	Engine& m_engine_ref;
+	ASScriptManager m_script_manager;
+	AngelScriptWrapper::StringFactory m_string_factory;
+	Array<ASResourceSlot> m_as_resources;
+	u32 m_first_free_as_resource = 0xffFFffFF;
+	ASInputSnapshot m_input_snapshot;
+	// incremented by every system update, m_input_snapshot is rebuilt once the frames differ
+	u32 m_frame = 0;
+	u32 m_input_snapshot_frame = 0xffFFffFF;
+	// bytecode of shipping builds, `-angelscript_bundle <path>`
+	ASBundle m_bundle;
+	Array<asIScriptContext*> m_parallel_contexts;
+	ProfilerZones m_profiler_zones = ProfilerZones::NONE;
+	HashMap<StableHash, String*> m_profiler_names;
+	UniquePtr<ScriptSampler> m_sampler;
+	Array<SampledStack> m_sampled_stacks;
+	HashMap<StableHash, u32> m_sampled_stack_indices;
+	u32 m_sample_count = 0;
+	u32 m_dropped_samples = 0;
+	// call being timed for function stats, nested execute() calls continue the stack of the caller
+	struct StatsFrame
+	{
+		asIScriptContext* ctx;
+		u32 stats;
+		u64 start;
+		u64 children;
+		// instruction counter of `ctx`
+		u64 instructions_start;
+		u64 child_instructions;
+	};
+	FunctionStatsMode m_function_stats_mode = FunctionStatsMode::DISABLED;
+	Array<FunctionStats> m_function_stats;
+	Array<FunctionStats> m_frame_function_stats;
+	Array<StatsFrame> m_stats_frames;
+	ASTrace m_trace;
+	// from -angelscript_trace, written in destructor
+	String m_trace_path;
+	struct NativeCallFrame
+	{
+		asIScriptFunction* caller;
+		u64 start;
+	};
+	bool m_native_call_tracing = false;
+	u32 m_native_trace_threshold = 100;
+	Array<NativeCallStats> m_native_call_stats;
+	// (function id << 32) | caller id
+	HashMap<u64, u32> m_native_call_indices;
+	Array<NativeCallFrame> m_native_call_frames;
+	VMStats m_vm_stats;
+	// counters of the running frame, published to m_vm_stats in update
+	VMStats m_frame_vm_stats;
+	u32 m_executing = 0;
+	// made by createContext, for VMStats
+	Mutex m_contexts_mutex;
+	Array<asIScriptContext*> m_contexts;
+	// compile engines are made on editor and compiler threads, registration is not thread safe
+	Mutex m_compile_engine_mutex;
+	// The VM calls watchdogCallback after this many calls and backward jumps, limits are checked there
+	static constexpr u32 WATCHDOG_CHECK_TICKS = 1024;
+	struct ExecutionBudget
+	{
+		u64 start;
+		u64 ticks = 0;
+		const char* expired = nullptr;
+	};
+	// 0 is unlimited
+	u32 m_watchdog_ticks = 0;
+	u32 m_watchdog_ms = 0;
+	bool m_bytecode_dirty = true;
+	u32 m_gc_destroyed_seen = 0;
+	u32 m_gc_detected_seen = 0;
+	enum VMCounter : u32
+	{
+		VM_COUNTER_CALLBACKS,
+		VM_COUNTER_SCRIPT_CALLS,
+		VM_COUNTER_NATIVE_CALLS,
+		VM_COUNTER_INSTRUCTIONS,
+		VM_COUNTER_CONTEXTS,
+		VM_COUNTER_GC_OBJECTS,
+		VM_COUNTER_BYTECODE_KB,
+		VM_COUNTER_COMPILE_MS,
+
+		VM_COUNTER_COUNT
+	};
+	u32 m_vm_counters[VM_COUNTER_COUNT];
 };
 
-AngelScriptSystemImpl::AngelScriptSystemImpl(Engine& engine)
-	: m_engine_ref(engine)
-	, m_allocator(engine.getAllocator(), "angelscript system")
-	, m_script_manager(m_allocator)
-	, m_string_factory(m_allocator)
-	, m_as_resources(m_allocator)
+struct AngelScriptModuleImpl final : AngelScriptModule
 {
-	m_engine = asCreateScriptEngine();
-	if (!m_engine)
+	struct ScriptComponent;
+
+	struct ScriptEnvironment
 	{
-		logError("Failed to create AngelScript engine");
-		return;
-	}
+		asIScriptModule* m_script_module = nullptr;
+		asIScriptContext* m_script_context = nullptr;
+	};
 
-	// Set message callback
-	m_engine->SetMessageCallback(asFUNCTION(messageCallback), nullptr, asCALL_CDECL);
+	struct ScriptInstance : ScriptEnvironment
+	{
+		enum Flags : u32
+		{
+			NONE = 0,
+			ENABLED = 1 << 0,
+			LOADED = 1 << 1,
+			MOVED_FROM = 1 << 2
+		};
 
-	// Register string factory
-	AngelScriptWrapper::registerStringType(m_engine, &m_string_factory);
+		explicit ScriptInstance(ScriptComponent& cmp, IAllocator& allocator)
+			: m_properties(allocator)
+			, m_cmp(&cmp)
+		{
+			AngelScriptModuleImpl& module = cmp.m_module;
+			asIScriptEngine* engine = module.m_system.m_engine;
 
-	// Register basic types
-	AngelScriptWrapper::registerBasicTypes(m_engine);
-	AngelScriptWrapper::registerMathTypes(m_engine);
+			// Create script module for this instance
+			static int module_counter = 0;
+			m_id = module_counter++;
+			m_module_name = StaticString<64>("ScriptInstance", m_id);
+			m_script_module = engine->GetModule(m_module_name, asGM_CREATE_IF_NOT_EXISTS);
 
-	AngelScriptWrapper::registerEntityTypes(m_engine);
+			// Create context for execution
+			m_script_context = module.m_system.createContext();
+			m_script_context->SetUserData(&cmp, CONTEXT_SCRIPT_COMPONENT);
+
+			m_flags = Flags(m_flags | ENABLED);
+		}
+
+		ScriptInstance(const ScriptInstance&) = delete;
+
+		ScriptInstance(ScriptInstance&& rhs) noexcept
+			: m_properties(rhs.m_properties.move())
+			, m_cmp(rhs.m_cmp)
+			, m_script(rhs.m_script)
+			, m_module_name(rhs.m_module_name)
+			, m_id(rhs.m_id)
+			, m_flags(rhs.m_flags)
+			, m_on_input_event(rhs.m_on_input_event)
+		{
+			m_script_module = rhs.m_script_module;
+			m_script_context = rhs.m_script_context;
+			rhs.m_script = nullptr;
+			rhs.m_script_module = nullptr;
+			rhs.m_script_context = nullptr;
+			rhs.m_flags = Flags(rhs.m_flags | MOVED_FROM);
+		}
+
+		void operator=(ScriptInstance&& rhs) noexcept
+		{
+			m_properties = rhs.m_properties.move();
+			m_script_module = rhs.m_script_module;
+			m_script_context = rhs.m_script_context;
+			m_cmp = rhs.m_cmp;
+			m_script = rhs.m_script;
+			m_module_name = rhs.m_module_name;
+			m_id = rhs.m_id;
+			m_flags = rhs.m_flags;
+			m_on_input_event = rhs.m_on_input_event;
+			rhs.m_script = nullptr;
+			rhs.m_script_module = nullptr;
+			rhs.m_script_context = nullptr;
+			rhs.m_flags = Flags(rhs.m_flags | MOVED_FROM);
+		}
+
+		~ScriptInstance()
+		{
+			if (!(m_flags & MOVED_FROM))
+			{
+				m_cmp->m_module.cancelOwnerCallbacks(m_id);
+
+				if (m_script)
+				{
+					m_script->getObserverCb().unbind<&ScriptComponent::onScriptLoaded>(m_cmp);
+					m_script->decRefCount();
+				}
+
+				if (m_script_context)
+				{
+					m_script_context->Release();
+				}
+
+				if (m_script_module)
+				{
+					m_script_module->Discard();
+				}
+			}
+		}
+
+		void onScriptUnloaded(AngelScriptModuleImpl& module,
+			struct ScriptComponent& cmp,
+			int scr_index)
+		{
+			m_on_input_event = nullptr;
+			module.cancelOwnerCallbacks(m_id);
+			if (m_script_module)
+			{
+				m_script_module->Discard();
+				m_script_module = nullptr;
+			}
+
+			// Cleanup when script is unloaded
+			m_flags = Flags(m_flags & ~LOADED);
+		}
+
+		void onScriptLoaded(AngelScriptModuleImpl& module,
+			struct ScriptComponent& cmp,
+			int scr_index)
+		{
+			if (/*!m_script_module || */ !m_script) return;
+
+			m_on_input_event = nullptr;
+			module.cancelOwnerCallbacks(m_id);
+			if (m_script_module)
+			{
+				m_script_module->Discard();
+			}
+
+			asIScriptEngine* engine = module.m_system.m_engine;
+
+			m_script_module = engine->GetModule(m_module_name, asGM_CREATE_IF_NOT_EXISTS);
+
+			bool is_reload = m_flags & LOADED;
+			module.applyScriptHeader(*this);
+
+			ASMemoryTag* memory_tag = module.m_system.getMemoryTag(m_script->getPath());
+			if (m_script_context) m_script_context->SetUserData(memory_tag, CONTEXT_MEMORY_TAG);
+
+			int r;
+			if (!module.m_system.loadFromBundle(m_script_module, m_script->getPath(), memory_tag, r))
+			{
+				// Add script section and build
+				StringView source = m_script->getSourceCode();
+				r = m_script_module->AddScriptSection(m_script->getPath().c_str(), source.begin, source.size());
+				if (r < 0)
+				{
+					logError("Failed to add script section for ", m_script->getPath());
+					return;
+				}
+				r = module.m_system.build(m_script_module, memory_tag);
+			}
+			if (r < 0)
+			{
+				logError("Failed to build script ", m_script->getPath());
+				return;
+			}
+
+			m_flags = Flags(m_flags | LOADED);
+			// the header of the compiled asset lists the callbacks, absent ones are not looked up
+			const ASScriptHeader& header = m_script->getHeader();
+			m_on_input_event = nullptr;
+			if (header.has(ASScriptHeader::ON_INPUT_EVENT))
+			{
+				m_on_input_event = m_script_module->GetFunctionByDecl("void onInputEvent(const InputEvent &in)");
+			}
+
+			// Call awake function if it exists
+			asIScriptFunction* awake_func = nullptr;
+			if (header.has(ASScriptHeader::AWAKE)) awake_func = m_script_module->GetFunctionByName("awake");
+			if (awake_func && m_script_context)
+			{
+				m_script_context->Prepare(awake_func);
+				module.m_system.execute(m_script_context);
+			}
+		}
+
+		ScriptComponent* m_cmp;
+		ASScript* m_script = nullptr;
+		StaticString<64> m_module_name;
+		u32 m_id;
+		Array<Property> m_properties;
+		Flags m_flags = Flags::NONE;
+		asIScriptFunction* m_on_input_event = nullptr;
+	};
+
+	struct InlineScriptComponent : ScriptEnvironment
+	{
+		InlineScriptComponent(EntityRef entity, AngelScriptModuleImpl& module, IAllocator& allocator)
+			: m_source(allocator)
+			, m_entity(entity)
+			, m_module(module)
+		{
+			asIScriptEngine* engine = module.m_system.m_engine;
+
+			// Create script module for this instance
+			static int module_counter = 0;
+			StaticString<64> module_name("InlineScript", module_counter++);
+			m_script_module = engine->GetModule(module_name, asGM_CREATE_IF_NOT_EXISTS);
+
+			// Create context for execution
+			m_script_context = module.m_system.createContext();
+			m_script_context->SetUserData(module.m_system.getMemoryTag(INLINE_SCRIPT_PATH), CONTEXT_MEMORY_TAG);
+		}
+
+		InlineScriptComponent(InlineScriptComponent&& rhs) noexcept
+			: m_module(rhs.m_module)
+			, m_source(rhs.m_source)
+			, m_entity(rhs.m_entity)
+		{
+			m_script_module = rhs.m_script_module;
+			m_script_context = rhs.m_script_context;
+			rhs.m_script_module = nullptr;
+			rhs.m_script_context = nullptr;
+		}
+
+		void operator=(InlineScriptComponent&& rhs) = delete;
+
+		~InlineScriptComponent()
+		{
+			if (m_script_context)
+			{
+				m_script_context->Release();
+			}
+
+			if (m_script_module)
+			{
+				m_script_module->Discard();
+			}
+		}
+
+		void compileAndRun()
+		{
+			if (!m_script_module) return;
+
+			// Add script section and build
+			int r = m_script_module->AddScriptSection("main", m_source.c_str());
+			if (r < 0)
+			{
+				logError("Failed to add script section");
+				return;
+			}
+
+			r = m_module.m_system.build(m_script_module, m_module.m_system.getMemoryTag(INLINE_SCRIPT_PATH));
+			if (r < 0)
+			{
+				logError("Failed to build script");
+				return;
+			}
+
+			// Find and execute main function
+			asIScriptFunction* func = m_script_module->GetFunctionByDecl("void main()");
+			if (func)
+			{
+				m_script_context->Prepare(func);
+				m_module.m_system.execute(m_script_context);
+			}
+		}
+
+		AngelScriptModuleImpl& m_module;
+		EntityRef m_entity;
+		String m_source;
+	};
+
+	struct ScriptComponent
+	{
+		ScriptComponent(AngelScriptModuleImpl& module, EntityRef entity, IAllocator& allocator)
+			: m_scripts(allocator)
+			, m_module(module)
+			, m_entity(entity)
+		{
+		}
+
+		void onScriptLoaded(Resource::State old_state, Resource::State new_state, Resource& resource)
+		{
+			for (int scr_index = 0, c = m_scripts.size(); scr_index < c; ++scr_index)
+			{
+				ScriptInstance& script = m_scripts[scr_index];
+
+				if (!script.m_script) continue;
+				if (script.m_script != &resource) continue;
+				if (new_state == Resource::State::READY)
+				{
+					script.onScriptLoaded(m_module, *this, scr_index);
+				}
+				else if (new_state == Resource::State::EMPTY)
+				{
+					script.onScriptUnloaded(m_module, *this, scr_index);
+				}
+			}
+		}
+
+		Array<ScriptInstance> m_scripts;
+		AngelScriptModuleImpl& m_module;
+		EntityRef m_entity;
+	};
+
+	// Resolved `on<Name>` handlers of one module, null if the module does not handle the message
+	struct MessageHandlers
+	{
+		explicit MessageHandlers(IAllocator& allocator)
+			: allocator(allocator)
+			, handlers(allocator)
+		{
+		}
+
+		IAllocator& allocator;
+		HashMap<StableHash32, asIScriptFunction*> handlers;
+	};
+
+	static void onModuleReleased(asIScriptModule* module)
+	{
+		MessageHandlers* cache = (MessageHandlers*)module->GetUserData(MODULE_MESSAGE_HANDLERS);
+		if (cache) LUMIX_DELETE(cache->allocator, cache);
+	}
+
+	// Build() of an existing module replaces its functions
+	static void resetMessageHandlers(asIScriptModule& module)
+	{
+		onModuleReleased(&module);
+		module.SetUserData(nullptr, MODULE_MESSAGE_HANDLERS);
+	}
+
+	struct QueuedMessage
+	{
+		EntityPtr sender;
+		i32 int_value;
+		float float_value;
+		Vec3 vec3_value;
+		u32 text_offset;
+		u32 text_size;
+		u32 next;
+	};
+
+	// Messages with the same receiver and name, linked through QueuedMessage::next
+	struct MessageGroup
+	{
+		EntityRef receiver;
+		StableHash32 name_hash;
+		// the name is in the arena, handlers are resolved from it on a cache miss
+		u32 name_offset;
+		u32 name_size;
+		u32 first;
+		u32 last;
+	};
+
+	// Frame-local storage, posting never allocates once the buffers have grown to the usual volume
+	struct MessageQueue
+	{
+		explicit MessageQueue(IAllocator& allocator)
+			: messages(allocator)
+			, groups(allocator)
+			, group_map(allocator)
+			, arena(allocator)
+		{
+		}
+
+		void clear()
+		{
+			messages.clear();
+			groups.clear();
+			group_map.clear();
+			arena.clear();
+		}
+
+		Array<QueuedMessage> messages;
+		Array<MessageGroup> groups;
+		HashMap<u64, u32> group_map;
+		OutputMemoryStream arena;
+	};
+
+	enum class WorldEventType : u32
+	{
+		COMPONENT_CREATED,
+		COMPONENT_DESTROYED,
+		ENTITY_DESTROYED
+	};
+
+	struct WorldEvent
+	{
+		u64 key;
+		EntityRef entity;
+	};
+
+	static constexpr u32 SUBSCRIPTION_INDEX_BITS = 20;
+	static constexpr u32 SUBSCRIPTION_INDEX_MASK = (1 << SUBSCRIPTION_INDEX_BITS) - 1;
+
+	// Subscriptions with the same key form an intrusive list starting in m_subscription_heads, subscriptions of
+	// the same owner another one starting in m_subscription_owners
+	struct WorldEventSubscription
+	{
+		u64 key;
+		asIScriptFunction* callback = nullptr;
+		ScriptComponent* cmp = nullptr;
+		u32 owner = 0;
+		u32 generation = 1;
+		u32 prev = 0xffFFffFF;
+		u32 next = 0xffFFffFF;
+		u32 owner_prev = 0xffFFffFF;
+		u32 owner_next = 0xffFFffFF;
+	};
+
+	struct DueSubscription
+	{
+		u32 idx;
+		u32 generation;
+	};
+
+	// Pending file I/O of a script instance, finished requests are called back from update
+	struct FileRequest
+	{
+		enum class Type : u8
+		{
+			READ_BYTES,
+			READ_TEXT,
+			WRITE
+		};
+
+		FileRequest(AngelScriptModuleImpl& module, u32 id, IAllocator& allocator)
+			: module(module)
+			, id(id)
+			, text(allocator)
+		{
+		}
+
+		// Content is copied straight into the script side container, which is then handed to the callback
+		void onLoaded(Span<const u8> data, bool result)
+		{
+			read_handle = FileSystem::AsyncHandle::invalid();
+			success = result;
+			if (success && type == Type::READ_TEXT)
+			{
+				text = StringView((const char*)data.begin(), data.length());
+			}
+			else if (success)
+			{
+				bytes = CScriptArray::Create(module.getByteArrayType(), data.length());
+				memcpy(bytes->GetBuffer(), data.begin(), data.length());
+			}
+			module.m_finished_file_requests.push(id);
+		}
+
+		AngelScriptModuleImpl& module;
+		u32 id;
+		Type type = Type::WRITE;
+		asIScriptFunction* callback = nullptr;
+		ScriptComponent* cmp = nullptr;
+		u32 owner = 0;
+		FileSystem::AsyncHandle read_handle = FileSystem::AsyncHandle::invalid();
+		bool success = false;
+		CScriptArray* bytes = nullptr;
+		String text;
+	};
+
+	// Script side of an ASNetwork socket, accepted connections inherit the listener's callbacks
+	struct NetworkSocket
+	{
+		asIScriptFunction* on_event;
+		asIScriptFunction* on_data;
+		ScriptComponent* cmp;
+		u32 owner;
+	};
+
+	enum class SocketType : u8
+	{
+		TCP_CONNECT,
+		TCP_LISTEN,
+		UDP
+	};
+
+	// Pending loadResourceAsync, completed in update once the resource is READY or FAILURE
+	struct ResourceLoad
+	{
+		AngelScriptSystem::ASResourceHandle handle;
+		Resource* resource;
+		asIScriptFunction* callback;
+		ScriptComponent* cmp;
+		u32 owner;
+	};
+
+	// What a handler sees, refilled for each delivered message
+	struct ScriptMessage
+	{
+		explicit ScriptMessage(IAllocator& allocator)
+			: text(allocator)
+		{
+		}
+
+		EntityRef sender;
+		i32 int_value;
+		float float_value;
+		Vec3 vec3_value;
+		String text;
+	};
+
+	struct FunctionCall : IFunctionCall
+	{
+		void add(int parameter) override
+		{
+			// TODO: Add parameter to context
+			++parameter_count;
+		}
+
+		void add(EntityPtr parameter) override
+		{
+			// TODO: Add parameter to context
+			++parameter_count;
+		}
+
+		void add(bool parameter) override
+		{
+			// TODO: Add parameter to context
+			++parameter_count;
+		}
+
+		void add(float parameter) override
+		{
+			// TODO: Add parameter to context
+			++parameter_count;
+		}
+
+		void add(void* parameter) override
+		{
+			// TODO: Add parameter to context
+			++parameter_count;
+		}
+
+		void addEnvironment(asIScriptModule* module) override
+		{
+			this->module = module;
+			++parameter_count;
+		}
+
+		World* world = nullptr;
+		int parameter_count = 0;
+		asIScriptModule* module = nullptr;
+		asIScriptContext* context = nullptr;
+		bool is_in_progress = false;
+	};
+
+public:
+	AngelScriptModuleImpl(AngelScriptSystemImpl& system, World& world)
+		: m_system(system)
+		, m_world(world)
+		, m_scripts(system.m_allocator)
+		, m_inline_scripts(system.m_allocator)
+		, m_property_names(system.m_allocator)
+		, m_message_queues{MessageQueue(system.m_allocator), MessageQueue(system.m_allocator)}
+		, m_delivered_message(system.m_allocator)
+		, m_message_receivers(system.m_allocator)
+		, m_timers(system.m_allocator)
+		, m_subscriptions(system.m_allocator)
+		, m_free_subscriptions(system.m_allocator)
+		, m_subscription_heads(system.m_allocator)
+		, m_subscription_owners(system.m_allocator)
+		, m_world_events(system.m_allocator)
+		, m_delivered_world_events(system.m_allocator)
+		, m_due_subscriptions(system.m_allocator)
+		, m_resource_loads(system.m_allocator)
+		, m_finished_resource_loads(system.m_allocator)
+		, m_file_writer(system.m_engine_ref.getFileSystem(), system.m_allocator)
+		, m_file_requests(system.m_allocator)
+		, m_file_streams(system.m_allocator)
+		, m_finished_file_requests(system.m_allocator)
+		, m_delivered_file_requests(system.m_allocator)
+		, m_file_completions(system.m_allocator)
+		, m_network_sockets(system.m_allocator)
+		, m_network_events(system.m_allocator)
+		, m_network_from(system.m_allocator)
+		, m_is_game_running(false)
+	{
+		m_function_call.is_in_progress = false;
+		m_world.componentAdded().bind<&AngelScriptModuleImpl::onComponentAdded>(this);
+		m_world.componentDestroyed().bind<&AngelScriptModuleImpl::onComponentDestroyed>(this);
+		m_world.entityDestroyed().bind<&AngelScriptModuleImpl::onEntityDestroyed>(this);
+	}
+
+	int getVersion() const override { return (int)AngelScriptModuleVersion::LATEST; }
+	const char* getName() const override { return "angelscript"; }
+
+	IFunctionCall* beginFunctionCall(const ScriptEnvironment& env, const char* function)
+	{
+		if (!env.m_script_module || !env.m_script_context) return nullptr;
+
+		asIScriptFunction* func = env.m_script_module->GetFunctionByName(function);
+		if (!func) return nullptr;
+
+		m_function_call.context = env.m_script_context;
+		m_function_call.module = env.m_script_module;
+		m_function_call.world = &m_world;
+		m_function_call.is_in_progress = true;
+		m_function_call.parameter_count = 0;
+
+		return &m_function_call;
+	}
+
+	IFunctionCall* beginFunctionCallInlineScript(EntityRef entity, const char* function) override
+	{
+		ASSERT(!m_function_call.is_in_progress);
+		auto iter = m_inline_scripts.find(entity);
+		if (!iter.isValid()) return nullptr;
+
+		InlineScriptComponent& script = iter.value();
+		return beginFunctionCall(script, function);
+	}
+
+	IFunctionCall* beginFunctionCall(EntityRef entity, int scr_index, const char* function) override
+	{
+		ASSERT(!m_function_call.is_in_progress);
+		auto iter = m_scripts.find(entity);
+		if (!iter.isValid()) return nullptr;
+
+		ScriptComponent* script_cmp = iter.value();
+		auto& script = script_cmp->m_scripts[scr_index];
+		return beginFunctionCall(script, function);
+	}
+
+	void endFunctionCall() override
+	{
+		ASSERT(m_function_call.is_in_progress);
+		m_function_call.is_in_progress = false;
+		// TODO: Execute the function call with parameters
+	}
+
+	int getPropertyCount(EntityRef entity, int scr_index) override
+	{
+		return m_scripts[entity]->m_scripts[scr_index].m_properties.size();
+	}
+
+	const char* getPropertyName(EntityRef entity, int scr_index, int prop_index) override
+	{
+		return getPropertyName(m_scripts[entity]->m_scripts[scr_index].m_properties[prop_index].name_hash);
+	}
+
+	ResourceType getPropertyResourceType(EntityRef entity, int scr_index, int prop_index) override
+	{
+		return m_scripts[entity]->m_scripts[scr_index].m_properties[prop_index].resource_type;
+	}
+
+	Property::Type getPropertyType(EntityRef entity, int scr_index, int prop_index) override
+	{
+		return m_scripts[entity]->m_scripts[scr_index].m_properties[prop_index].type;
+	}
+
+	~AngelScriptModuleImpl()
+	{
+		for (auto* script_cmp : m_scripts)
+		{
+			ASSERT(script_cmp);
+			LUMIX_DELETE(m_system.m_allocator, script_cmp);
+		}
+		for (WorldEventSubscription& sub : m_subscriptions)
+		{
+			if (sub.callback) sub.callback->Release();
+		}
+		if (m_network_data) m_network_data->Release();
+		m_world.componentAdded().unbind<&AngelScriptModuleImpl::onComponentAdded>(this);
+		m_world.componentDestroyed().unbind<&AngelScriptModuleImpl::onComponentDestroyed>(this);
+		m_world.entityDestroyed().unbind<&AngelScriptModuleImpl::onEntityDestroyed>(this);
+	}
+
+	static u64 getWorldEventKey(WorldEventType type, ComponentType cmp_type)
+	{
+		return ((u64)type << 32) | (u32)cmp_type.index;
+	}
+
+	// World callbacks only buffer events somebody subscribed to, delivery happens in update
+	void pushWorldEvent(u64 key, EntityRef entity)
+	{
+		if (!m_is_game_running) return;
+		if (!m_subscription_heads.find(key).isValid()) return;
+		m_world_events.push({key, entity});
+	}
+
+	void onComponentAdded(const ComponentUID& cmp)
+	{
+		pushWorldEvent(getWorldEventKey(WorldEventType::COMPONENT_CREATED, cmp.type), (EntityRef)cmp.entity);
+	}
+
+	void onComponentDestroyed(const ComponentUID& cmp)
+	{
+		pushWorldEvent(getWorldEventKey(WorldEventType::COMPONENT_DESTROYED, cmp.type), (EntityRef)cmp.entity);
+	}
+
+	void onEntityDestroyed(EntityRef entity)
+	{
+		pushWorldEvent(getWorldEventKey(WorldEventType::ENTITY_DESTROYED, {-1}), entity);
+	}
+
+	u32 subscribe(ScriptComponent& cmp, asIScriptContext* ctx, u64 key, asIScriptFunction* callback)
+	{
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		if (!inst)
+		{
+			callback->Release();
+			return 0;
+		}
+
+		u32 idx;
+		if (m_free_subscriptions.empty())
+		{
+			// handles store idx + 1 in SUBSCRIPTION_INDEX_BITS
+			if ((u32)m_subscriptions.size() >= SUBSCRIPTION_INDEX_MASK)
+			{
+				callback->Release();
+				return 0;
+			}
+			idx = m_subscriptions.size();
+			m_subscriptions.emplace();
+		}
+		else
+		{
+			idx = m_free_subscriptions.back();
+			m_free_subscriptions.pop();
+		}
+
+		WorldEventSubscription& sub = m_subscriptions[idx];
+		sub.key = key;
+		sub.callback = callback;
+		sub.cmp = &cmp;
+		sub.owner = inst->m_id;
+		sub.prev = 0xffFFffFF;
+		auto iter = m_subscription_heads.find(key);
+		sub.next = iter.isValid() ? iter.value() : 0xffFFffFF;
+		if (sub.next != 0xffFFffFF) m_subscriptions[sub.next].prev = idx;
+		if (iter.isValid())
+			iter.value() = idx;
+		else
+			m_subscription_heads.insert(key, idx);
+
+		auto owner_iter = m_subscription_owners.find(sub.owner);
+		sub.owner_prev = 0xffFFffFF;
+		sub.owner_next = owner_iter.isValid() ? owner_iter.value() : 0xffFFffFF;
+		if (sub.owner_next != 0xffFFffFF) m_subscriptions[sub.owner_next].owner_prev = idx;
+		if (owner_iter.isValid())
+			owner_iter.value() = idx;
+		else
+			m_subscription_owners.insert(sub.owner, idx);
+		return (sub.generation << SUBSCRIPTION_INDEX_BITS) | (idx + 1);
+	}
+
+	void unsubscribe(u32 idx)
+	{
+		WorldEventSubscription& sub = m_subscriptions[idx];
+		if (!sub.callback) return;
+		if (sub.prev != 0xffFFffFF)
+			m_subscriptions[sub.prev].next = sub.next;
+		else if (sub.next != 0xffFFffFF)
+			m_subscription_heads[sub.key] = sub.next;
+		else
+			m_subscription_heads.erase(sub.key);
+		if (sub.next != 0xffFFffFF) m_subscriptions[sub.next].prev = sub.prev;
+
+		if (sub.owner_prev != 0xffFFffFF)
+			m_subscriptions[sub.owner_prev].owner_next = sub.owner_next;
+		else if (sub.owner_next != 0xffFFffFF)
+			m_subscription_owners[sub.owner] = sub.owner_next;
+		else
+			m_subscription_owners.erase(sub.owner);
+		if (sub.owner_next != 0xffFFffFF) m_subscriptions[sub.owner_next].owner_prev = sub.owner_prev;
+
+		sub.callback->Release();
+		sub.callback = nullptr;
+		sub.cmp = nullptr;
+		sub.generation = (sub.generation + 1) & 0xfff;
+		if (sub.generation == 0) sub.generation = 1;
+		m_free_subscriptions.push(idx);
+	}
+
+	void unsubscribeHandle(u32 handle)
+	{
+		const u32 idx = (handle & SUBSCRIPTION_INDEX_MASK) - 1;
+		if (idx >= (u32)m_subscriptions.size()) return;
+		if (m_subscriptions[idx].generation != (handle >> SUBSCRIPTION_INDEX_BITS)) return;
+		unsubscribe(idx);
+	}
+
+	void unsubscribeOwner(u32 owner)
+	{
+		auto iter = m_subscription_owners.find(owner);
+		if (!iter.isValid()) return;
+		u32 idx = iter.value();
+		while (idx != 0xffFFffFF)
+		{
+			const u32 next = m_subscriptions[idx].owner_next;
+			unsubscribe(idx);
+			idx = next;
+		}
+	}
+
+	// One pass over the frame's events, each touching only the subscribers of its key
+	void deliverWorldEvents()
+	{
+		if (m_world_events.empty()) return;
+
+		PROFILE_FUNCTION();
+		m_delivered_world_events.clear();
+		swap(m_world_events, m_delivered_world_events);
+
+		for (const WorldEvent& event : m_delivered_world_events)
+		{
+			auto iter = m_subscription_heads.find(event.key);
+			if (!iter.isValid()) continue;
+
+			m_due_subscriptions.clear();
+			for (u32 idx = iter.value(); idx != 0xffFFffFF; idx = m_subscriptions[idx].next)
+			{
+				m_due_subscriptions.push({idx, m_subscriptions[idx].generation});
+			}
+
+			for (const DueSubscription& due : m_due_subscriptions)
+			{
+				const WorldEventSubscription& sub = m_subscriptions[due.idx];
+				// unsubscribed by an earlier callback
+				if (!sub.callback || sub.generation != due.generation) continue;
+
+				ScriptInstance* inst = findInstance(*sub.cmp, sub.owner);
+				if (!inst || !(inst->m_flags & ScriptInstance::ENABLED)) continue;
+				inst->m_script_context->Prepare(sub.callback);
+				inst->m_script_context->SetArgObject(0, (void*)&event.entity);
+				m_system.execute(inst->m_script_context);
+			}
+		}
+	}
+
+	// Everything a script instance registered, called before it is rebuilt or goes away
+	void cancelOwnerCallbacks(u32 owner)
+	{
+		m_timers.cancelOwner(owner);
+		unsubscribeOwner(owner);
+		cancelResourceLoads(owner);
+		cancelFileRequests(owner);
+		closeNetworkSockets(owner);
+	}
+
+	static ScriptInstance* findInstance(ScriptComponent& cmp, u32 id)
+	{
+		for (ScriptInstance& inst : cmp.m_scripts)
+		{
+			if (inst.m_id == id) return &inst;
+		}
+		return nullptr;
+	}
+
+	static ScriptInstance* getContextInstance(ScriptComponent& cmp, asIScriptContext* ctx)
+	{
+		for (ScriptInstance& inst : cmp.m_scripts)
+		{
+			if (inst.m_script_context == ctx) return &inst;
+		}
+		return nullptr;
+	}
+
+	static Property::Type getHeaderPropertyType(const String& type)
+	{
+		if (equalStrings(type.c_str(), "bool")) return Property::BOOLEAN;
+		if (equalStrings(type.c_str(), "float") || equalStrings(type.c_str(), "double")) return Property::FLOAT;
+		if (equalStrings(type.c_str(), "Entity")) return Property::ENTITY;
+		if (equalStrings(type.c_str(), "String")) return Property::STRING;
+		return Property::INT;
+	}
+
+	// Properties listed in the header exist before the module is built, so the property grid can show them.
+	// Values set by the user are kept, new properties start with the initializer from the source.
+	void applyScriptHeader(ScriptInstance& inst)
+	{
+		const ASScriptHeader& header = inst.m_script->getHeader();
+		if (!header.valid) return;
+
+		for (const ASScriptHeader::Property& header_prop : header.properties)
+		{
+			const StableHash name_hash(header_prop.name.c_str());
+			if (!m_property_names.find(name_hash).isValid())
+			{
+				m_property_names.insert(name_hash, String(StringView(header_prop.name.c_str()), m_system.m_allocator));
+			}
+
+			Property* prop = nullptr;
+			for (Property& p : inst.m_properties)
+			{
+				if (p.name_hash == name_hash) prop = &p;
+			}
+			if (!prop)
+			{
+				prop = &inst.m_properties.emplace(m_system.m_allocator);
+				prop->name_hash = name_hash;
+				prop->stored_value = header_prop.default_value;
+			}
+			prop->type = getHeaderPropertyType(header_prop.type);
+		}
+	}
+
+	const MessageStats& getMessageStats() const override { return m_message_stats; }
+
+	void postMessage(EntityPtr sender,
+		EntityRef receiver,
+		const String& name,
+		const QueuedMessage& payload,
+		StringView text)
+	{
+		const StableHash32 name_hash(name.c_str(), name.length());
+		MessageQueue& queue = m_message_queues[m_pending_queue];
+		const u32 msg_idx = queue.messages.size();
+		QueuedMessage& msg = queue.messages.emplace(payload);
+		msg.sender = sender;
+		msg.text_offset = (u32)queue.arena.size();
+		msg.text_size = text.size();
+		msg.next = 0xffFFffFF;
+		if (text.size() > 0) queue.arena.write(text.begin, text.size());
+
+		const u64 key = ((u64)(u32)receiver.index << 32) | name_hash.getHashValue();
+		auto iter = queue.group_map.find(key);
+		if (iter.isValid())
+		{
+			MessageGroup& group = queue.groups[iter.value()];
+			queue.messages[group.last].next = msg_idx;
+			group.last = msg_idx;
+		}
+		else
+		{
+			queue.group_map.insert(key, queue.groups.size());
+			MessageGroup& group = queue.groups.emplace();
+			group.receiver = receiver;
+			group.name_hash = name_hash;
+			group.name_offset = (u32)queue.arena.size();
+			group.name_size = name.length();
+			queue.arena.write(name.c_str(), name.length());
+			group.first = msg_idx;
+			group.last = msg_idx;
+		}
+		++m_message_stats.total_posted;
+	}
+
+	asIScriptFunction* getMessageHandler(asIScriptModule& module, StableHash32 name_hash, StringView name)
+	{
+		MessageHandlers* cache = (MessageHandlers*)module.GetUserData(MODULE_MESSAGE_HANDLERS);
+		if (!cache)
+		{
+			cache = LUMIX_NEW(m_system.m_allocator, MessageHandlers)(m_system.m_allocator);
+			module.SetUserData(cache, MODULE_MESSAGE_HANDLERS);
+		}
+		auto iter = cache->handlers.find(name_hash);
+		if (iter.isValid()) return iter.value();
+
+		const StaticString<128> decl("void on", name, "(const Message@)");
+		asIScriptFunction* func = module.GetFunctionByDecl(decl);
+		cache->handlers.insert(name_hash, func);
+		return func;
+	}
+
+	// Delivers everything posted during the previous frame, grouped by receiver and message name,
+	// messages posted by handlers are delivered next frame
+	void deliverMessages()
+	{
+		MessageQueue& queue = m_message_queues[m_pending_queue];
+		m_pending_queue = 1 - m_pending_queue;
+		m_message_queues[m_pending_queue].clear();
+
+		MessageStats& stats = m_message_stats;
+		stats.posted = queue.messages.size();
+		stats.groups = queue.groups.size();
+		stats.arena_bytes = (u32)queue.arena.size();
+		stats.delivered = 0;
+		stats.dropped = 0;
+		if (queue.messages.empty()) return;
+
+		PROFILE_FUNCTION();
+		const char* arena = (const char*)queue.arena.data();
+		ScriptMessage& view = m_delivered_message;
+		for (const MessageGroup& group : queue.groups)
+		{
+			u32 group_size = 0;
+			for (u32 i = group.first; i != 0xffFFffFF; i = queue.messages[i].next) ++group_size;
+
+			auto iter = m_scripts.find(group.receiver);
+			if (!iter.isValid())
+			{
+				stats.dropped += group_size;
+				continue;
+			}
+
+			// handlers can destroy the receiver or change its scripts, instances are found again before each call
+			m_message_receivers.clear();
+			for (const ScriptInstance& inst : iter.value()->m_scripts) m_message_receivers.push(inst.m_id);
+
+			// delivery to an instance can stop partway, each instance receives a prefix of the group
+			const StringView name(arena + group.name_offset, group.name_size);
+			u32 handled = 0;
+			for (u32 id : m_message_receivers)
+			{
+				u32 received = 0;
+				for (u32 i = group.first; i != 0xffFFffFF; i = queue.messages[i].next)
+				{
+					auto cmp_iter = m_scripts.find(group.receiver);
+					ScriptInstance* inst = cmp_iter.isValid() ? findInstance(*cmp_iter.value(), id) : nullptr;
+					if (!inst || !inst->m_script || !(inst->m_flags & ScriptInstance::LOADED)) break;
+					if (!(inst->m_flags & ScriptInstance::ENABLED)) break;
+
+					asIScriptFunction* handler = getMessageHandler(*inst->m_script_module, group.name_hash, name);
+					if (!handler) break;
+
+					++received;
+					const QueuedMessage& msg = queue.messages[i];
+					view.sender = EntityRef{msg.sender.index};
+					view.int_value = msg.int_value;
+					view.float_value = msg.float_value;
+					view.vec3_value = msg.vec3_value;
+					view.text = StringView(arena + msg.text_offset, msg.text_size);
+					inst->m_script_context->Prepare(handler);
+					inst->m_script_context->SetArgObject(0, &view);
+					m_system.execute(inst->m_script_context);
+				}
+				handled = maximum(handled, received);
+			}
+			stats.delivered += handled;
+			stats.dropped += group_size - handled;
+		}
+		stats.total_delivered += stats.delivered;
+		stats.total_dropped += stats.dropped;
+	}
+
+	bool execute(EntityRef entity, i32 scr_index, StringView code) override
+	{
+		const ScriptInstance& script = m_scripts[entity]->m_scripts[scr_index];
+
+		if (!script.m_script_module || !script.m_script_context) return false;
+
+		// Add code as script section and build
+		int r = script.m_script_module->AddScriptSection("temp", code.begin, code.size());
+		if (r < 0) return false;
+
+		resetMessageHandlers(*script.m_script_module);
+
+		r = m_system.build(
+			script.m_script_module, (ASMemoryTag*)script.m_script_context->GetUserData(CONTEXT_MEMORY_TAG));
+		if (r < 0) return false;
+
+		// Execute main function if it exists
+		asIScriptFunction* func = script.m_script_module->GetFunctionByDecl("void main()");
+		if (func)
+		{
+			script.m_script_context->Prepare(func);
+			r = m_system.execute(script.m_script_context);
+			return r == asEXECUTION_FINISHED;
+		}
+
+		return true;
+	}
+
+	asIScriptContext* getContext(EntityRef entity, int scr_index) override
+	{
+		return m_scripts[entity]->m_scripts[scr_index].m_script_context;
+	}
+
+	asIScriptModule* getScriptModule(EntityRef entity, int scr_index) override
+	{
+		return m_scripts[entity]->m_scripts[scr_index].m_script_module;
+	}
+
+	World& getWorld() override { return m_world; }
+
+	void startGame() override { m_is_game_running = true; }
+
+	void stopGame() override { m_is_game_running = false; }
+
+	void createInlineScriptComponent(EntityRef entity)
+	{
+		m_inline_scripts.insert(entity, InlineScriptComponent(entity, *this, m_system.m_allocator));
+		m_world.onComponentCreated(entity, ANGELSCRIPT_INLINE_TYPE, this);
+	}
+
+	void destroyInlineScriptComponent(EntityRef entity)
+	{
+		m_inline_scripts.erase(entity);
+		m_world.onComponentDestroyed(entity, ANGELSCRIPT_INLINE_TYPE, this);
+	}
+
+	void createScriptComponent(EntityRef entity)
+	{
+		auto& allocator = m_system.m_allocator;
+		ScriptComponent* script = LUMIX_NEW(allocator, ScriptComponent)(*this, entity, allocator);
+		m_scripts.insert(entity, script);
+		m_world.onComponentCreated(entity, ANGELSCRIPT_TYPE, this);
+	}
+
+	void destroyScriptComponent(EntityRef entity)
+	{
+		ScriptComponent* cmp = m_scripts[entity];
+		LUMIX_DELETE(m_system.m_allocator, cmp);
+		m_scripts.erase(entity);
+		m_world.onComponentDestroyed(entity, ANGELSCRIPT_TYPE, this);
+	}
+
+	void setPropertyValue(EntityRef entity, int scr_index, const char* name, const char* value) override
+	{
+		auto* script_cmp = m_scripts[entity];
+		if (!script_cmp) return;
+		Property& prop = getScriptProperty(entity, scr_index, name);
+		prop.stored_value = value;
+	}
+
+	void getPropertyValue(EntityRef entity, int scr_index, const char* property_name, Span<char> out) override
+	{
+		ASSERT(out.length() > 0);
+
+		const StableHash hash(property_name);
+		auto& inst = m_scripts[entity]->m_scripts[scr_index];
+		for (auto& prop : inst.m_properties)
+		{
+			if (prop.name_hash == hash)
+			{
+				copyString(out, prop.stored_value);
+				return;
+			}
+		}
+		out[0] = '\0';
+	}
+
+	const char* getPropertyName(StableHash name_hash) const
+	{
+		auto iter = m_property_names.find(name_hash);
+		if (iter.isValid()) return iter.value().c_str();
+		return "N/A";
+	}
+
+	void serialize(OutputMemoryStream& serializer) override
+	{
+		serializer.write(m_inline_scripts.size());
+		for (auto iter : m_inline_scripts.iterated())
+		{
+			serializer.write(iter.key());
+			serializer.write(iter.value().m_source);
+		}
+
+		serializer.write(m_scripts.size());
+		for (ScriptComponent* script_cmp : m_scripts)
+		{
+			serializer.write(script_cmp->m_entity);
+			serializer.write(script_cmp->m_scripts.size());
+			for (auto& scr : script_cmp->m_scripts)
+			{
+				serializer.writeString(scr.m_script ? scr.m_script->getPath() : Path());
+				serializer.write(scr.m_flags);
+				serializer.write(scr.m_properties.size());
+				for (Property& prop : scr.m_properties)
+				{
+					serializer.write(prop.name_hash);
+					serializer.write(prop.type);
+					serializer.writeString(prop.stored_value);
+				}
+			}
+		}
+	}
+
+	void deserialize(InputMemoryStream& serializer, const EntityMap& entity_map, i32 version) override
+	{
+		const i32 inline_len = serializer.read<i32>();
+		m_inline_scripts.reserve(inline_len);
+		for (int i = 0; i < inline_len; ++i)
+		{
+			EntityRef entity;
+			serializer.read(entity);
+			entity = entity_map.get(entity);
+			auto iter = m_inline_scripts.insert(entity, InlineScriptComponent(entity, *this, m_system.m_allocator));
+			serializer.read(iter.value().m_source);
+			m_world.onComponentCreated(entity, ANGELSCRIPT_INLINE_TYPE, this);
+		}
+
+		int len = serializer.read<int>();
+		m_scripts.reserve(len + m_scripts.size());
+		for (int i = 0; i < len; ++i)
+		{
+			auto& allocator = m_system.m_allocator;
+			EntityRef entity;
+			serializer.read(entity);
+			entity = entity_map.get(entity);
+			ScriptComponent* script = LUMIX_NEW(allocator, ScriptComponent)(*this, entity, allocator);
+
+			m_scripts.insert(script->m_entity, script);
+			int scr_count;
+			serializer.read(scr_count);
+			for (int scr_idx = 0; scr_idx < scr_count; ++scr_idx)
+			{
+				auto& scr = script->m_scripts.emplace(*script, allocator);
+
+				const char* path = serializer.readString();
+				serializer.read(scr.m_flags);
+				int prop_count;
+				serializer.read(prop_count);
+				scr.m_properties.reserve(prop_count);
+				for (int j = 0; j < prop_count; ++j)
+				{
+					Property& prop = scr.m_properties.emplace(allocator);
+					prop.type = Property::ANY;
+					serializer.read(prop.name_hash);
+					Property::Type type;
+					serializer.read(type);
+					const char* tmp = serializer.readString();
+					prop.stored_value = tmp;
+				}
+				setPath(*script, scr, Path(path));
+			}
+			m_world.onComponentCreated(script->m_entity, ANGELSCRIPT_TYPE, this);
+		}
+	}
+
+	ISystem& getSystem() const override { return m_system; }
+
+	void update(float time_delta) override
+	{
+		PROFILE_FUNCTION();
+		if (!m_is_game_running) return;
+		dispatchInputEvents();
+		deliverMessages();
+		deliverWorldEvents();
+		deliverResourceLoads();
+		deliverFileRequests();
+		updateNetwork();
+		updateTimers(time_delta);
+	}
+
+	// Takes ownership of the callbacks, returns socket 0 on failure
+	u32 openNetworkSocket(ScriptComponent& cmp,
+		asIScriptContext* ctx,
+		SocketType type,
+		const char* ip,
+		u16 port,
+		asIScriptFunction* on_event,
+		asIScriptFunction* on_data)
+	{
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		u32 socket = 0;
+		if (inst)
+		{
+			if (!m_network) m_network = ASNetwork::create(m_system.m_allocator);
+			switch (type)
+			{
+				case SocketType::TCP_CONNECT: socket = m_network->connect(ip, port); break;
+				case SocketType::TCP_LISTEN: socket = m_network->listen(ip, port); break;
+				case SocketType::UDP: socket = m_network->openUDP(ip, port); break;
+			}
+		}
+		if (!socket)
+		{
+			if (on_event) on_event->Release();
+			if (on_data) on_data->Release();
+			return 0;
+		}
+		m_network_sockets.insert(socket, {on_event, on_data, &cmp, inst->m_id});
+		return socket;
+	}
+
+	void releaseNetworkSocket(u32 socket)
+	{
+		auto iter = m_network_sockets.find(socket);
+		if (!iter.isValid()) return;
+		if (iter.value().on_event) iter.value().on_event->Release();
+		if (iter.value().on_data) iter.value().on_data->Release();
+		m_network_sockets.erase(iter);
+	}
+
+	// Scripts can use only the sockets they opened or accepted
+	bool isNetworkSocketOwner(ScriptComponent& cmp, asIScriptContext* ctx, u32 socket)
+	{
+		auto iter = m_network_sockets.find(socket);
+		if (!iter.isValid()) return false;
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		return inst && iter.value().cmp == &cmp && iter.value().owner == inst->m_id;
+	}
+
+	void closeNetworkSocket(u32 socket)
+	{
+		if (!m_network_sockets.find(socket).isValid()) return;
+		m_network->close(socket);
+		releaseNetworkSocket(socket);
+	}
+
+	void closeNetworkSockets(u32 owner)
+	{
+		if (m_network_sockets.empty()) return;
+		Array<u32> sockets(m_system.m_allocator);
+		for (auto iter : m_network_sockets.iterated())
+		{
+			if (iter.value().owner == owner) sockets.push(iter.key());
+		}
+		for (u32 socket : sockets)
+		{
+			closeNetworkSocket(socket);
+		}
+	}
+
+	// The same array is handed to every data callback unless a script kept a reference to it
+	CScriptArray* getNetworkData(Span<const u8> data)
+	{
+		if (!m_network_data || m_network_data->GetRefCount() > 1)
+		{
+			if (m_network_data) m_network_data->Release();
+			m_network_data = CScriptArray::Create(getByteArrayType(), 0);
+		}
+		m_network_data->Resize(data.length());
+		if (data.length() > 0) memcpy(m_network_data->GetBuffer(), data.begin(), data.length());
+		return m_network_data;
+	}
+
+	// Readiness of all sockets is checked once per frame, then events are dispatched in the order they happened
+	void updateNetwork()
+	{
+		if (m_network_sockets.empty()) return;
+
+		PROFILE_FUNCTION();
+		m_network->poll(m_network_events);
+		for (const ASNetwork::Event& event : m_network_events)
+		{
+			// closed by an earlier callback
+			auto iter = m_network_sockets.find(event.socket);
+			if (!iter.isValid()) continue;
+
+			const NetworkSocket socket = iter.value();
+			if (event.type == ASNetwork::EventType::ACCEPTED)
+			{
+				if (socket.on_event) socket.on_event->AddRef();
+				if (socket.on_data) socket.on_data->AddRef();
+				m_network_sockets.insert(event.peer, socket);
+			}
+
+			ScriptInstance* inst = findInstance(*socket.cmp, socket.owner);
+			asIScriptContext* ctx = inst ? inst->m_script_context : nullptr;
+			if (ctx && event.type == ASNetwork::EventType::DATA && socket.on_data)
+			{
+				const u32 ip = event.from_ip;
+				const StaticString<16> from(ip >> 24, ".", (ip >> 16) & 0xff, ".", (ip >> 8) & 0xff, ".", ip & 0xff);
+				m_network_from = event.from_port ? from.data : "";
+				ctx->Prepare(socket.on_data);
+				ctx->SetArgDWord(0, event.socket);
+				ctx->SetArgObject(1, getNetworkData(m_network->getData(event)));
+				ctx->SetArgAddress(2, &m_network_from);
+				ctx->SetArgWord(3, event.from_port);
+				m_system.execute(ctx);
+			}
+			else if (ctx && event.type != ASNetwork::EventType::DATA && socket.on_event)
+			{
+				ctx->Prepare(socket.on_event);
+				ctx->SetArgDWord(0, event.socket);
+				ctx->SetArgDWord(1, (u32)event.type);
+				ctx->SetArgDWord(2, event.peer);
+				m_system.execute(ctx);
+			}
+
+			// the socket is already destroyed by ASNetwork
+			if (event.type == ASNetwork::EventType::CLOSED || event.type == ASNetwork::EventType::FAILURE)
+			{
+				releaseNetworkSocket(event.socket);
+			}
+		}
+	}
+
+	asITypeInfo* getByteArrayType()
+	{
+		if (!m_byte_array_type) m_byte_array_type = m_system.m_engine->GetTypeInfoByDecl("array<uint8>");
+		return m_byte_array_type;
+	}
+
+	u32 newFileId()
+	{
+		++m_last_file_id;
+		if (m_last_file_id == 0) ++m_last_file_id;
+		return m_last_file_id;
+	}
+
+	// Takes ownership of `callback`, returns nullptr if not called by a script instance
+	FileRequest* createFileRequest(ScriptComponent& cmp,
+		asIScriptContext* ctx,
+		FileRequest::Type type,
+		asIScriptFunction* callback)
+	{
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		if (!inst)
+		{
+			callback->Release();
+			return nullptr;
+		}
+
+		FileRequest* req = LUMIX_NEW(m_system.m_allocator, FileRequest)(*this, newFileId(), m_system.m_allocator);
+		req->type = type;
+		req->callback = callback;
+		req->cmp = &cmp;
+		req->owner = inst->m_id;
+		m_file_requests.insert(req->id, req);
+		return req;
+	}
+
+	void destroyFileRequest(FileRequest* req)
+	{
+		if (req->read_handle.isValid()) m_system.m_engine_ref.getFileSystem().cancel(req->read_handle);
+		if (req->bytes) req->bytes->Release();
+		req->callback->Release();
+		m_file_requests.erase(req->id);
+		LUMIX_DELETE(m_system.m_allocator, req);
+	}
+
+	void readFile(ScriptComponent& cmp,
+		asIScriptContext* ctx,
+		const Path& path,
+		FileRequest::Type type,
+		asIScriptFunction* callback)
+	{
+		FileRequest* req = createFileRequest(cmp, ctx, type, callback);
+		if (!req) return;
+		req->read_handle =
+			m_system.m_engine_ref.getFileSystem().getContent(path, makeDelegate<&FileRequest::onLoaded>(req));
+	}
+
+	void writeFile(ScriptComponent& cmp,
+		asIScriptContext* ctx,
+		AsyncFileWriter::Op op,
+		const Path& path,
+		Span<const u8> data,
+		asIScriptFunction* callback)
+	{
+		u32 id = 0;
+		if (callback)
+		{
+			FileRequest* req = createFileRequest(cmp, ctx, FileRequest::Type::WRITE, callback);
+			if (!req) return;
+			id = req->id;
+		}
+		m_file_writer.push(op, id, 0, path, data);
+	}
+
+	// Streams stay open on the writer until closed by the script or its instance goes away
+	u32 openFileStream(ScriptComponent& cmp, asIScriptContext* ctx, const Path& path)
+	{
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		if (!inst) return 0;
+		const u32 stream = newFileId();
+		m_file_streams.insert(stream, inst->m_id);
+		m_file_writer.push(AsyncFileWriter::Op::STREAM_OPEN, 0, stream, path, {});
+		return stream;
+	}
+
+	void writeFileStream(u32 stream, Span<const u8> data)
+	{
+		if (!m_file_streams.find(stream).isValid()) return;
+		m_file_writer.push(AsyncFileWriter::Op::STREAM_WRITE, 0, stream, Path(), data);
+	}
+
+	void closeFileStream(ScriptComponent& cmp, asIScriptContext* ctx, u32 stream, asIScriptFunction* callback)
+	{
+		auto iter = m_file_streams.find(stream);
+		if (!iter.isValid())
+		{
+			if (callback) callback->Release();
+			return;
+		}
+		m_file_streams.erase(iter);
+
+		u32 id = 0;
+		if (callback)
+		{
+			FileRequest* req = createFileRequest(cmp, ctx, FileRequest::Type::WRITE, callback);
+			if (req) id = req->id;
+		}
+		m_file_writer.push(AsyncFileWriter::Op::STREAM_CLOSE, id, stream, Path(), {});
+	}
+
+	// Queued writes are still written, only their callbacks are dropped
+	void cancelFileRequests(u32 owner)
+	{
+		Array<FileRequest*> cancelled(m_system.m_allocator);
+		for (FileRequest* req : m_file_requests)
+		{
+			if (req->owner == owner) cancelled.push(req);
+		}
+		for (FileRequest* req : cancelled)
+		{
+			destroyFileRequest(req);
+		}
+
+		Array<u32> streams(m_system.m_allocator);
+		for (auto iter : m_file_streams.iterated())
+		{
+			if (iter.value() == owner) streams.push(iter.key());
+		}
+		for (u32 stream : streams)
+		{
+			m_file_streams.erase(stream);
+			m_file_writer.push(AsyncFileWriter::Op::STREAM_CLOSE, 0, stream, Path(), {});
+		}
+	}
+
+	void deliverFileRequests()
+	{
+		m_file_writer.popCompletions(m_file_completions);
+		for (const AsyncFileWriter::Completion& completion : m_file_completions)
+		{
+			auto iter = m_file_requests.find(completion.id);
+			if (!iter.isValid()) continue;
+			iter.value()->success = completion.success;
+			m_finished_file_requests.push(completion.id);
+		}
+		m_file_completions.clear();
+		if (m_finished_file_requests.empty()) return;
+
+		PROFILE_FUNCTION();
+		// requests started by the callbacks are delivered next frame
+		m_delivered_file_requests.clear();
+		swap(m_finished_file_requests, m_delivered_file_requests);
+		for (u32 id : m_delivered_file_requests)
+		{
+			// cancelled by an earlier callback
+			auto iter = m_file_requests.find(id);
+			if (!iter.isValid()) continue;
+
+			FileRequest* req = iter.value();
+			ScriptInstance* inst = findInstance(*req->cmp, req->owner);
+			if (inst)
+			{
+				asIScriptContext* ctx = inst->m_script_context;
+				ctx->Prepare(req->callback);
+				ctx->SetArgByte(0, req->success);
+				if (req->type == FileRequest::Type::READ_TEXT)
+					ctx->SetArgAddress(1, &req->text);
+				else if (req->type == FileRequest::Type::READ_BYTES)
+					ctx->SetArgObject(1, req->bytes);
+				m_system.execute(ctx);
+			}
+			destroyFileRequest(req);
+		}
+	}
+
+	u32 loadResourceAsync(ScriptComponent& cmp,
+		asIScriptContext* ctx,
+		const Path& path,
+		ResourceType type,
+		asIScriptFunction* callback)
+	{
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		const AngelScriptSystem::ASResourceHandle handle = inst ? m_system.addASResource(path, type) : 0xffFFffFF;
+		Resource* res = m_system.getASResource(handle);
+		if (!res)
+		{
+			callback->Release();
+			return 0xffFFffFF;
+		}
+
+		ResourceLoad& load = m_resource_loads.emplace();
+		load.handle = handle;
+		load.resource = res;
+		load.callback = callback;
+		load.cmp = &cmp;
+		load.owner = inst->m_id;
+		res->getObserverCb().bind<&AngelScriptModuleImpl::onAsyncResourceStateChanged>(this);
+		// already loaded resources are reported at the frame boundary as well
+		if (!res->isEmpty()) m_has_finished_resource_loads = true;
+		return handle;
+	}
+
+	void onAsyncResourceStateChanged(Resource::State old_state, Resource::State new_state, Resource& resource)
+	{
+		if (new_state != Resource::State::EMPTY) m_has_finished_resource_loads = true;
+	}
+
+	// Unfinished loads own their resource handle, it is released together with the callback
+	void cancelResourceLoads(u32 owner)
+	{
+		for (i32 i = m_resource_loads.size() - 1; i >= 0; --i)
+		{
+			ResourceLoad& load = m_resource_loads[i];
+			if (load.owner != owner) continue;
+			load.resource->getObserverCb().unbind<&AngelScriptModuleImpl::onAsyncResourceStateChanged>(this);
+			load.callback->Release();
+			m_system.unloadASResource(load.handle);
+			m_resource_loads.swapAndPop(i);
+		}
+		for (i32 i = m_finished_resource_loads.size() - 1; i >= 0; --i)
+		{
+			ResourceLoad& load = m_finished_resource_loads[i];
+			if (load.owner != owner) continue;
+			load.callback->Release();
+			m_system.unloadASResource(load.handle);
+			m_finished_resource_loads.swapAndPop(i);
+		}
+	}
+
+	// Observers only raise a flag, all loads finished since the last frame are collected and called back here
+	void deliverResourceLoads()
+	{
+		if (!m_has_finished_resource_loads) return;
+
+		PROFILE_FUNCTION();
+		m_has_finished_resource_loads = false;
+		for (i32 i = m_resource_loads.size() - 1; i >= 0; --i)
+		{
+			ResourceLoad& load = m_resource_loads[i];
+			if (load.resource->isEmpty()) continue;
+			load.resource->getObserverCb().unbind<&AngelScriptModuleImpl::onAsyncResourceStateChanged>(this);
+			m_finished_resource_loads.push(load);
+			m_resource_loads.swapAndPop(i);
+		}
+
+		// a callback can destroy other instances, cancelResourceLoads removes their loads from this list
+		while (!m_finished_resource_loads.empty())
+		{
+			const ResourceLoad load = m_finished_resource_loads.back();
+			m_finished_resource_loads.pop();
+
+			// the handle belongs to the script from now on
+			ScriptInstance* inst = findInstance(*load.cmp, load.owner);
+			if (inst)
+			{
+				inst->m_script_context->Prepare(load.callback);
+				inst->m_script_context->SetArgDWord(0, load.handle);
+				inst->m_script_context->SetArgByte(1, load.resource->isReady());
+				m_system.execute(inst->m_script_context);
+			}
+			else
+			{
+				m_system.unloadASResource(load.handle);
+			}
+			load.callback->Release();
+		}
+	}
+
+	void updateTimers(float time_delta)
+	{
+		PROFILE_FUNCTION();
+		m_timers.advance(time_delta, [this](asIScriptFunction* callback, void* user, u32 owner) {
+			ScriptInstance* inst = findInstance(*(ScriptComponent*)user, owner);
+			// timers of removed instances are cancelled, this one is only disabled
+			if (!inst || !(inst->m_flags & ScriptInstance::ENABLED)) return false;
+			inst->m_script_context->Prepare(callback);
+			m_system.execute(inst->m_script_context);
+			return true;
+		});
+	}
+
+	u32 addTimer(ScriptComponent& cmp, asIScriptContext* ctx, asIScriptFunction* callback, float delay, bool repeat)
+	{
+		ScriptInstance* inst = getContextInstance(cmp, ctx);
+		if (!inst)
+		{
+			callback->Release();
+			return 0;
+		}
+		return m_timers.add(callback, &cmp, inst->m_id, delay, repeat);
+	}
+
+	// Delivers the whole frame's input to every instance defining onInputEvent in a single pass
+	void dispatchInputEvents()
+	{
+		const ASInputSnapshot& input = m_system.getInputSnapshot();
+		if (input.events.empty()) return;
+
+		PROFILE_FUNCTION();
+		for (ScriptComponent* cmp : m_scripts)
+		{
+			for (ScriptInstance& inst : cmp->m_scripts)
+			{
+				if (!inst.m_on_input_event || !(inst.m_flags & ScriptInstance::ENABLED)) continue;
+
+				asIScriptContext* ctx = inst.m_script_context;
+				for (const ASInputEvent& event : input.events)
+				{
+					ctx->Prepare(inst.m_on_input_event);
+					ctx->SetArgAddress(0, (void*)&event);
+					m_system.execute(ctx);
+				}
+			}
+		}
+	}
+
+	Property& getScriptProperty(EntityRef entity, int scr_index, const char* name)
+	{
+		const StableHash name_hash(name);
+		ScriptComponent* script_cmp = m_scripts[entity];
+		for (auto& prop : script_cmp->m_scripts[scr_index].m_properties)
+		{
+			if (prop.name_hash == name_hash)
+			{
+				return prop;
+			}
+		}
+
+		script_cmp->m_scripts[scr_index].m_properties.emplace(m_system.m_allocator);
+		auto& prop = script_cmp->m_scripts[scr_index].m_properties.back();
+		prop.name_hash = name_hash;
+		prop.type = Property::ANY;
+		return prop;
+	}
+
+	Path getScriptPath(EntityRef entity, int scr_index) override
+	{
+		auto& tmp = m_scripts[entity]->m_scripts[scr_index];
+		return tmp.m_script ? tmp.m_script->getPath() : Path("");
+	}
+
+	void setPath(ScriptComponent& cmp, ScriptInstance& inst, const Path& path)
+	{
+		if (inst.m_script)
+		{
+			auto& cb = inst.m_script->getObserverCb();
+			cb.unbind<&ScriptComponent::onScriptLoaded>(&cmp);
+			inst.m_script->decRefCount();
+		}
+
+		ResourceManagerHub& rm = m_system.m_engine_ref.getResourceManager();
+		inst.m_script = path.isEmpty() ? nullptr : rm.load<ASScript>(path);
+		if (inst.m_script) inst.m_script->onLoaded<&ScriptComponent::onScriptLoaded>(&cmp);
+	}
+
+	void setScriptPath(EntityRef entity, int scr_index, const Path& path) override
+	{
+		auto* script_cmp = m_scripts[entity];
+		if (script_cmp->m_scripts.size() <= scr_index) return;
+		setPath(*script_cmp, script_cmp->m_scripts[scr_index], path);
+	}
+
+	int getScriptCount(EntityRef entity) override { return m_scripts[entity]->m_scripts.size(); }
+
+	void insertScript(EntityRef entity, int idx) override
+	{
+		ScriptComponent* cmp = m_scripts[entity];
+		cmp->m_scripts.emplaceAt(idx, *cmp, m_system.m_allocator);
+	}
+
+	int addScript(EntityRef entity, int scr_index) override
+	{
+		ScriptComponent* script_cmp = m_scripts[entity];
+		if (scr_index == -1) scr_index = script_cmp->m_scripts.size();
+		script_cmp->m_scripts.emplaceAt(scr_index, *script_cmp, m_system.m_allocator);
+		return scr_index;
+	}
+
+	void moveScript(EntityRef entity, int scr_index, bool up) override
+	{
+		auto* script_cmp = m_scripts[entity];
+		if (!up && scr_index > script_cmp->m_scripts.size() - 2) return;
+		if (up && scr_index == 0) return;
+		int other = up ? scr_index - 1 : scr_index + 1;
+		swap(script_cmp->m_scripts[scr_index], script_cmp->m_scripts[other]);
+	}
+
+	void enableScript(EntityRef entity, int scr_index, bool enable) override
+	{
+		ScriptInstance& inst = m_scripts[entity]->m_scripts[scr_index];
+		setFlag(inst.m_flags, ScriptInstance::ENABLED, enable);
+		if (enable) m_timers.resumeOwner(inst.m_id);
+	}
+
+	bool isScriptEnabled(EntityRef entity, int scr_index) override
+	{
+		return m_scripts[entity]->m_scripts[scr_index].m_flags & ScriptInstance::ENABLED;
+	}
+
+	void removeScript(EntityRef entity, int scr_index) override
+	{
+		Array<ScriptInstance>& scripts = m_scripts[entity]->m_scripts;
+		// explicitly, the removed slot is reused by the moved last instance
+		cancelOwnerCallbacks(scripts[scr_index].m_id);
+		scripts.swapAndPop(scr_index);
+	}
+
+	const char* getInlineScriptCode(EntityRef entity) override { return m_inline_scripts[entity].m_source.c_str(); }
+
+	void setInlineScriptCode(EntityRef entity, const char* value) override
+	{
+		m_inline_scripts[entity].m_source = value;
+	}
+
+	AngelScriptSystemImpl& m_system;
+	HashMap<EntityRef, ScriptComponent*> m_scripts;
+	HashMap<EntityRef, InlineScriptComponent> m_inline_scripts;
+	HashMap<StableHash, String> m_property_names;
+	MessageQueue m_message_queues[2];
+	u32 m_pending_queue = 0;
+	ScriptMessage m_delivered_message;
+	// instance ids of the receiver being delivered to
+	Array<u32> m_message_receivers;
+	MessageStats m_message_stats;
+	TimerWheel m_timers;
+	Array<WorldEventSubscription> m_subscriptions;
+	Array<u32> m_free_subscriptions;
+	HashMap<u64, u32> m_subscription_heads;
+	HashMap<u32, u32> m_subscription_owners;
+	Array<WorldEvent> m_world_events;
+	Array<WorldEvent> m_delivered_world_events;
+	Array<DueSubscription> m_due_subscriptions;
+	Array<ResourceLoad> m_resource_loads;
+	Array<ResourceLoad> m_finished_resource_loads;
+	bool m_has_finished_resource_loads = false;
+	AsyncFileWriter m_file_writer;
+	HashMap<u32, FileRequest*> m_file_requests;
+	HashMap<u32, u32> m_file_streams; // stream -> owner
+	Array<u32> m_finished_file_requests;
+	Array<u32> m_delivered_file_requests;
+	Array<AsyncFileWriter::Completion> m_file_completions;
+	u32 m_last_file_id = 0;
+	asITypeInfo* m_byte_array_type = nullptr;
+	UniquePtr<ASNetwork> m_network;
+	HashMap<u32, NetworkSocket> m_network_sockets;
+	Array<ASNetwork::Event> m_network_events;
+	CScriptArray* m_network_data = nullptr;
+	String m_network_from;
+	World& m_world;
+	FunctionCall m_function_call;
+	bool m_is_game_running = false;
+};
+
+static void onContextReleased(asIScriptContext* ctx)
+{
+	AngelScriptSystemImpl* system = (AngelScriptSystemImpl*)ctx->GetUserData(CONTEXT_SYSTEM);
+	MutexGuard guard(system->m_contexts_mutex);
+	system->m_contexts.swapAndPop(system->m_contexts.indexOf(ctx));
+}
+
+AngelScriptSystemImpl::AngelScriptSystemImpl(Engine& engine)
+	: m_engine_ref(engine)
+	, m_allocator(engine.getAllocator(), "angelscript system")
+	, m_memory_fallback(m_allocator, Path("angelscript"))
+	, m_memory_tags(m_allocator)
+	, m_memory_tag_map(m_allocator)
+	, m_memory_limits(m_allocator)
+	, m_script_manager(m_bundle, m_allocator)
+	, m_string_factory(m_allocator, getASScopedAllocator())
+	, m_as_resources(m_allocator)
+	, m_input_snapshot(m_allocator)
+	, m_parallel_contexts(m_allocator)
+	, m_profiler_names(m_allocator)
+	, m_sampled_stacks(m_allocator)
+	, m_sampled_stack_indices(m_allocator)
+	, m_function_stats(m_allocator)
+	, m_frame_function_stats(m_allocator)
+	, m_stats_frames(m_allocator)
+	, m_trace(m_allocator)
+	, m_trace_path(m_allocator)
+	, m_native_call_stats(m_allocator)
+	, m_native_call_indices(m_allocator)
+	, m_native_call_frames(m_allocator)
+	, m_contexts(m_allocator)
+{
+	// must precede any allocation made by AngelScript
+	installASMemoryHooks(m_memory_fallback);
+	// parallel_for runs scripts on worker threads
+	asPrepareMultithread();
+	m_engine = asCreateScriptEngine();
+	if (!m_engine)
+	{
+		logError("Failed to create AngelScript engine");
+		return;
+	}
+
+	// Set message callback
+	m_engine->SetMessageCallback(asFUNCTION(messageCallback), nullptr, asCALL_CDECL);
+	m_engine->SetContextUserDataCleanupCallback(onContextReleased, CONTEXT_SYSTEM);
+	m_engine->SetModuleUserDataCleanupCallback(AngelScriptModuleImpl::onModuleReleased, MODULE_MESSAGE_HANDLERS);
+
+	m_vm_counters[VM_COUNTER_CALLBACKS] = profiler::createCounter("AngelScript callbacks", 0);
+	m_vm_counters[VM_COUNTER_SCRIPT_CALLS] = profiler::createCounter("AngelScript script calls", 0);
+	m_vm_counters[VM_COUNTER_NATIVE_CALLS] = profiler::createCounter("AngelScript native calls", 0);
+	m_vm_counters[VM_COUNTER_INSTRUCTIONS] = profiler::createCounter("AngelScript instructions", 0);
+	m_vm_counters[VM_COUNTER_CONTEXTS] = profiler::createCounter("AngelScript contexts", 0);
+	m_vm_counters[VM_COUNTER_GC_OBJECTS] = profiler::createCounter("AngelScript GC objects", 0);
+	m_vm_counters[VM_COUNTER_BYTECODE_KB] = profiler::createCounter("AngelScript bytecode (KB)", 0);
+	m_vm_counters[VM_COUNTER_COMPILE_MS] = profiler::createCounter("AngelScript compile (ms)", 0);
+
+	registerAPI(m_engine, &m_string_factory);
 
 	m_script_manager.create(ASScript::TYPE, engine.getResourceManager());
 
-	LUMIX_MODULE(AngelScriptModuleImpl, "angelscript")
-		.LUMIX_CMP(InlineScriptComponent, "angelscript_inline", "AngelScript / Inline")
-		.LUMIX_PROP(InlineScriptCode, "Code")
-		.multilineAttribute()
-		.LUMIX_CMP(ScriptComponent, "angelscript", "AngelScript / File")
-		.LUMIX_FUNC_EX(AngelScriptModule::getScriptPath, "getScriptPath")
-		.begin_array<&AngelScriptModule::getScriptCount,
-			&AngelScriptModule::addScript,
-			&AngelScriptModule::removeScript>("scripts")
-		.prop<&AngelScriptModule::isScriptEnabled, &AngelScriptModule::enableScript>("Enabled")
-		.LUMIX_PROP(ScriptPath, "Path")
-		.resourceAttribute(ASScript::TYPE)
-		.end_array();
+	char command_line[2048];
+	os::getCommandLine(Span(command_line));
+	CommandLineParser parser(command_line);
+	while (parser.next())
+	{
+		if (parser.currentEquals("-angelscript_trace") && parser.next())
+		{
+			char path[MAX_PATH];
+			parser.getCurrent(path, lengthOf(path));
+			m_trace_path = path;
+			m_trace.start();
+		}
+		else if (parser.currentEquals("-angelscript_watchdog") && parser.next())
+		{
+			char ms[16];
+			parser.getCurrent(ms, lengthOf(ms));
+			fromCString(ms, m_watchdog_ms);
+		}
+		else if (parser.currentEquals("-angelscript_memory_limit") && parser.next())
+		{
+			char kb[16];
+			parser.getCurrent(kb, lengthOf(kb));
+			u64 limit = 0;
+			fromCString(kb, limit);
+			m_default_memory_limit = limit * 1024;
+		}
+		else if (parser.currentEquals("-angelscript_bundle") && parser.next())
+		{
+			char path[MAX_PATH];
+			parser.getCurrent(path, lengthOf(path));
+			openBundle(path);
+		}
+	}
+
+	LUMIX_MODULE(AngelScriptModuleImpl, "angelscript")
+		.LUMIX_CMP(InlineScriptComponent, "angelscript_inline", "AngelScript / Inline")
+		.LUMIX_PROP(InlineScriptCode, "Code")
+		.multilineAttribute()
+		.LUMIX_CMP(ScriptComponent, "angelscript", "AngelScript / File")
+		.LUMIX_FUNC_EX(AngelScriptModule::getScriptPath, "getScriptPath")
+		.begin_array<&AngelScriptModule::getScriptCount,
+			&AngelScriptModule::addScript,
+			&AngelScriptModule::removeScript>("scripts")
+		.prop<&AngelScriptModule::isScriptEnabled, &AngelScriptModule::enableScript>("Enabled")
+		.LUMIX_PROP(ScriptPath, "Path")
+		.resourceAttribute(ASScript::TYPE)
+		.end_array();
+}
+
+AngelScriptSystemImpl::~AngelScriptSystemImpl()
+{
+	stopSampling();
+	setNativeCallTracing(false);
+	asSetScriptCallHook(nullptr, nullptr);
+	if (!m_trace_path.empty()) saveTrace(m_trace_path.c_str());
+
+	for (const ASResourceSlot& slot : m_as_resources)
+	{
+		if (slot.resource) slot.resource->decRefCount();
+	}
+
+	for (asIScriptContext* ctx : m_parallel_contexts)
+	{
+		ctx->Release();
+	}
+
+	for (String* name : m_profiler_names)
+	{
+		LUMIX_DELETE(m_allocator, name);
+	}
+
+	if (m_engine)
+	{
+		m_engine->ShutDownAndRelease();
+	}
+	asUnprepareMultithread();
+	uninstallASMemoryHooks();
+
+	m_script_manager.releaseBundleScripts();
+	m_script_manager.destroy();
+}
+
+// Everything scripts can use, shared by the runtime engine and compile engines
+void AngelScriptSystemImpl::registerAPI(asIScriptEngine* engine, AngelScriptWrapper::StringFactory* string_factory)
+{
+	AngelScriptWrapper::registerStringType(engine, string_factory);
+	RegisterScriptArray(engine, true);
+
+	AngelScriptWrapper::registerBasicTypes(engine);
+	AngelScriptWrapper::registerMathTypes(engine);
+	AngelScriptWrapper::registerMathFunctions(engine);
+	AngelScriptWrapper::registerEntityTypes(engine);
+
+	engine->SetUserData((AngelScriptSystem*)this, ENGINE_SYSTEM);
+	registerInputAPI(engine);
+	registerMessageAPI(engine);
+	registerTimerAPI(engine);
+	registerWorldEventAPI(engine);
+	registerParallelAPI(engine);
+	registerResourceAPI(engine);
+	registerFileAPI(engine);
+	registerNetworkAPI(engine);
+	registerTraceAPI(engine);
+}
+
+asIScriptEngine* AngelScriptSystemImpl::createCompileEngine()
+{
+	PROFILE_FUNCTION();
+	MutexGuard guard(m_compile_engine_mutex);
+	asIScriptEngine* engine = asCreateScriptEngine();
+	if (!engine) return nullptr;
+
+	// string constants of the runtime engine are not thread safe, each engine has its own
+	auto* string_factory = LUMIX_NEW(m_allocator, AngelScriptWrapper::StringFactory)(m_allocator, m_allocator);
+	engine->SetUserData(string_factory, ENGINE_STRING_FACTORY);
+	// builds run on editor and compiler threads, global initializers could call into the runtime through the
+	// registered API, so they are never executed
+	const int r = engine->SetEngineProperty(asEP_INIT_GLOBAL_VARS_AFTER_BUILD, false);
+	ASSERT(r >= 0);
+	registerAPI(engine, string_factory);
+	return engine;
+}
+
+void AngelScriptSystemImpl::destroyCompileEngine(asIScriptEngine* engine)
+{
+	auto* string_factory = (AngelScriptWrapper::StringFactory*)engine->GetUserData(ENGINE_STRING_FACTORY);
+	// releases string constants, the factory must still exist
+	engine->ShutDownAndRelease();
+	LUMIX_DELETE(m_allocator, string_factory);
+}
+
+void AngelScriptSystemImpl::registerInputAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	r = engine->RegisterEnum("InputEventType");
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputEventType", "BUTTON", InputSystem::Event::BUTTON);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputEventType", "AXIS", InputSystem::Event::AXIS);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputEventType", "TEXT_INPUT", InputSystem::Event::TEXT_INPUT);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputEventType", "DEVICE_ADDED", InputSystem::Event::DEVICE_ADDED);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputEventType", "DEVICE_REMOVED", InputSystem::Event::DEVICE_REMOVED);
+	ASSERT(r >= 0);
+
+	r = engine->RegisterEnum("InputDeviceType");
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputDeviceType", "MOUSE", InputSystem::Device::MOUSE);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputDeviceType", "KEYBOARD", InputSystem::Device::KEYBOARD);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("InputDeviceType", "CONTROLLER", InputSystem::Device::CONTROLLER);
+	ASSERT(r >= 0);
+
+	// Read-only for scripts, events are shared by all instances
+	r = engine->RegisterObjectType("InputEvent", sizeof(ASInputEvent), asOBJ_VALUE | asOBJ_POD | asOBJ_APP_CLASS);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const InputEventType type", asOFFSET(ASInputEvent, type));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty(
+		"InputEvent", "const InputDeviceType device_type", asOFFSET(ASInputEvent, device_type));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const uint key_id", asOFFSET(ASInputEvent, key_id));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const bool down", asOFFSET(ASInputEvent, down));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const bool is_repeat", asOFFSET(ASInputEvent, is_repeat));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const float x", asOFFSET(ASInputEvent, x));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const float y", asOFFSET(ASInputEvent, y));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const float x_abs", asOFFSET(ASInputEvent, x_abs));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const float y_abs", asOFFSET(ASInputEvent, y_abs));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("InputEvent", "const uint utf8", asOFFSET(ASInputEvent, utf8));
+	ASSERT(r >= 0);
+
+	r = engine->RegisterGlobalFunction(
+		"bool isKeyDown(int)", asMETHOD(AngelScriptSystemImpl, scriptIsKeyDown), asCALL_THISCALL_ASGLOBAL, this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("bool wasKeyPressed(int)",
+		asMETHOD(AngelScriptSystemImpl, scriptWasKeyPressed),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("bool wasKeyReleased(int)",
+		asMETHOD(AngelScriptSystemImpl, scriptWasKeyReleased),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("bool isMouseButtonDown(int)",
+		asMETHOD(AngelScriptSystemImpl, scriptIsMouseButtonDown),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("uint getInputEventCount()",
+		asMETHOD(AngelScriptSystemImpl, scriptGetInputEventCount),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("const InputEvent& getInputEvent(uint)",
+		asMETHOD(AngelScriptSystemImpl, scriptGetInputEvent),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+}
+
+static AngelScriptModuleImpl::ScriptComponent* getContextComponent()
+{
+	asIScriptContext* ctx = asGetActiveContext();
+	if (!ctx) return nullptr;
+	return static_cast<AngelScriptModuleImpl::ScriptComponent*>(ctx->GetUserData(CONTEXT_SCRIPT_COMPONENT));
+}
+
+static void AS_postMessageImpl(EntityRef receiver,
+	const String& name,
+	const AngelScriptModuleImpl::QueuedMessage& payload,
+	StringView text)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp)
+	{
+		asGetActiveContext()->SetException("postMessage can be called only from script components");
+		return;
+	}
+	cmp->m_module.postMessage(cmp->m_entity, receiver, name, payload, text);
+}
+
+static void AS_postMessage(const EntityRef& receiver, const String& name)
+{
+	AS_postMessageImpl(receiver, name, {}, {});
+}
+
+static void AS_postMessageInt(const EntityRef& receiver, const String& name, i32 value)
+{
+	AngelScriptModuleImpl::QueuedMessage payload = {};
+	payload.int_value = value;
+	AS_postMessageImpl(receiver, name, payload, {});
+}
+
+static void AS_postMessageFloat(const EntityRef& receiver, const String& name, float value)
+{
+	AngelScriptModuleImpl::QueuedMessage payload = {};
+	payload.float_value = value;
+	AS_postMessageImpl(receiver, name, payload, {});
+}
+
+static void AS_postMessageVec3(const EntityRef& receiver, const String& name, const Vec3& value)
+{
+	AngelScriptModuleImpl::QueuedMessage payload = {};
+	payload.vec3_value = value;
+	AS_postMessageImpl(receiver, name, payload, {});
+}
+
+static void AS_postMessageText(const EntityRef& receiver, const String& name, const String& text)
+{
+	AS_postMessageImpl(receiver, name, {}, StringView(text.c_str(), text.length()));
+}
+
+static u32 AS_addTimer(asIScriptFunction* callback, float delay, bool repeat)
+{
+	if (!callback) return 0;
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp)
+	{
+		callback->Release();
+		asGetActiveContext()->SetException("Timers can be set only from script components");
+		return 0;
+	}
+	return cmp->m_module.addTimer(*cmp, asGetActiveContext(), callback, delay, repeat);
+}
+
+static u32 AS_setTimeout(asIScriptFunction* callback, float seconds)
+{
+	return AS_addTimer(callback, seconds, false);
+}
+
+static u32 AS_setInterval(asIScriptFunction* callback, float seconds)
+{
+	return AS_addTimer(callback, seconds, true);
+}
+
+static void AS_clearTimer(u32 timer)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (cmp) cmp->m_module.m_timers.cancel(timer);
+}
+
+static u32 AS_loadResourceAsync(const String& path, const String& type, asIScriptFunction* callback)
+{
+	if (!callback) return 0xffFFffFF;
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp)
+	{
+		callback->Release();
+		asGetActiveContext()->SetException("Resources can be loaded asynchronously only from script components");
+		return 0xffFFffFF;
+	}
+	return cmp->m_module.loadResourceAsync(
+		*cmp, asGetActiveContext(), Path(path.c_str()), ResourceType(type.c_str()), callback);
+}
+
+static AngelScriptModuleImpl::ScriptComponent* getFileComponent(asIScriptFunction* callback)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp)
+	{
+		if (callback) callback->Release();
+		asGetActiveContext()->SetException("File I/O is available only to script components");
+	}
+	return cmp;
+}
+
+static Span<const u8> getBytes(const CScriptArray& data)
+{
+	return Span<const u8>((const u8*)const_cast<CScriptArray&>(data).GetBuffer(), data.GetSize());
+}
+
+static Span<const u8> getBytes(const String& text)
+{
+	return Span<const u8>((const u8*)text.c_str(), text.length());
+}
+
+static void AS_readFile(const String& path, asIScriptFunction* callback)
+{
+	if (!callback) return;
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(callback);
+	if (!cmp) return;
+	cmp->m_module.readFile(*cmp,
+		asGetActiveContext(),
+		Path(path.c_str()),
+		AngelScriptModuleImpl::FileRequest::Type::READ_BYTES,
+		callback);
+}
+
+static void AS_readTextFile(const String& path, asIScriptFunction* callback)
+{
+	if (!callback) return;
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(callback);
+	if (!cmp) return;
+	cmp->m_module.readFile(
+		*cmp, asGetActiveContext(), Path(path.c_str()), AngelScriptModuleImpl::FileRequest::Type::READ_TEXT, callback);
+}
+
+static void AS_writeFileImpl(AsyncFileWriter::Op op,
+	const String& path,
+	Span<const u8> data,
+	asIScriptFunction* callback)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(callback);
+	if (!cmp) return;
+	cmp->m_module.writeFile(*cmp, asGetActiveContext(), op, Path(path.c_str()), data, callback);
+}
+
+static void AS_writeFile(const String& path, const CScriptArray& data, asIScriptFunction* callback)
+{
+	AS_writeFileImpl(AsyncFileWriter::Op::WRITE, path, getBytes(data), callback);
+}
+
+static void AS_writeTextFile(const String& path, const String& text, asIScriptFunction* callback)
+{
+	AS_writeFileImpl(AsyncFileWriter::Op::WRITE, path, getBytes(text), callback);
+}
+
+static void AS_appendFile(const String& path, const CScriptArray& data, asIScriptFunction* callback)
+{
+	AS_writeFileImpl(AsyncFileWriter::Op::APPEND, path, getBytes(data), callback);
+}
+
+static void AS_appendTextFile(const String& path, const String& text, asIScriptFunction* callback)
+{
+	AS_writeFileImpl(AsyncFileWriter::Op::APPEND, path, getBytes(text), callback);
+}
+
+static u32 AS_openFileStream(const String& path)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(nullptr);
+	if (!cmp) return 0;
+	return cmp->m_module.openFileStream(*cmp, asGetActiveContext(), Path(path.c_str()));
+}
+
+static void AS_writeFileStream(u32 stream, const CScriptArray& data)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(nullptr);
+	if (cmp) cmp->m_module.writeFileStream(stream, getBytes(data));
+}
+
+static void AS_writeTextFileStream(u32 stream, const String& text)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(nullptr);
+	if (cmp) cmp->m_module.writeFileStream(stream, getBytes(text));
+}
+
+static void AS_closeFileStream(u32 stream, asIScriptFunction* callback)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getFileComponent(callback);
+	if (cmp) cmp->m_module.closeFileStream(*cmp, asGetActiveContext(), stream, callback);
+}
+
+static u32 AS_networkOpen(AngelScriptModuleImpl::SocketType type,
+	const String& ip,
+	u16 port,
+	asIScriptFunction* on_event,
+	asIScriptFunction* on_data)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp)
+	{
+		if (on_event) on_event->Release();
+		if (on_data) on_data->Release();
+		asGetActiveContext()->SetException("Sockets can be opened only from script components");
+		return 0;
+	}
+	return cmp->m_module.openNetworkSocket(*cmp, asGetActiveContext(), type, ip.c_str(), port, on_event, on_data);
+}
+
+static u32 AS_networkConnect(const String& ip, u16 port, asIScriptFunction* on_event, asIScriptFunction* on_data)
+{
+	return AS_networkOpen(AngelScriptModuleImpl::SocketType::TCP_CONNECT, ip, port, on_event, on_data);
+}
+
+static u32 AS_networkListen(const String& ip, u16 port, asIScriptFunction* on_event, asIScriptFunction* on_data)
+{
+	return AS_networkOpen(AngelScriptModuleImpl::SocketType::TCP_LISTEN, ip, port, on_event, on_data);
+}
+
+static u32 AS_networkOpenUDP(const String& ip, u16 port, asIScriptFunction* on_event, asIScriptFunction* on_data)
+{
+	return AS_networkOpen(AngelScriptModuleImpl::SocketType::UDP, ip, port, on_event, on_data);
+}
+
+static ASNetwork* getContextNetwork(u32 socket)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp || !cmp->m_module.isNetworkSocketOwner(*cmp, asGetActiveContext(), socket)) return nullptr;
+	return cmp->m_module.m_network.get();
+}
+
+static bool AS_networkWrite(u32 socket, const CScriptArray& data)
+{
+	ASNetwork* network = getContextNetwork(socket);
+	return network && network->send(socket, getBytes(data));
+}
+
+static bool AS_networkWriteText(u32 socket, const String& text)
+{
+	ASNetwork* network = getContextNetwork(socket);
+	return network && network->send(socket, getBytes(text));
+}
+
+static bool AS_networkSendTo(u32 socket, const String& ip, u16 port, const CScriptArray& data)
+{
+	ASNetwork* network = getContextNetwork(socket);
+	return network && network->sendTo(socket, ip.c_str(), port, getBytes(data));
+}
+
+static bool AS_networkSendTextTo(u32 socket, const String& ip, u16 port, const String& text)
+{
+	ASNetwork* network = getContextNetwork(socket);
+	return network && network->sendTo(socket, ip.c_str(), port, getBytes(text));
+}
+
+static void AS_networkClose(u32 socket)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (cmp && cmp->m_module.isNetworkSocketOwner(*cmp, asGetActiveContext(), socket))
+	{
+		cmp->m_module.closeNetworkSocket(socket);
+	}
+}
+
+// reflection::getComponentType would register an unknown name as a new component type
+static bool findComponentType(const char* name, ComponentType& type)
+{
+	for (const reflection::RegisteredComponent& cmp : reflection::getComponents())
+	{
+		if (cmp.cmp && equalStrings(cmp.cmp->name, name))
+		{
+			type = cmp.cmp->component_type;
+			return true;
+		}
+	}
+	return false;
+}
+
+static u32 AS_subscribe(AngelScriptModuleImpl::WorldEventType type, const String* cmp_name, asIScriptFunction* callback)
+{
+	if (!callback) return 0;
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (!cmp)
+	{
+		callback->Release();
+		asGetActiveContext()->SetException("World events can be subscribed only from script components");
+		return 0;
+	}
+	ComponentType cmp_type = {-1};
+	if (cmp_name && !findComponentType(cmp_name->c_str(), cmp_type))
+	{
+		callback->Release();
+		const StaticString<128> msg("Unknown component type ", cmp_name->c_str());
+		asGetActiveContext()->SetException(msg);
+		return 0;
+	}
+	const u64 key = AngelScriptModuleImpl::getWorldEventKey(type, cmp_type);
+	return cmp->m_module.subscribe(*cmp, asGetActiveContext(), key, callback);
+}
+
+static u32 AS_subscribeComponentCreated(const String& cmp_type, asIScriptFunction* callback)
+{
+	return AS_subscribe(AngelScriptModuleImpl::WorldEventType::COMPONENT_CREATED, &cmp_type, callback);
+}
+
+static u32 AS_subscribeComponentDestroyed(const String& cmp_type, asIScriptFunction* callback)
+{
+	return AS_subscribe(AngelScriptModuleImpl::WorldEventType::COMPONENT_DESTROYED, &cmp_type, callback);
+}
+
+static u32 AS_subscribeEntityDestroyed(asIScriptFunction* callback)
+{
+	return AS_subscribe(AngelScriptModuleImpl::WorldEventType::ENTITY_DESTROYED, nullptr, callback);
+}
+
+static void AS_unsubscribe(u32 subscription)
+{
+	AngelScriptModuleImpl::ScriptComponent* cmp = getContextComponent();
+	if (cmp) cmp->m_module.unsubscribeHandle(subscription);
+}
+
+void AngelScriptSystemImpl::registerWorldEventAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	// Events are buffered during the frame and delivered in the next module update
+	r = engine->RegisterFuncdef("void WorldEventCallback(const Entity &in)");
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("uint subscribeComponentCreated(const String &in, WorldEventCallback@)",
+		asFUNCTION(AS_subscribeComponentCreated),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("uint subscribeComponentDestroyed(const String &in, WorldEventCallback@)",
+		asFUNCTION(AS_subscribeComponentDestroyed),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"uint subscribeEntityDestroyed(WorldEventCallback@)", asFUNCTION(AS_subscribeEntityDestroyed), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void unsubscribe(uint)", asFUNCTION(AS_unsubscribe), asCALL_CDECL);
+	ASSERT(r >= 0);
+}
+
+// Profiler keeps only pointers to block names, so the names are interned
+const char* AngelScriptSystemImpl::getProfilerName(asIScriptFunction* func)
+{
+	if (!func) return "AngelScript";
+	if (const char* name = (const char*)func->GetUserData(FUNCTION_PROFILER_NAME)) return name;
+
+	asIScriptFunction* target = func->GetFuncType() == asFUNC_DELEGATE ? func->GetDelegateFunction() : func;
+	const char* section = target->GetScriptSectionName();
+	const char* object = target->GetObjectName();
+	const StaticString<MAX_PATH + 128> label(
+		section ? section : "", section ? ": " : "", object ? object : "", object ? "::" : "", target->GetName());
+
+	const char* name = intern(StringView(label.data));
+	func->SetUserData((void*)name, FUNCTION_PROFILER_NAME);
+	return name;
+}
+
+// Strings handed to the profiler and the trace, they live as long as the system
+const char* AngelScriptSystemImpl::intern(StringView str)
+{
+	const StableHash hash(str.begin, str.size());
+	auto iter = m_profiler_names.find(hash);
+	if (iter.isValid()) return iter.value()->c_str();
+
+	String* name = LUMIX_NEW(m_allocator, String)(str, m_allocator);
+	m_profiler_names.insert(hash, name);
+	return name->c_str();
+}
+
+// Called by the VM for calls between script functions
+static void scriptCallHook(asIScriptContext* ctx, asIScriptFunction* func, bool begin, void* param)
+{
+	((AngelScriptSystemImpl*)param)->onScriptCall(ctx, func, begin);
+}
+
+// The hook costs a call per script call, it is installed only while something uses it
+void AngelScriptSystemImpl::updateScriptCallHook()
+{
+	const bool tracking =
+		m_profiler_zones == ProfilerZones::FUNCTIONS || m_function_stats_mode != FunctionStatsMode::DISABLED;
+	asSetScriptCallHook(tracking ? scriptCallHook : nullptr, this);
+}
+
+void AngelScriptSystemImpl::onScriptCall(asIScriptContext* ctx, asIScriptFunction* func, bool begin)
+{
+	// other contexts, e.g. parallel_for jobs on workers, and stack cleanup after execute() returned are skipped
+	asPWORD depth = (asPWORD)ctx->GetUserData(CONTEXT_PROFILER_DEPTH);
+	if (depth == 0) return;
+	// the entry function is left by executeProfiled
+	if (!begin && depth == 1) return;
+
+	const bool zones = m_profiler_zones == ProfilerZones::FUNCTIONS;
+	const bool stats = m_function_stats_mode != FunctionStatsMode::DISABLED;
+	if (begin)
+	{
+		enterFunction(ctx, func, zones, stats);
+		++depth;
+	}
+	else
+	{
+		leaveFunction(ctx, zones, stats);
+		--depth;
+	}
+	ctx->SetUserData((void*)depth, CONTEXT_PROFILER_DEPTH);
+}
+
+void AngelScriptSystemImpl::enterFunction(asIScriptContext* ctx, asIScriptFunction* func, bool zones, bool stats)
+{
+	if (zones) profiler::beginBlock(getProfilerName(func));
+	if (!stats) return;
+
+	StatsFrame& frame = m_stats_frames.emplace();
+	frame.ctx = ctx;
+	frame.stats = getFunctionStatsIndex(func);
+	frame.start = os::Timer::getRawTimestamp();
+	frame.children = 0;
+	frame.instructions_start = ctx->GetExecutedInstructionCount();
+	frame.child_instructions = 0;
+	++m_function_stats[frame.stats].calls;
+}
+
+void AngelScriptSystemImpl::leaveFunction(asIScriptContext* ctx, bool zones, bool stats)
+{
+	if (zones) profiler::endBlock();
+	if (!stats) return;
+
+	const StatsFrame frame = m_stats_frames.back();
+	m_stats_frames.pop();
+	const u64 elapsed = os::Timer::getRawTimestamp() - frame.start;
+	const u64 instructions = ctx->GetExecutedInstructionCount() - frame.instructions_start;
+	const double freq = (double)os::Timer::getFrequency();
+	FunctionStats& fs = m_function_stats[frame.stats];
+	fs.inclusive_time += elapsed / freq;
+	fs.exclusive_time += (elapsed - frame.children) / freq;
+	fs.instructions += instructions - frame.child_instructions;
+	if (m_stats_frames.empty()) return;
+
+	StatsFrame& parent = m_stats_frames.back();
+	parent.children += elapsed;
+	// a nested execute() of another context does not run on the parent's counter
+	if (parent.ctx == ctx) parent.child_instructions += instructions;
+}
+
+// Stats are kept per function object, overloads are separate and a reloaded script gets new entries
+u32 AngelScriptSystemImpl::getFunctionStatsIndex(asIScriptFunction* func)
+{
+	if (const asPWORD idx = (asPWORD)func->GetUserData(FUNCTION_STATS)) return u32(idx - 1);
+
+	const u32 idx = m_function_stats.size();
+	m_function_stats.emplace().name = getProfilerName(func);
+	func->SetUserData((void*)asPWORD(idx + 1), FUNCTION_STATS);
+	return idx;
+}
+
+void AngelScriptSystemImpl::setFunctionStatsMode(FunctionStatsMode mode)
+{
+	m_function_stats_mode = mode;
+	resetFunctionStats();
+	updateScriptCallHook();
+}
+
+// Zeroes the counters, entries stay because functions cache their indices
+void AngelScriptSystemImpl::resetFunctionStats()
+{
+	for (FunctionStats& fs : m_function_stats)
+	{
+		fs.calls = 0;
+		fs.instructions = 0;
+		fs.inclusive_time = 0;
+		fs.exclusive_time = 0;
+	}
+	m_frame_function_stats.clear();
+}
+
+void AngelScriptSystemImpl::publishFunctionStats()
+{
+	m_frame_function_stats.clear();
+	m_frame_function_stats.reserve(m_function_stats.size());
+	for (FunctionStats& fs : m_function_stats)
+	{
+		m_frame_function_stats.push(fs);
+		fs.calls = 0;
+		fs.instructions = 0;
+		fs.inclusive_time = 0;
+		fs.exclusive_time = 0;
+	}
+}
+
+// Runs a prepared context. With zones enabled the call gets a profiler block labelled with the script and
+// function, FUNCTIONS adds a block for each nested script call. Nested calls for FUNCTIONS and function stats are
+// reported by the VM call hook, sampling is done by the VM too. With all of them disabled this costs a few
+// branches and the VM stats counters.
+int AngelScriptSystemImpl::execute(asIScriptContext* ctx)
+{
+	// objects made by the script are attributed to its file
+	ASMemoryScope memory_scope((ASMemoryTag*)ctx->GetUserData(CONTEXT_MEMORY_TAG), ASMemoryTag::RUNTIME);
+	++m_frame_vm_stats.callbacks;
+	if (++m_executing > m_frame_vm_stats.peak_active_contexts) m_frame_vm_stats.peak_active_contexts = m_executing;
+	ExecutionBudget budget;
+	budget.start = os::Timer::getRawTimestamp();
+	void* outer_budget = ctx->SetUserData(&budget, CONTEXT_WATCHDOG);
+	const u64 instructions = ctx->GetExecutedInstructionCount();
+	const u64 script_calls = ctx->GetScriptCallCount();
+
+	const int r = executeProfiled(ctx);
+
+	m_frame_vm_stats.instructions += ctx->GetExecutedInstructionCount() - instructions;
+	m_frame_vm_stats.script_calls += u32(ctx->GetScriptCallCount() - script_calls);
+	ctx->SetUserData(outer_budget, CONTEXT_WATCHDOG);
+	--m_executing;
+	if (r == asEXECUTION_ABORTED && budget.expired) onWatchdogExpired(ctx, budget.expired);
+	return r;
+}
+
+int AngelScriptSystemImpl::executeProfiled(asIScriptContext* ctx)
+{
+	const bool sampling = (bool)m_sampler;
+	const bool stats = m_function_stats_mode != FunctionStatsMode::DISABLED;
+	const bool trace = m_trace.isEnabled();
+	if (m_profiler_zones == ProfilerZones::NONE && !sampling && !stats && !trace) return ctx->Execute();
+
+	const bool zones = m_profiler_zones != ProfilerZones::NONE;
+	const bool functions = m_profiler_zones == ProfilerZones::FUNCTIONS;
+	// nested calls are reported by the VM through scriptCallHook
+	const bool tracking = functions || stats;
+	const char* name = getProfilerName(ctx->GetFunction());
+	if (zones) profiler::beginBlock(name);
+	if (trace) m_trace.begin("callback", name);
+	if (stats) enterFunction(ctx, ctx->GetFunction(), false, true);
+	if (tracking) ctx->SetUserData((void*)asPWORD(1), CONTEXT_PROFILER_DEPTH);
+	if (sampling)
+	{
+		// the outermost call drops requests raised while no script was running
+		if (m_sampler->m_running.add(1) == 0) m_sampler->m_requested = 0;
+	}
+
+	const int r = ctx->Execute();
+
+	if (sampling) m_sampler->m_running.add(-1);
+	if (tracking)
+	{
+		// calls left open by an exception or an abort, the stack is unwound only when the context is reused
+		for (asPWORD open = (asPWORD)ctx->GetUserData(CONTEXT_PROFILER_DEPTH); open > 1; --open)
+		{
+			leaveFunction(ctx, functions, stats);
+		}
+		ctx->SetUserData(nullptr, CONTEXT_PROFILER_DEPTH);
+	}
+	if (stats) leaveFunction(ctx, false, true);
+	if (trace) m_trace.end("callback", name);
+	if (zones) profiler::endBlock();
+	return r;
 }
 
-AngelScriptSystemImpl::~AngelScriptSystemImpl()
+void AngelScriptSystemImpl::setWatchdog(u32 ticks, u32 milliseconds)
+{
+	m_watchdog_ticks = ticks;
+	m_watchdog_ms = milliseconds;
+}
+
+// Runs on the executing thread every WATCHDOG_CHECK_TICKS, false aborts the execution
+bool AngelScriptSystemImpl::watchdogCallback(asIScriptContext* ctx, void* param)
 {
-	for (Resource* res : m_as_resources)
+	const AngelScriptSystemImpl* system = (const AngelScriptSystemImpl*)param;
+	const u32 max_ticks = system->m_watchdog_ticks;
+	const u32 max_ms = system->m_watchdog_ms;
+	if (max_ticks == 0 && max_ms == 0) return true;
+
+	// executed outside of execute() and parallel_for
+	ExecutionBudget* budget = (ExecutionBudget*)ctx->GetUserData(CONTEXT_WATCHDOG);
+	if (!budget) return true;
+
+	budget->ticks += WATCHDOG_CHECK_TICKS;
+	if (max_ticks != 0 && budget->ticks >= max_ticks)
 	{
-		res->decRefCount();
+		budget->expired = "instruction quota";
+		return false;
 	}
+	if (max_ms != 0)
+	{
+		const u64 elapsed = os::Timer::getRawTimestamp() - budget->start;
+		if (elapsed * 1000 >= max_ms * os::Timer::getFrequency())
+		{
+			budget->expired = "time limit";
+			return false;
+		}
+	}
+	return true;
+}
 
-	if (m_engine)
+// The call stack is still available after the abort; the offending instance is disabled so the rest of the frame
+// and the following frames run without it
+void AngelScriptSystemImpl::onWatchdogExpired(asIScriptContext* ctx, const char* reason)
+{
+	StaticString<2048> stack;
+	for (asUINT i = 0, c = minimum(ctx->GetCallstackSize(), 16u); i < c; ++i)
 	{
-		m_engine->ShutDownAndRelease();
+		asIScriptFunction* func = ctx->GetFunction(i);
+		const char* section = nullptr;
+		const int line = ctx->GetLineNumber(i, nullptr, &section);
+		const char* decl = func ? func->GetDeclaration(true, true) : "?";
+		stack.append("\n\t", decl, " (", section ? section : "?", ":", line, ")");
 	}
+	logError("Script aborted by watchdog, ", reason, " exceeded:", stack);
+
+	m_trace.instant("watchdog", "abort");
+	using ScriptInstance = AngelScriptModuleImpl::ScriptInstance;
+	AngelScriptModuleImpl::ScriptComponent* cmp =
+		static_cast<AngelScriptModuleImpl::ScriptComponent*>(ctx->GetUserData(CONTEXT_SCRIPT_COMPONENT));
+	if (!cmp) return;
+	for (ScriptInstance& inst : cmp->m_scripts)
+	{
+		if (inst.m_script_context != ctx) continue;
+		setFlag(inst.m_flags, ScriptInstance::ENABLED, false);
+		const char* path = inst.m_script ? inst.m_script->getPath().c_str() : "script";
+		logError("Disabled ", path, " on entity ", cmp->m_entity.index);
+	}
+}
 
-	m_script_manager.destroy();
+// Bytecode, globals and string constants made by the build are attributed to `tag`
+int AngelScriptSystemImpl::build(asIScriptModule* module, ASMemoryTag* tag)
+{
+	PROFILE_FUNCTION();
+	const u64 start = ASTrace::now();
+	int r;
+	{
+		ASMemoryScope memory_scope(tag, ASMemoryTag::COMPILED);
+		r = module->Build();
+	}
+	if (m_trace.isEnabled()) m_trace.complete("compile", intern(StringView(module->GetName())), start);
+	m_frame_vm_stats.compile_time += float((ASTrace::now() - start) / (double)os::Timer::getFrequency());
+	m_bytecode_dirty = true;
+	return r;
+}
+
+// Shipping builds, false if the script is not in the bundle and has to be built from its source
+bool AngelScriptSystemImpl::loadFromBundle(asIScriptModule* module, const Path& path, ASMemoryTag* tag, int& result)
+{
+	ASBundle::Script script;
+	if (!m_bundle.find(path, script)) return false;
+
+	PROFILE_FUNCTION();
+	const u64 start = ASTrace::now();
+	// read straight from the mapping, nothing is copied before the VM makes its own structures
+	ASBytecodeReader reader(script.bytecode);
+	{
+		ASMemoryScope memory_scope(tag, ASMemoryTag::COMPILED);
+		result = module->LoadByteCode(&reader);
+	}
+	if (m_trace.isEnabled()) m_trace.complete("compile", intern(StringView(module->GetName())), start);
+	m_frame_vm_stats.compile_time += float((ASTrace::now() - start) / (double)os::Timer::getFrequency());
+	m_bytecode_dirty = true;
+	return true;
+}
+
+// The API must be registered, bytecode of a bundle built for another API can not be loaded
+void AngelScriptSystemImpl::openBundle(const char* path)
+{
+	if (!m_bundle.open(path))
+	{
+		logError("Could not open script bundle ", path);
+		return;
+	}
+	if (m_bundle.getAPIHash() != ASBundle::computeAPIHash(*m_engine, m_allocator))
+	{
+		logError("Script bundle ", path, " was built for a different API, scripts are built from source");
+		m_bundle.close();
+		return;
+	}
+	logInfo("Script bundle ", path, " with ", m_bundle.getCount(), " scripts");
+}
+
+// Tags are never destroyed before the system, memory of a script can outlive its resource
+ASMemoryTag* AngelScriptSystemImpl::getMemoryTag(const Path& path)
+{
+	const StableHash hash(path.c_str());
+	auto iter = m_memory_tag_map.find(hash);
+	if (iter.isValid()) return iter.value();
+
+	UniquePtr<ASMemoryTag> tag = UniquePtr<ASMemoryTag>::create(m_allocator, m_allocator, path);
+	ASMemoryTag* ptr = tag.get();
+	auto limit_iter = m_memory_limits.find(hash);
+	ptr->limit = (i64)(limit_iter.isValid() ? limit_iter.value() : m_default_memory_limit);
+	m_memory_tags.push(tag.move());
+	m_memory_tag_map.insert(hash, ptr);
+	return ptr;
+}
+
+void AngelScriptSystemImpl::setScriptMemoryLimit(const Path& path, u64 bytes)
+{
+	if (path.isEmpty())
+	{
+		m_default_memory_limit = bytes;
+		for (UniquePtr<ASMemoryTag>& tag : m_memory_tags)
+		{
+			if (!m_memory_limits.find(StableHash(tag->path.c_str())).isValid()) tag->limit = (i64)bytes;
+		}
+		return;
+	}
+
+	const StableHash hash(path.c_str());
+	auto iter = m_memory_limits.find(hash);
+	if (iter.isValid())
+	{
+		iter.value() = bytes;
+	}
+	else
+	{
+		m_memory_limits.insert(hash, bytes);
+	}
+	getMemoryTag(path)->limit = (i64)bytes;
+}
+
+void AngelScriptSystemImpl::getScriptMemory(Array<ScriptMemory>& out) const
+{
+	out.clear();
+	auto add = [&out](const ASMemoryTag& tag) {
+		ScriptMemory& mem = out.emplace();
+		mem.path = tag.path.c_str();
+		mem.compiled_bytes = (u64)(i64)tag.bytes[ASMemoryTag::COMPILED];
+		mem.runtime_bytes = (u64)(i64)tag.bytes[ASMemoryTag::RUNTIME];
+		mem.peak_runtime_bytes = (u64)(i64)tag.peak_runtime_bytes;
+		mem.allocations = (u64)(i64)tag.allocations;
+		mem.limit = (u64)(i64)tag.limit;
+		mem.limit_failures = (u64)(i64)tag.limit_failures;
+	};
+	add(m_memory_fallback);
+	for (const UniquePtr<ASMemoryTag>& tag : m_memory_tags)
+	{
+		add(*tag);
+	}
+}
+
+// Contexts made by the system are counted in VMStats
+asIScriptContext* AngelScriptSystemImpl::createContext()
+{
+	asIScriptContext* ctx = m_engine->CreateContext();
+	if (!ctx) return nullptr;
+	ctx->SetUserData(this, CONTEXT_SYSTEM);
+	ctx->SetQuotaCallback(watchdogCallback, this, WATCHDOG_CHECK_TICKS);
+	MutexGuard guard(m_contexts_mutex);
+	m_contexts.push(ctx);
+	return ctx;
+}
+
+u64 AngelScriptSystemImpl::countBytecodeBytes() const
+{
+	u64 bytes = 0;
+	auto addFunction = [&bytes](asIScriptFunction* func) {
+		asUINT length = 0;
+		if (func && func->GetByteCode(&length)) bytes += length * sizeof(asDWORD);
+	};
+	for (asUINT m = 0, mc = m_engine->GetModuleCount(); m < mc; ++m)
+	{
+		asIScriptModule* module = m_engine->GetModuleByIndex(m);
+		for (asUINT i = 0, c = module->GetFunctionCount(); i < c; ++i)
+		{
+			addFunction(module->GetFunctionByIndex(i));
+		}
+		for (asUINT t = 0, tc = module->GetObjectTypeCount(); t < tc; ++t)
+		{
+			asITypeInfo* type = module->GetObjectTypeByIndex(t);
+			for (asUINT i = 0, c = type->GetMethodCount(); i < c; ++i)
+			{
+				addFunction(type->GetMethodByIndex(i, false));
+			}
+			for (asUINT i = 0, c = type->GetBehaviourCount(); i < c; ++i)
+			{
+				asEBehaviours beh;
+				addFunction(type->GetBehaviourByIndex(i, &beh));
+			}
+		}
+	}
+	return bytes;
+}
+
+void AngelScriptSystemImpl::updateVMStats()
+{
+	PROFILE_FUNCTION();
+	VMStats& stats = m_vm_stats;
+	const u64 gc_destroyed = stats.gc_destroyed;
+	const u64 gc_detected = stats.gc_detected;
+	const double total_compile_time = stats.total_compile_time;
+	const u32 modules = stats.modules;
+	const u64 bytecode_bytes = stats.bytecode_bytes;
+
+	stats = m_frame_vm_stats;
+	m_frame_vm_stats = {};
+
+	{
+		// contexts are idle during update, their stacks can be read
+		MutexGuard guard(m_contexts_mutex);
+		stats.contexts = m_contexts.size();
+		for (asIScriptContext* ctx : m_contexts)
+		{
+			stats.stack_bytes += ctx->GetStackMemorySize();
+		}
+	}
+	stats.pooled_contexts = m_parallel_contexts.size();
+
+	asUINT gc_size, destroyed, detected, new_objects, new_destroyed;
+	m_engine->GetGCStatistics(&gc_size, &destroyed, &detected, &new_objects, &new_destroyed);
+	stats.gc_objects = gc_size;
+	stats.gc_new_objects = new_objects;
+	stats.gc_old_objects = gc_size - new_objects;
+	// the VM reports totals as 32 bit, accumulate deltas so they survive wrapping
+	stats.gc_destroyed = gc_destroyed + u32(destroyed - m_gc_destroyed_seen);
+	stats.gc_detected = gc_detected + u32(detected - m_gc_detected_seen);
+	m_gc_destroyed_seen = destroyed;
+	m_gc_detected_seen = detected;
+
+	stats.string_constants = m_string_factory.m_strings.size();
+	stats.modules = m_engine->GetModuleCount();
+	// walking all bytecode is done only after compiles and discards
+	stats.bytecode_bytes = m_bytecode_dirty || modules != stats.modules ? countBytecodeBytes() : bytecode_bytes;
+	m_bytecode_dirty = false;
+	stats.total_compile_time = total_compile_time + stats.compile_time;
+
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_CALLBACKS], (float)stats.callbacks);
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_SCRIPT_CALLS], (float)stats.script_calls);
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_NATIVE_CALLS], (float)stats.native_calls);
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_INSTRUCTIONS], (float)stats.instructions);
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_CONTEXTS], (float)stats.contexts);
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_GC_OBJECTS], (float)stats.gc_objects);
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_BYTECODE_KB], float(stats.bytecode_bytes / 1024.0));
+	profiler::pushCounter(m_vm_counters[VM_COUNTER_COMPILE_MS], stats.compile_time * 1000);
+}
+
+void AngelScriptSystemImpl::getObjectTypeCounts(Array<ObjectTypeCount>& counts)
+{
+	counts.clear();
+	asUINT seq;
+	asITypeInfo* type;
+	for (asUINT i = 0; m_engine->GetObjectInGC(i, &seq, nullptr, &type) >= 0; ++i)
+	{
+		const char* name = intern(StringView(type ? type->GetName() : "?"));
+		ObjectTypeCount* found = nullptr;
+		for (ObjectTypeCount& c : counts)
+		{
+			if (c.type == name) found = &c;
+		}
+		if (found)
+			++found->count;
+		else
+			counts.push({name, 1});
+	}
+}
+
+bool AngelScriptSystemImpl::saveTrace(const char* path)
+{
+	OutputMemoryStream blob(m_allocator);
+	m_trace.writeJSON(blob);
+	os::OutputFile file;
+	if (!file.open(path))
+	{
+		logError("Failed to create ", path);
+		return false;
+	}
+	const bool success = file.write(blob.data(), blob.size());
+	file.close();
+	if (!success) logError("Failed to write ", path);
+	return success;
+}
+
+// Path relative to the project, like other script file access
+bool AngelScriptSystemImpl::scriptSaveTrace(const String& path)
+{
+	OutputMemoryStream blob(m_allocator);
+	m_trace.writeJSON(blob);
+	os::OutputFile file;
+	if (!m_engine_ref.getFileSystem().open(path.c_str(), file)) return false;
+	const bool success = file.write(blob.data(), blob.size());
+	file.close();
+	return success;
+}
+
+void AngelScriptSystemImpl::writeHeapSnapshot(OutputMemoryStream& stream)
+{
+	PROFILE_FUNCTION();
+	const u64 start = ASTrace::now();
+	ASHeapSnapshot snapshot(m_allocator);
+	snapshot.capture(*m_engine);
+	snapshot.serialize(stream);
+	m_trace.complete("diagnostics", "heap snapshot", start);
+}
+
+bool AngelScriptSystemImpl::scriptSaveHeapSnapshot(const String& path)
+{
+	OutputMemoryStream blob(m_allocator);
+	writeHeapSnapshot(blob);
+	os::OutputFile file;
+	if (!m_engine_ref.getFileSystem().open(path.c_str(), file)) return false;
+	const bool success = file.write(blob.data(), blob.size());
+	file.close();
+	return success;
+}
+
+#ifdef AS_NATIVE_CALL_HOOK
+static void nativeCallHook(asIScriptFunction* func, asIScriptContext* ctx, bool begin, void* param)
+{
+	((AngelScriptSystemImpl*)param)->onNativeCall(func, ctx, begin);
+}
+#endif
+
+bool AngelScriptSystemImpl::isNativeCallTracingAvailable() const
+{
+#ifdef AS_NATIVE_CALL_HOOK
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AngelScriptSystemImpl::setNativeCallTracing(bool enable)
+{
+#ifdef AS_NATIVE_CALL_HOOK
+	if (enable == m_native_call_tracing) return;
+	m_native_call_tracing = enable;
+	m_native_call_frames.clear();
+	asSetNativeCallHook(enable ? nativeCallHook : nullptr, this);
+#endif
+}
+
+void AngelScriptSystemImpl::resetNativeCallStats()
+{
+	for (NativeCallStats& stats : m_native_call_stats)
+	{
+		stats.calls = 0;
+		stats.time = 0;
+	}
+}
+
+void AngelScriptSystemImpl::onNativeCall(asIScriptFunction* func, asIScriptContext* ctx, bool begin)
+{
+	// stats are not synchronized, calls made by parallel_for jobs on workers are skipped
+	if (ctx->GetUserData(CONTEXT_PARALLEL_JOB)) return;
+
+	if (begin)
+	{
+		NativeCallFrame& frame = m_native_call_frames.emplace();
+		// a native called directly by the engine has no script caller
+		frame.caller = ctx->GetCallstackSize() > 0 ? ctx->GetFunction(0) : nullptr;
+		frame.start = ASTrace::now();
+		return;
+	}
+
+	// tracing was enabled while this call was running
+	if (m_native_call_frames.empty()) return;
+
+	const NativeCallFrame frame = m_native_call_frames.back();
+	m_native_call_frames.pop();
+	++m_frame_vm_stats.native_calls;
+	const u64 elapsed = ASTrace::now() - frame.start;
+
+	const u32 caller_id = frame.caller ? frame.caller->GetId() : 0;
+	const char* caller_name = frame.caller ? getProfilerName(frame.caller) : nullptr;
+	const u64 key = ((u64)func->GetId() << 32) | caller_id;
+	auto iter = m_native_call_indices.find(key);
+	u32 idx;
+	// ids of discarded script functions are reused, such callers get a new entry
+	if (iter.isValid() && m_native_call_stats[iter.value()].caller == caller_name)
+	{
+		idx = iter.value();
+	}
+	else
+	{
+		idx = m_native_call_stats.size();
+		NativeCallStats& stats = m_native_call_stats.emplace();
+		stats.name = getProfilerName(func);
+		stats.caller = caller_name;
+		stats.function_id = func->GetId();
+		if (iter.isValid())
+			iter.value() = idx;
+		else
+			m_native_call_indices.insert(key, idx);
+	}
+
+	const double freq = (double)os::Timer::getFrequency();
+	NativeCallStats& stats = m_native_call_stats[idx];
+	++stats.calls;
+	stats.time += elapsed / freq;
+	if (m_trace.isEnabled() && elapsed * 1e6 >= m_native_trace_threshold * freq)
+	{
+		m_trace.complete("native", stats.name, frame.start);
+	}
+}
+
+void AngelScriptSystemImpl::registerTraceAPI(asIScriptEngine* engine)
+{
+	int r;
+	r = engine->RegisterGlobalFunction(
+		"void startScriptTrace()", asMETHOD(AngelScriptSystemImpl, startTrace), asCALL_THISCALL_ASGLOBAL, this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void stopScriptTrace()", asMETHOD(AngelScriptSystemImpl, stopTrace), asCALL_THISCALL_ASGLOBAL, this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("bool saveScriptTrace(const String &in)",
+		asMETHOD(AngelScriptSystemImpl, scriptSaveTrace),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("bool saveHeapSnapshot(const String &in)",
+		asMETHOD(AngelScriptSystemImpl, scriptSaveHeapSnapshot),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+}
+
+// Called by the VM on the thread executing a script once the sampler raised a request
+static void sampleHook(asIScriptContext* ctx, void* param)
+{
+	// the ring has a single producer, parallel_for jobs on workers are not sampled
+	if (ctx->GetUserData(CONTEXT_PARALLEL_JOB)) return;
+	((AngelScriptSystemImpl*)param)->sampleCallstack(ctx);
+}
+
+void AngelScriptSystemImpl::startSampling(u32 interval_ms)
+{
+	stopSampling();
+	m_sampler = UniquePtr<ScriptSampler>::create(m_allocator, interval_ms, m_allocator);
+	if (!m_sampler->create("angelscript_sampler", false))
+	{
+		logError("Failed to create AngelScript sampler thread");
+		m_sampler.reset();
+		return;
+	}
+	asSetSampleHook(sampleHook, this, &m_sampler->m_requested);
+}
+
+void AngelScriptSystemImpl::stopSampling()
+{
+	if (!m_sampler) return;
+
+	asSetSampleHook(nullptr, nullptr, nullptr);
+	m_sampler->m_quit = 1;
+	m_sampler->destroy();
+	drainSamples();
+	m_sampler.reset();
+}
+
+void AngelScriptSystemImpl::clearSamples()
+{
+	m_sampled_stacks.clear();
+	m_sampled_stack_indices.clear();
+	m_sample_count = 0;
+	m_dropped_samples = 0;
+}
+
+// Called from the VM sample hook, i.e. only from the thread running the context. Stacks deeper than MAX_DEPTH
+// keep their innermost functions.
+void AngelScriptSystemImpl::sampleCallstack(asIScriptContext* ctx)
+{
+	m_sampler->m_requested = 0;
+	ScriptSampler::Sample* sample = m_sampler->beginWrite();
+	if (!sample) return;
+
+	const u32 size = ctx->GetCallstackSize();
+	sample->depth = size < ScriptSampler::MAX_DEPTH ? size : ScriptSampler::MAX_DEPTH;
+	for (u32 level = 0; level < sample->depth; ++level)
+	{
+		sample->functions[level] = getProfilerName(ctx->GetFunction(level));
+	}
+	sample->line = ctx->GetLineNumber(0);
+	m_sampler->endWrite();
+}
+
+// Aggregates the ring into folded stacks, the innermost function is suffixed with the sampled line
+void AngelScriptSystemImpl::drainSamples()
+{
+	PROFILE_FUNCTION();
+	ScriptSampler& sampler = *m_sampler;
+	const i32 end = sampler.m_write;
+	for (i32 i = sampler.m_read; i < end; ++i)
+	{
+		const ScriptSampler::Sample& sample = sampler.m_samples[i % ScriptSampler::CAPACITY];
+		StaticString<4096> stack;
+		for (u32 level = sample.depth; level > 0; --level)
+		{
+			stack.append(sample.functions[level - 1], level > 1 ? ";" : ":");
+		}
+		stack.append(sample.line);
+
+		const StableHash hash(stack.data);
+		auto iter = m_sampled_stack_indices.find(hash);
+		if (iter.isValid())
+		{
+			++m_sampled_stacks[iter.value()].count;
+		}
+		else
+		{
+			m_sampled_stack_indices.insert(hash, m_sampled_stacks.size());
+			SampledStack& sampled = m_sampled_stacks.emplace(m_allocator);
+			sampled.stack = stack.data;
+			sampled.count = 1;
+		}
+		++m_sample_count;
+	}
+	sampler.m_read = end;
+
+	const i32 dropped = sampler.m_dropped;
+	sampler.m_dropped.add(-dropped);
+	m_dropped_samples += dropped;
+}
+
+void AngelScriptSystemImpl::writeFoldedStacks(OutputMemoryStream& stream) const
+{
+	for (const SampledStack& sampled : m_sampled_stacks)
+	{
+		const StaticString<32> count(" ", sampled.count, "\n");
+		stream.write(sampled.stack.c_str(), sampled.stack.length());
+		stream.write(count.data, stringLength(count.data));
+	}
+}
+
+void AngelScriptSystemImpl::scriptParallelFor(u32 count, u32 grain, asIScriptFunction* job)
+{
+	PROFILE_FUNCTION();
+	asIScriptContext* caller = asGetActiveContext();
+	if (!job)
+	{
+		caller->SetException("parallel_for: null job");
+		return;
+	}
+
+	if (job->GetFuncType() == asFUNC_DELEGATE)
+	{
+		job->Release();
+		caller->SetException("parallel_for: job can not be a delegate, its object would be shared by all workers");
+		return;
+	}
+
+	ParallelVerifier verifier(m_engine, m_allocator);
+	if (!verifier.verify(job))
+	{
+		job->Release();
+		caller->SetException("parallel_for: job writes globals or calls functions that are not thread safe");
+		return;
+	}
+
+	if (count == 0)
+	{
+		job->Release();
+		return;
+	}
+
+	const u32 workers_count = jobs::getWorkersCount();
+	if (grain == 0) grain = maximum(1u, count / (workers_count * 4));
+	const u32 chunks_count = (u32)(((u64)count + grain - 1) / grain);
+	while ((u32)m_parallel_contexts.size() < workers_count)
+	{
+		asIScriptContext* ctx = createContext();
+		ctx->SetUserData((void*)1, CONTEXT_PARALLEL_JOB);
+		m_parallel_contexts.push(ctx);
+	}
+
+	u64 instructions = 0;
+	u64 script_calls = 0;
+	for (asIScriptContext* ctx : m_parallel_contexts)
+	{
+		instructions += ctx->GetExecutedInstructionCount();
+		script_calls += ctx->GetScriptCallCount();
+	}
+
+	AtomicI32 next_context = 0;
+	AtomicI32 next_chunk = 0;
+	AtomicI32 failed = 0;
+	char error[256] = "";
+	ASMemoryTag* memory_tag = (ASMemoryTag*)caller->GetUserData(CONTEXT_MEMORY_TAG);
+	jobs::runOnWorkers([&]() {
+		const i32 ctx_idx = next_context.add(1);
+		if (ctx_idx >= m_parallel_contexts.size()) return;
+		asIScriptContext* ctx = m_parallel_contexts[ctx_idx];
+		ASMemoryScope memory_scope(memory_tag, ASMemoryTag::RUNTIME);
+		// every chunk is a call with its own budget
+		ExecutionBudget budget;
+		ctx->SetUserData(&budget, CONTEXT_WATCHDOG);
+
+		while (!failed)
+		{
+			const u32 chunk = (u32)next_chunk.add(1);
+			if (chunk >= chunks_count) break;
+
+			const u32 begin = chunk * grain;
+			const u32 end = (u32)minimum((u64)begin + grain, (u64)count);
+			ctx->Prepare(job);
+			ctx->SetArgDWord(0, begin);
+			ctx->SetArgDWord(1, end);
+			SetScriptArrayWriteRange(begin, end);
+			budget = ExecutionBudget();
+			budget.start = os::Timer::getRawTimestamp();
+			const int r = ctx->Execute();
+			ClearScriptArrayWriteRange();
+			if (r != asEXECUTION_FINISHED)
+			{
+				if (failed.add(1) == 0)
+				{
+					const char* msg = r == asEXECUTION_EXCEPTION ? ctx->GetExceptionString() : "job aborted";
+					if (budget.expired) msg = budget.expired;
+					copyString(Span(error), msg);
+				}
+				break;
+			}
+		}
+		ctx->SetUserData(nullptr, CONTEXT_WATCHDOG);
+		ctx->Unprepare();
+	});
+
+	for (asIScriptContext* ctx : m_parallel_contexts)
+	{
+		m_frame_vm_stats.instructions += ctx->GetExecutedInstructionCount();
+		m_frame_vm_stats.script_calls += (u32)ctx->GetScriptCallCount();
+	}
+	m_frame_vm_stats.instructions -= instructions;
+	m_frame_vm_stats.script_calls -= (u32)script_calls;
+
+	job->Release();
+	if (failed) caller->SetException(error);
+}
+
+void AngelScriptSystemImpl::registerParallelAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	// Jobs run on worker threads, they may read globals and modify only elements [begin, end) of global arrays.
+	// A job is a global function, a delegate would share its object between workers.
+	r = engine->RegisterFuncdef("void ParallelJob(uint begin, uint end)");
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void parallel_for(uint count, uint grain, ParallelJob@ job)",
+		asMETHOD(AngelScriptSystemImpl, scriptParallelFor),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+
+	markParallelSafe(engine, "Vec2");
+	markParallelSafe(engine, "Vec3");
+	markParallelSafe(engine, "DVec3");
+	markParallelSafe(engine, "Vec4");
+	markParallelSafe(engine, "Quat");
+	markParallelSafe(engine, "Entity");
+
+	static const char* const math_functions[] = {"float sin(float)",
+		"float cos(float)",
+		"float tan(float)",
+		"float asin(float)",
+		"float acos(float)",
+		"float atan(float)",
+		"float atan2(float, float)",
+		"float sqrt(float)",
+		"float pow(float, float)",
+		"float floor(float)",
+		"float ceil(float)",
+		"float abs(float)",
+		"float min(float, float)",
+		"float max(float, float)",
+		"float clamp(float, float, float)",
+		"float lerp(float, float, float)"};
+	for (const char* decl : math_functions)
+	{
+		asIScriptFunction* func = engine->GetGlobalFunctionByDecl(decl);
+		ASSERT(func);
+		setParallelSafety(func, ParallelSafety::SAFE);
+	}
+}
+
+void AngelScriptSystemImpl::registerResourceAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	// The callback gets the handle once the resource is ready or failed, the script then owns the handle
+	r = engine->RegisterFuncdef("void ResourceLoadedCallback(int resource, bool success)");
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"int loadResourceAsync(const String &in path, const String &in type, ResourceLoadedCallback@ callback)",
+		asFUNCTION(AS_loadResourceAsync),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void unloadResource(int)",
+		asMETHOD(AngelScriptSystemImpl, unloadASResource),
+		asCALL_THISCALL_ASGLOBAL,
+		this);
+	ASSERT(r >= 0);
+
+	// Typed handle, loads on construction and keeps the resource loaded while any copy is alive
+	r = engine->RegisterObjectType("Resource", sizeof(ScriptResource), asOBJ_VALUE | asOBJ_APP_CLASS_CDAK);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectBehaviour("Resource",
+		asBEHAVE_CONSTRUCT,
+		"void f()",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceConstruct),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectBehaviour("Resource",
+		asBEHAVE_CONSTRUCT,
+		"void f(const String &in path, const String &in type)",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceLoad),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectBehaviour("Resource",
+		asBEHAVE_CONSTRUCT,
+		"void f(const Resource &in)",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceCopy),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectBehaviour("Resource",
+		asBEHAVE_DESTRUCT,
+		"void f()",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceDestruct),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectMethod("Resource",
+		"Resource& opAssign(const Resource &in)",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceAssign),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectMethod("Resource",
+		"bool isValid() const",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceIsValid),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectMethod("Resource",
+		"bool isReady() const",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceIsReady),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectMethod("Resource",
+		"bool isFailure() const",
+		asMETHOD(AngelScriptSystemImpl, scriptResourceIsFailure),
+		asCALL_THISCALL_OBJFIRST,
+		this);
+	ASSERT(r >= 0);
+}
+
+void AngelScriptSystemImpl::registerFileAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	// Reads and writes run in the background, callbacks are called from the module update of the next frames.
+	// Writes and stream chunks are written in the order they were issued.
+	r = engine->RegisterFuncdef("void FileReadCallback(bool success, array<uint8>@ data)");
+	ASSERT(r >= 0);
+	r = engine->RegisterFuncdef("void TextFileReadCallback(bool success, const String &in text)");
+	ASSERT(r >= 0);
+	r = engine->RegisterFuncdef("void FileWriteCallback(bool success)");
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void readFile(const String &in path, FileReadCallback@ callback)", asFUNCTION(AS_readFile), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void readTextFile(const String &in path, TextFileReadCallback@ callback)",
+		asFUNCTION(AS_readTextFile),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void writeFile(const String &in path, const array<uint8> &in data, FileWriteCallback@ callback = null)",
+		asFUNCTION(AS_writeFile),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void writeFile(const String &in path, const String &in text, FileWriteCallback@ callback = null)",
+		asFUNCTION(AS_writeTextFile),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void appendFile(const String &in path, const array<uint8> &in data, FileWriteCallback@ callback = null)",
+		asFUNCTION(AS_appendFile),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void appendFile(const String &in path, const String &in text, FileWriteCallback@ callback = null)",
+		asFUNCTION(AS_appendTextFile),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+
+	// Streams keep the file open for large logs and dumps, they are closed with the owning script instance
+	r = engine->RegisterGlobalFunction(
+		"uint openFileStream(const String &in path)", asFUNCTION(AS_openFileStream), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void writeFileStream(uint stream, const array<uint8> &in data)",
+		asFUNCTION(AS_writeFileStream),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void writeFileStream(uint stream, const String &in text)",
+		asFUNCTION(AS_writeTextFileStream),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void closeFileStream(uint stream, FileWriteCallback@ callback = null)",
+		asFUNCTION(AS_closeFileStream),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+}
+
+void AngelScriptSystemImpl::registerNetworkAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	r = engine->RegisterEnum("NetworkEvent");
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("NetworkEvent", "CONNECTED", (int)ASNetwork::EventType::CONNECTED);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("NetworkEvent", "ACCEPTED", (int)ASNetwork::EventType::ACCEPTED);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("NetworkEvent", "CLOSED", (int)ASNetwork::EventType::CLOSED);
+	ASSERT(r >= 0);
+	r = engine->RegisterEnumValue("NetworkEvent", "FAILURE", (int)ASNetwork::EventType::FAILURE);
+	ASSERT(r >= 0);
+
+	// Sockets are polled once per frame in the module update. `data` is reused by the next callback unless the
+	// script keeps a handle to it, `from_ip` is set for UDP only. Sockets are closed with their script instance.
+	r = engine->RegisterFuncdef("void NetworkEventCallback(uint socket, NetworkEvent event, uint peer)");
+	ASSERT(r >= 0);
+	r = engine->RegisterFuncdef(
+		"void NetworkDataCallback(uint socket, array<uint8>@ data, const String &in from_ip, uint16 from_port)");
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"uint networkConnect(const String &in ip, uint16 port, "
+		"NetworkEventCallback@ on_event, NetworkDataCallback@ on_data)",
+		asFUNCTION(AS_networkConnect),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"uint networkListen(const String &in ip, uint16 port, "
+		"NetworkEventCallback@ on_event, NetworkDataCallback@ on_data)",
+		asFUNCTION(AS_networkListen),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"uint networkOpenUDP(const String &in ip, uint16 port, "
+		"NetworkEventCallback@ on_event, NetworkDataCallback@ on_data)",
+		asFUNCTION(AS_networkOpenUDP),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"bool networkWrite(uint socket, const array<uint8> &in data)", asFUNCTION(AS_networkWrite), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"bool networkWrite(uint socket, const String &in text)", asFUNCTION(AS_networkWriteText), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"bool networkSendTo(uint socket, const String &in ip, uint16 port, const array<uint8> &in data)",
+		asFUNCTION(AS_networkSendTo),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"bool networkSendTo(uint socket, const String &in ip, uint16 port, const String &in text)",
+		asFUNCTION(AS_networkSendTextTo),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void networkClose(uint socket)", asFUNCTION(AS_networkClose), asCALL_CDECL);
+	ASSERT(r >= 0);
+}
+
+void AngelScriptSystemImpl::registerTimerAPI(asIScriptEngine* engine)
+{
+	int r;
+
+	// Timers belong to the calling script instance and are cancelled when it is reloaded or destroyed
+	r = engine->RegisterFuncdef("void TimerCallback()");
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"uint setTimeout(TimerCallback@, float)", asFUNCTION(AS_setTimeout), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"uint setInterval(TimerCallback@, float)", asFUNCTION(AS_setInterval), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void clearTimer(uint)", asFUNCTION(AS_clearTimer), asCALL_CDECL);
+	ASSERT(r >= 0);
+}
+
+void AngelScriptSystemImpl::registerMessageAPI(asIScriptEngine* engine)
+{
+	using ScriptMessage = AngelScriptModuleImpl::ScriptMessage;
+	int r;
+
+	// Handlers are `void on<Name>(const Message@ msg)`, the message is valid only during the call
+	r = engine->RegisterObjectType("Message", 0, asOBJ_REF | asOBJ_NOCOUNT);
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("Message", "const Entity sender", asOFFSET(ScriptMessage, sender));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("Message", "const int int_value", asOFFSET(ScriptMessage, int_value));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("Message", "const float float_value", asOFFSET(ScriptMessage, float_value));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("Message", "const Vec3 vec3_value", asOFFSET(ScriptMessage, vec3_value));
+	ASSERT(r >= 0);
+	r = engine->RegisterObjectProperty("Message", "const String text", asOFFSET(ScriptMessage, text));
+	ASSERT(r >= 0);
+
+	r = engine->RegisterGlobalFunction(
+		"void postMessage(const Entity &in, const String &in)", asFUNCTION(AS_postMessage), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void postMessage(const Entity &in, const String &in, int)", asFUNCTION(AS_postMessageInt), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction(
+		"void postMessage(const Entity &in, const String &in, float)", asFUNCTION(AS_postMessageFloat), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void postMessage(const Entity &in, const String &in, const Vec3 &in)",
+		asFUNCTION(AS_postMessageVec3),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("void postMessage(const Entity &in, const String &in, const String &in)",
+		asFUNCTION(AS_postMessageText),
+		asCALL_CDECL);
+	ASSERT(r >= 0);
 }
 
 void AngelScriptSystemImpl::createModules(World& world)
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "core/array.h"
 #include "core/hash.h"
 #include "core/path.h"
+#include "core/span.h"
 #include "core/string.h"
 #include "engine/plugin.h"
 #include "engine/resource.h"
@@ -15,14 +17,215 @@ namespace Lumix
 
 struct ASScript;
 
+// Flattened copy of InputSystem::Event, the way scripts see it
+struct ASInputEvent
+{
+	u32 type;
+	u32 device_type;
+	u32 key_id;
+	bool down;
+	bool is_repeat;
+	float x;
+	float y;
+	float x_abs;
+	float y_abs;
+	u32 utf8;
+};
+
+// Input state built once per frame from InputSystem::getEvents
+struct ASInputSnapshot
+{
+	explicit ASInputSnapshot(IAllocator& allocator)
+		: events(allocator)
+	{
+	}
+
+	static bool test(const u64* bits, u32 idx) { return idx < 256 && (bits[idx >> 6] & (1ULL << (idx & 63))) != 0; }
+
+	bool isKeyDown(u32 keycode) const { return test(keys_down, keycode); }
+	bool wasKeyPressed(u32 keycode) const { return test(keys_pressed, keycode); }
+	bool wasKeyReleased(u32 keycode) const { return test(keys_released, keycode); }
+	bool isMouseButtonDown(u32 button) const { return button < 32 && (mouse_down & (1 << button)) != 0; }
+
+	u64 keys_down[4] = {};
+	u64 keys_pressed[4] = {};
+	u64 keys_released[4] = {};
+	u32 mouse_down = 0;
+	Array<ASInputEvent> events;
+};
+
 struct AngelScriptSystem : ISystem
 {
+	// Profiler blocks opened for script code, CALLBACKS labels each call from the engine into a script,
+	// FUNCTIONS additionally nests a block for every script function call
+	enum class ProfilerZones : u8
+	{
+		NONE,
+		CALLBACKS,
+		FUNCTIONS
+	};
+
+	// DISABLED costs nothing, PER_FRAME publishes and resets the counters in each update, SESSION accumulates
+	// until resetFunctionStats
+	enum class FunctionStatsMode : u8
+	{
+		DISABLED,
+		PER_FRAME,
+		SESSION
+	};
+
+	// Counters of one script function object, reported by the VM on calls and returns. Overloads have separate
+	// entries and a reloaded script gets new ones.
+	struct FunctionStats
+	{
+		const char* name;
+		u64 calls = 0;
+		// bytecode instructions executed in the function itself
+		u64 instructions = 0;
+		// seconds
+		double inclusive_time = 0;
+		double exclusive_time = 0;
+	};
+
+	// Calls of one registered application function from one script function
+	struct NativeCallStats
+	{
+		const char* name;
+		// null if called directly by the engine
+		const char* caller;
+		u32 function_id;
+		u64 calls = 0;
+		// seconds
+		double time = 0;
+	};
+
+	// VM-wide numbers, refreshed in each update and pushed to profiler counters
+	struct VMStats
+	{
+		// last frame
+		u32 callbacks = 0;
+		// calls of script functions from scripts, counted by the VM
+		u32 script_calls = 0;
+		// counted while native call tracing is enabled
+		u32 native_calls = 0;
+		// executed bytecode instructions, counted by the VM
+		u64 instructions = 0;
+		// most contexts executing at once, i.e. nesting of execute()
+		u32 peak_active_contexts = 0;
+		float compile_time = 0;
+		// current state
+		u32 contexts = 0;
+		u32 pooled_contexts = 0;
+		// stack blocks allocated by all contexts
+		u64 stack_bytes = 0;
+		u32 gc_objects = 0;
+		u32 gc_new_objects = 0;
+		u32 gc_old_objects = 0;
+		u32 string_constants = 0;
+		u32 modules = 0;
+		u64 bytecode_bytes = 0;
+		// since the system was created
+		u64 gc_destroyed = 0;
+		u64 gc_detected = 0;
+		double total_compile_time = 0;
+	};
+
+	// AngelScript memory attributed to one script file, "angelscript" holds the rest
+	struct ScriptMemory
+	{
+		const char* path;
+		// bytecode, globals, string constants
+		u64 compiled_bytes;
+		// script objects and other memory allocated while the script runs
+		u64 runtime_bytes;
+		u64 peak_runtime_bytes;
+		u64 allocations;
+		// 0 is unlimited
+		u64 limit;
+		// script objects and arrays refused because of the limit
+		u64 limit_failures;
+	};
+
+	struct ObjectTypeCount
+	{
+		const char* type;
+		u32 count;
+	};
+
+	// Generational handle, stale handles resolve to nullptr; 0xffFFffFF is never valid
 	using ASResourceHandle = u32;
 
+	// Script callstack seen by the sampling profiler, `stack` is folded, i.e. "outer;inner;leaf:line"
+	struct SampledStack
+	{
+		explicit SampledStack(IAllocator& allocator)
+			: stack(allocator)
+		{
+		}
+
+		String stack;
+		u32 count = 0;
+	};
+
 	virtual asIScriptEngine* getEngine() = 0;
+	virtual const ASInputSnapshot& getInputSnapshot() = 0;
 	virtual struct Resource* getASResource(ASResourceHandle idx) const = 0;
 	virtual ASResourceHandle addASResource(const struct Path& path, struct ResourceType type) = 0;
 	virtual void unloadASResource(ASResourceHandle resource_idx) = 0;
+	virtual void setProfilerZones(ProfilerZones zones) = 0;
+	virtual ProfilerZones getProfilerZones() const = 0;
+	// Sampling profiler, a background thread requests a callstack sample every `interval_ms` while a script runs
+	virtual void startSampling(u32 interval_ms) = 0;
+	virtual void stopSampling() = 0;
+	virtual bool isSampling() const = 0;
+	virtual void clearSamples() = 0;
+	virtual Span<const SampledStack> getSampledStacks() const = 0;
+	virtual u32 getSampleCount() const = 0;
+	virtual u32 getDroppedSampleCount() const = 0;
+	// Folded stacks, one "stack count" line each, the input format of flamegraph.pl and speedscope
+	virtual void writeFoldedStacks(OutputMemoryStream& stream) const = 0;
+	virtual void setFunctionStatsMode(FunctionStatsMode mode) = 0;
+	virtual FunctionStatsMode getFunctionStatsMode() const = 0;
+	// With PER_FRAME these are the counters of the last finished frame
+	virtual Span<const FunctionStats> getFunctionStats() const = 0;
+	virtual void resetFunctionStats() = 0;
+	// Timeline of callbacks and compiles, `-angelscript_trace <path>` records from start to shutdown
+	virtual void startTrace() = 0;
+	virtual void stopTrace() = 0;
+	virtual bool isTracing() const = 0;
+	// Chrome trace-event JSON, loads in chrome://tracing and Perfetto
+	virtual void writeTrace(OutputMemoryStream& stream) const = 0;
+	// Native call tracing needs a build with AS_NATIVE_CALL_HOOK (genie --angelscript-native-trace), otherwise
+	// it is compiled out. Calls longer than the threshold are also added to the trace.
+	virtual bool isNativeCallTracingAvailable() const = 0;
+	virtual void setNativeCallTracing(bool enable) = 0;
+	virtual bool isNativeCallTracing() const = 0;
+	virtual void setNativeTraceThreshold(u32 microseconds) = 0;
+	virtual u32 getNativeTraceThreshold() const = 0;
+	virtual Span<const NativeCallStats> getNativeCallStats() const = 0;
+	virtual void resetNativeCallStats() = 0;
+	virtual const VMStats& getVMStats() const = 0;
+	// Live garbage collected objects per type, walks the whole GC so it is not part of the per-frame VMStats.
+	// Type names are interned, they stay valid after the types are discarded.
+	virtual void getObjectTypeCounts(Array<ObjectTypeCount>& counts) = 0;
+	virtual void getScriptMemory(Array<ScriptMemory>& out) const = 0;
+	// Runtime memory limit of the script at `path`, allocating a script object or an array above it raises an
+	// exception in the script. An empty path sets the default of scripts without their own limit, 0 is unlimited.
+	// `-angelscript_memory_limit <KB>` sets the default.
+	virtual void setScriptMemoryLimit(const struct Path& path, u64 bytes) = 0;
+	// Watchdog, a script call exceeding either limit is aborted, its stack logged and its instance disabled.
+	// `ticks` counts script calls and backward jumps, checked every 1024 of them; 0 means unlimited.
+	// `-angelscript_watchdog <ms>` sets the time limit.
+	virtual void setWatchdog(u32 ticks, u32 milliseconds) = 0;
+	virtual u32 getWatchdogTicks() const = 0;
+	virtual u32 getWatchdogTime() const = 0;
+	// Serialized ASHeapSnapshot of all live script objects, call while no script runs on other threads
+	virtual void writeHeapSnapshot(OutputMemoryStream& stream) = 0;
+	// Separate engine with the same API, for building scripts on another thread, e.g. editor diagnostics.
+	// Scripts built by it are only for inspection and must not be executed, global initializers are not run either.
+	// Can be called from any thread.
+	virtual asIScriptEngine* createCompileEngine() = 0;
+	virtual void destroyCompileEngine(asIScriptEngine* engine) = 0;
 };
 
 struct AngelScriptModule : IModule
@@ -53,6 +256,20 @@ struct AngelScriptModule : IModule
 		String stored_value;
 	};
 
+	struct MessageStats
+	{
+		// last delivered frame, a message is delivered if at least one handler received it, dropped otherwise
+		u32 posted = 0;
+		u32 delivered = 0;
+		u32 dropped = 0;
+		u32 groups = 0;
+		u32 arena_bytes = 0;
+		// since the module was created
+		u64 total_posted = 0;
+		u64 total_delivered = 0;
+		u64 total_dropped = 0;
+	};
+
 	struct IFunctionCall
 	{
 		virtual ~IFunctionCall() {}
@@ -87,6 +304,7 @@ struct AngelScriptModule : IModule
 	virtual ResourceType getPropertyResourceType(EntityRef entity, int scr_index, int prop_index) = 0;
 	virtual const char* getInlineScriptCode(EntityRef entity) = 0;
 	virtual void setInlineScriptCode(EntityRef entity, const char* value) = 0;
+	virtual const MessageStats& getMessageStats() const = 0;
 };
 
 } // namespace Lumix
\ No newline at end of file
@@ -16,9 +16,10 @@ namespace AngelScriptWrapper
 {
 
 // StringFactory implementation
-StringFactory::StringFactory(IAllocator& allocator)
+StringFactory::StringFactory(IAllocator& allocator, IAllocator& string_allocator)
 	: m_strings(allocator)
 	, m_allocator(allocator)
+	, m_string_allocator(string_allocator)
 {
 }
 
@@ -26,7 +27,7 @@ StringFactory::~StringFactory()
 {
 	for (auto iter : m_strings.iterated())
 	{
-		LUMIX_DELETE(m_allocator, iter.value());
+		LUMIX_DELETE(m_string_allocator, iter.value());
 	}
 }
 
@@ -41,7 +42,7 @@ const void* StringFactory::GetStringConstant(const char* data, asUINT length)
 		return &iter.value()->string;
 	}
 
-	StringData* str_data = LUMIX_NEW(m_allocator, StringData)(data, length, m_allocator);
+	StringData* str_data = LUMIX_NEW(m_string_allocator, StringData)(data, length, m_string_allocator);
 	m_strings.insert(hash, str_data);
 	return &str_data->string;
 }
@@ -56,7 +57,7 @@ int StringFactory::ReleaseStringConstant(const void* str)
 			iter.value()->ref_count--;
 			if (iter.value()->ref_count == 0)
 			{
-				LUMIX_DELETE(m_allocator, iter.value());
+				LUMIX_DELETE(m_string_allocator, iter.value());
 				m_strings.erase(iter);
 			}
 			return 0;
@@ -392,6 +393,32 @@ Vec3 QuatRotateVec3(const Quat& q, const Vec3& v)
 }
 
 // Utility functions
+// Scalar math, pure and safe to call from parallel_for jobs
+static float MathAbs(float x)
+{
+	return fabsf(x);
+}
+
+static float MathMin(float a, float b)
+{
+	return minimum(a, b);
+}
+
+static float MathMax(float a, float b)
+{
+	return maximum(a, b);
+}
+
+static float MathClamp(float x, float min, float max)
+{
+	return clamp(x, min, max);
+}
+
+static float MathLerp(float a, float b, float t)
+{
+	return a + (b - a) * t;
+}
+
 void logError(const String& message)
 {
 	Lumix::logError(message.c_str());
@@ -639,6 +666,44 @@ void registerMathTypes(asIScriptEngine* engine)
 	ASSERT(r >= 0);
 }
 
+void registerMathFunctions(asIScriptEngine* engine)
+{
+	int r;
+
+	r = engine->RegisterGlobalFunction("float sin(float)", asFUNCTION(sinf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float cos(float)", asFUNCTION(cosf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float tan(float)", asFUNCTION(tanf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float asin(float)", asFUNCTION(asinf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float acos(float)", asFUNCTION(acosf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float atan(float)", asFUNCTION(atanf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float atan2(float, float)", asFUNCTION(atan2f), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float sqrt(float)", asFUNCTION(sqrtf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float pow(float, float)", asFUNCTION(powf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float floor(float)", asFUNCTION(floorf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float ceil(float)", asFUNCTION(ceilf), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float abs(float)", asFUNCTION(MathAbs), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float min(float, float)", asFUNCTION(MathMin), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float max(float, float)", asFUNCTION(MathMax), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float clamp(float, float, float)", asFUNCTION(MathClamp), asCALL_CDECL);
+	ASSERT(r >= 0);
+	r = engine->RegisterGlobalFunction("float lerp(float, float, float)", asFUNCTION(MathLerp), asCALL_CDECL);
+	ASSERT(r >= 0);
+}
+
 void registerEntityTypes(asIScriptEngine* engine)
 {
 	int r;
@@ -18,7 +18,8 @@ namespace AngelScriptWrapper
 
 struct StringFactory : public asIStringFactory
 {
-	StringFactory(IAllocator& allocator);
+	// constants are allocated from `string_allocator`
+	StringFactory(IAllocator& allocator, IAllocator& string_allocator);
 	~StringFactory();
 
 	const void* GetStringConstant(const char* data, asUINT length) override;
@@ -40,6 +41,7 @@ struct StringFactory : public asIStringFactory
 
 	HashMap<StableHash, StringData*> m_strings;
 	IAllocator& m_allocator;
+	IAllocator& m_string_allocator;
 };
 
 // Entity construction/destruction helpers
@@ -131,6 +133,7 @@ void logInfo(const String& message);
 // Registration helpers
 void registerBasicTypes(asIScriptEngine* engine);
 void registerMathTypes(asIScriptEngine* engine);
+void registerMathFunctions(asIScriptEngine* engine);
 void registerEntityTypes(asIScriptEngine* engine);
 void registerStringType(asIScriptEngine* engine, StringFactory* string_factory);
 
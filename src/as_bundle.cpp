@@ -0,0 +1,213 @@
+#include "as_bundle.h"
+#include "core/crt.h"
+#include "core/hash.h"
+#include "core/path.h"
+#include "core/profiler.h"
+#include "core/stream.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace Lumix
+{
+
+// data of every script starts at a multiple of this
+static constexpr u64 BUNDLE_ALIGNMENT = 8;
+
+int ASBytecodeReader::Read(void* ptr, asUINT size)
+{
+	if (m_position + size > m_data.length()) return -1;
+	memcpy(ptr, m_data.begin() + m_position, size);
+	m_position += size;
+	return 0;
+}
+
+int ASBytecodeWriter::Write(const void* ptr, asUINT size)
+{
+	m_stream.write(ptr, size);
+	return 0;
+}
+
+ASBundle::~ASBundle() { close(); }
+
+// Declarations of everything registered, in registration order
+u64 ASBundle::computeAPIHash(asIScriptEngine& engine, IAllocator& allocator)
+{
+	OutputMemoryStream declarations(allocator);
+	auto add = [&](const char* str) { declarations.write(str, stringLength(str) + 1); };
+	for (asUINT i = 0, c = engine.GetObjectTypeCount(); i < c; ++i)
+	{
+		asITypeInfo* type = engine.GetObjectTypeByIndex(i);
+		add(type->GetName());
+		for (asUINT j = 0, mc = type->GetMethodCount(); j < mc; ++j)
+		{
+			add(type->GetMethodByIndex(j)->GetDeclaration());
+		}
+	}
+	for (asUINT i = 0, c = engine.GetGlobalFunctionCount(); i < c; ++i)
+	{
+		add(engine.GetGlobalFunctionByIndex(i)->GetDeclaration(true, true));
+	}
+	for (asUINT i = 0, c = engine.GetGlobalPropertyCount(); i < c; ++i)
+	{
+		const char* name;
+		engine.GetGlobalPropertyByIndex(i, &name);
+		add(name);
+	}
+	return StableHash(declarations.data(), (u32)declarations.size()).getHashValue();
+}
+
+u64 ASBundle::getPathHash(const Path& path) { return StableHash(path.c_str()).getHashValue(); }
+
+bool ASBundle::open(const char* path)
+{
+	PROFILE_FUNCTION();
+	close();
+
+	u64 size = 0;
+	const u8* data = nullptr;
+#ifdef _WIN32
+	const DWORD share = FILE_SHARE_READ;
+	HANDLE file = CreateFileA(path, GENERIC_READ, share, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER file_size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	// the view keeps the mapping and the file alive
+	CloseHandle(file);
+	if (!mapping) return false;
+	data = (const u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	size = (u64)file_size.QuadPart;
+#else
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void* mem = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mem != MAP_FAILED) data = (const u8*)mem;
+		size = (u64)st.st_size;
+	}
+	// the mapping keeps the file alive
+	::close(fd);
+#endif
+	if (!data) return false;
+
+	m_data = data;
+	m_size = size;
+
+	const Header& header = getHeader();
+	bool valid = size >= sizeof(Header) && header.magic == MAGIC && header.version == VERSION;
+	valid = valid && header.count <= (size - sizeof(Header)) / sizeof(Entry);
+	for (u32 i = 0; valid && i < header.count; ++i)
+	{
+		const Entry& entry = getEntries()[i];
+		valid = entry.offset <= size && entry.size <= size - entry.offset && entry.size >= sizeof(u32);
+		u32 header_size = 0;
+		if (valid) memcpy(&header_size, m_data + entry.offset, sizeof(header_size));
+		valid = valid && header_size <= entry.size - sizeof(header_size);
+	}
+	if (!valid)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void ASBundle::close()
+{
+	if (!m_data) return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+#else
+	munmap((void*)m_data, (size_t)m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+
+bool ASBundle::find(const Path& path, Script& script) const
+{
+	if (!m_data) return false;
+
+	const u64 hash = getPathHash(path);
+	const Entry* entries = getEntries();
+	u32 lo = 0, hi = getHeader().count;
+	while (lo < hi)
+	{
+		const u32 mid = (lo + hi) / 2;
+		if (entries[mid].path_hash < hash) lo = mid + 1;
+		else hi = mid;
+	}
+	if (lo == getHeader().count || entries[lo].path_hash != hash) return false;
+
+	// sizes were checked in open
+	const u8* begin = m_data + entries[lo].offset;
+	const u8* end = begin + entries[lo].size;
+	u32 header_size;
+	memcpy(&header_size, begin, sizeof(header_size));
+	begin += sizeof(header_size);
+	script.header = Span<const u8>(begin, begin + header_size);
+	script.bytecode = Span<const u8>(begin + header_size, end);
+	return true;
+}
+
+ASBundleWriter::ASBundleWriter(IAllocator& allocator)
+	: m_entries(allocator)
+	, m_data(allocator)
+{
+}
+
+void ASBundleWriter::add(const Path& path, Span<const u8> header, Span<const u8> bytecode)
+{
+	while (m_data.size() % BUNDLE_ALIGNMENT) m_data.write((u8)0);
+
+	// offset is relative to the data for now, write() moves it behind the index
+	ASBundle::Entry entry;
+	entry.path_hash = ASBundle::getPathHash(path);
+	entry.offset = m_data.size();
+	entry.size = sizeof(u32) + header.length() + bytecode.length();
+	m_data.write((u32)header.length());
+	m_data.write(header.begin(), header.length());
+	m_data.write(bytecode.begin(), bytecode.length());
+
+	// sorted insert, bundles are written once per export
+	u32 idx = m_entries.size();
+	while (idx > 0 && m_entries[idx - 1].path_hash > entry.path_hash) --idx;
+	m_entries.insert(idx, entry);
+}
+
+void ASBundleWriter::write(OutputMemoryStream& stream, u64 api_hash)
+{
+	ASBundle::Header header;
+	header.magic = ASBundle::MAGIC;
+	header.version = ASBundle::VERSION;
+	header.api_hash = api_hash;
+	header.count = m_entries.size();
+	header.reserved = 0;
+	stream.write(header);
+
+	u64 data_start = sizeof(header) + m_entries.byte_size();
+	data_start = (data_start + BUNDLE_ALIGNMENT - 1) / BUNDLE_ALIGNMENT * BUNDLE_ALIGNMENT;
+	for (ASBundle::Entry entry : m_entries)
+	{
+		entry.offset += data_start;
+		stream.write(entry);
+	}
+	while (stream.size() < data_start) stream.write((u8)0);
+	stream.write(m_data.data(), m_data.size());
+}
+
+} // namespace Lumix
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/span.h"
+#include "core/stream.h"
+#include <angelscript.h>
+
+namespace Lumix
+{
+
+struct Path;
+
+// Reads bytecode straight from memory, e.g. from a mapped bundle
+struct ASBytecodeReader final : asIBinaryStream
+{
+	explicit ASBytecodeReader(Span<const u8> data)
+		: m_data(data)
+	{
+	}
+
+	int Read(void* ptr, asUINT size) override;
+	int Write(const void* ptr, asUINT size) override { return -1; }
+
+	Span<const u8> m_data;
+	u64 m_position = 0;
+};
+
+struct ASBytecodeWriter final : asIBinaryStream
+{
+	explicit ASBytecodeWriter(OutputMemoryStream& stream)
+		: m_stream(stream)
+	{
+	}
+
+	int Read(void* ptr, asUINT size) override { return -1; }
+	int Write(const void* ptr, asUINT size) override;
+
+	OutputMemoryStream& m_stream;
+};
+
+// Header and bytecode of all scripts in one file, for shipping builds. The file is mapped read-only, an ASScript
+// in the bundle is made ready from its header without reading its compiled asset, and its module is loaded directly
+// from the mapping. Bytecode references registered functions and types, so a bundle is only valid for an engine with
+// the API it was built with, see computeAPIHash.
+struct ASBundle
+{
+	struct Header
+	{
+		u32 magic;
+		u32 version;
+		u64 api_hash;
+		u32 count;
+		u32 reserved;
+	};
+
+	// Sorted by path_hash, offset is from the start of the file. The data is the u32 size of the serialized
+	// ASScriptHeader, the header and the bytecode.
+	struct Entry
+	{
+		u64 path_hash;
+		u64 offset;
+		u64 size;
+	};
+
+	struct Script
+	{
+		Span<const u8> header;
+		Span<const u8> bytecode;
+	};
+
+	static constexpr u32 MAGIC = 0x43425341; // "ASBC"
+	static constexpr u32 VERSION = 2;
+
+	ASBundle() = default;
+	~ASBundle();
+	ASBundle(const ASBundle&) = delete;
+	void operator=(const ASBundle&) = delete;
+
+	static u64 computeAPIHash(asIScriptEngine& engine, IAllocator& allocator);
+	static u64 getPathHash(const Path& path);
+
+	bool open(const char* path);
+	void close();
+	bool isOpen() const { return m_data != nullptr; }
+	u64 getAPIHash() const { return getHeader().api_hash; }
+	u32 getCount() const { return getHeader().count; }
+	// False if the bundle does not have the script
+	bool find(const Path& path, Script& script) const;
+
+private:
+	const Header& getHeader() const { return *(const Header*)m_data; }
+	const Entry* getEntries() const { return (const Entry*)(m_data + sizeof(Header)); }
+
+	const u8* m_data = nullptr;
+	u64 m_size = 0;
+};
+
+struct ASBundleWriter
+{
+	explicit ASBundleWriter(IAllocator& allocator);
+
+	void add(const Path& path, Span<const u8> header, Span<const u8> bytecode);
+	void write(OutputMemoryStream& stream, u64 api_hash);
+
+	Array<ASBundle::Entry> m_entries;
+	OutputMemoryStream m_data;
+};
+
+} // namespace Lumix
@@ -0,0 +1,294 @@
+#include "as_completion_index.h"
+#include "core/crt.h"
+#include "core/profiler.h"
+#include <angelscript.h>
+
+namespace Lumix
+{
+
+static char toLower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+
+static u32 getTrigram(const char* str)
+{
+	return ((u32)(u8)toLower(str[0]) << 16) | ((u32)(u8)toLower(str[1]) << 8) | (u32)(u8)toLower(str[2]);
+}
+
+// <0, 0 or >0 like strcmp, `b` is compared only up to `b_len`
+static int compareInsensitive(const char* a, const char* b, u32 b_len)
+{
+	for (u32 i = 0; i < b_len; ++i)
+	{
+		const char ca = toLower(a[i]);
+		const char cb = toLower(b[i]);
+		if (ca != cb) return (u8)ca < (u8)cb ? -1 : 1;
+	}
+	return 0;
+}
+
+static bool startsWithInsensitive(const char* str, StringView prefix)
+{
+	for (u32 i = 0; i < prefix.size(); ++i)
+	{
+		if (!str[i] || toLower(str[i]) != toLower(prefix.begin[i])) return false;
+	}
+	return true;
+}
+
+static bool containsInsensitive(const char* str, StringView text)
+{
+	for (const char* c = str; *c; ++c)
+	{
+		if (startsWithInsensitive(c, text)) return true;
+	}
+	return false;
+}
+
+// Heap sort, indices are built once per module build and must not degrade on sorted input
+template <typename T, typename Less> static void heapSort(T* data, u32 count, Less less)
+{
+	auto siftDown = [&](u32 root, u32 end) {
+		for (;;)
+		{
+			u32 child = root * 2 + 1;
+			if (child >= end) return;
+			if (child + 1 < end && less(data[child], data[child + 1])) ++child;
+			if (!less(data[root], data[child])) return;
+			const T tmp = data[root];
+			data[root] = data[child];
+			data[child] = tmp;
+			root = child;
+		}
+	};
+
+	for (u32 i = count / 2; i > 0; --i) siftDown(i - 1, count);
+	for (u32 end = count; end > 1; --end)
+	{
+		const T tmp = data[0];
+		data[0] = data[end - 1];
+		data[end - 1] = tmp;
+		siftDown(0, end - 1);
+	}
+}
+
+ASCompletionIndex::ASCompletionIndex(IAllocator& allocator)
+	: m_strings(allocator)
+	, m_symbols(allocator)
+	, m_sorted(allocator)
+	, m_trigrams(allocator)
+{
+	clear();
+}
+
+void ASCompletionIndex::clear()
+{
+	m_strings.clear();
+	m_symbols.clear();
+	m_sorted.clear();
+	m_trigrams.clear();
+	// offset 0 is the empty string
+	m_strings.push('\0');
+}
+
+u32 ASCompletionIndex::addString(const char* str)
+{
+	if (!str || !str[0]) return 0;
+
+	const u32 offset = m_strings.size();
+	const u32 len = stringLength(str);
+	m_strings.resize(offset + len + 1);
+	memcpy(m_strings.begin() + offset, str, len + 1);
+	return offset;
+}
+
+void ASCompletionIndex::addSymbol(Kind kind, const char* name, const char* declaration, const char* parent)
+{
+	if (!name || !name[0]) return;
+
+	Symbol& symbol = m_symbols.emplace();
+	symbol.kind = kind;
+	symbol.name = addString(name);
+	symbol.declaration = addString(declaration);
+	symbol.parent = addString(parent);
+}
+
+void ASCompletionIndex::addTypeMembers(asITypeInfo& type)
+{
+	const char* type_name = type.GetName();
+	for (asUINT i = 0, c = type.GetMethodCount(); i < c; ++i)
+	{
+		asIScriptFunction* method = type.GetMethodByIndex(i);
+		addSymbol(Kind::METHOD, method->GetName(), method->GetDeclaration(false, false, true), type_name);
+	}
+	for (asUINT i = 0, c = type.GetPropertyCount(); i < c; ++i)
+	{
+		const char* name;
+		type.GetProperty(i, &name);
+		addSymbol(Kind::PROPERTY, name, type.GetPropertyDeclaration(i), type_name);
+	}
+	for (asUINT i = 0, c = type.GetEnumValueCount(); i < c; ++i)
+	{
+		int value;
+		const char* name = type.GetEnumValueByIndex(i, &value);
+		const StaticString<256> declaration(type_name, "::", name, " = ", value);
+		addSymbol(Kind::ENUM_VALUE, name, declaration, nullptr);
+	}
+}
+
+void ASCompletionIndex::buildFromEngine(asIScriptEngine& engine)
+{
+	PROFILE_FUNCTION();
+	clear();
+
+	for (asUINT i = 0, c = engine.GetGlobalFunctionCount(); i < c; ++i)
+	{
+		asIScriptFunction* func = engine.GetGlobalFunctionByIndex(i);
+		addSymbol(Kind::FUNCTION, func->GetName(), func->GetDeclaration(false, true, true), nullptr);
+	}
+	for (asUINT i = 0, c = engine.GetGlobalPropertyCount(); i < c; ++i)
+	{
+		const char* name;
+		int type_id;
+		engine.GetGlobalPropertyByIndex(i, &name, nullptr, &type_id);
+		const StaticString<256> declaration(engine.GetTypeDeclaration(type_id, true), " ", name);
+		addSymbol(Kind::GLOBAL, name, declaration, nullptr);
+	}
+	for (asUINT i = 0, c = engine.GetObjectTypeCount(); i < c; ++i)
+	{
+		asITypeInfo* type = engine.GetObjectTypeByIndex(i);
+		addSymbol(Kind::TYPE, type->GetName(), type->GetName(), nullptr);
+		addTypeMembers(*type);
+	}
+	for (asUINT i = 0, c = engine.GetEnumCount(); i < c; ++i)
+	{
+		asITypeInfo* type = engine.GetEnumByIndex(i);
+		addSymbol(Kind::TYPE, type->GetName(), type->GetName(), nullptr);
+		addTypeMembers(*type);
+	}
+	for (asUINT i = 0, c = engine.GetFuncdefCount(); i < c; ++i)
+	{
+		asITypeInfo* type = engine.GetFuncdefByIndex(i);
+		asIScriptFunction* signature = type->GetFuncdefSignature();
+		addSymbol(Kind::FUNCDEF, type->GetName(), signature->GetDeclaration(false, true, true), nullptr);
+	}
+
+	finalize();
+}
+
+void ASCompletionIndex::buildFromModule(asIScriptModule& module)
+{
+	PROFILE_FUNCTION();
+	clear();
+
+	for (asUINT i = 0, c = module.GetFunctionCount(); i < c; ++i)
+	{
+		asIScriptFunction* func = module.GetFunctionByIndex(i);
+		addSymbol(Kind::FUNCTION, func->GetName(), func->GetDeclaration(false, true, true), nullptr);
+	}
+	for (asUINT i = 0, c = module.GetGlobalVarCount(); i < c; ++i)
+	{
+		const char* name;
+		module.GetGlobalVar(i, &name);
+		addSymbol(Kind::GLOBAL, name, module.GetGlobalVarDeclaration(i, true), nullptr);
+	}
+	for (asUINT i = 0, c = module.GetObjectTypeCount(); i < c; ++i)
+	{
+		asITypeInfo* type = module.GetObjectTypeByIndex(i);
+		addSymbol(Kind::TYPE, type->GetName(), type->GetName(), nullptr);
+		addTypeMembers(*type);
+	}
+	for (asUINT i = 0, c = module.GetEnumCount(); i < c; ++i)
+	{
+		asITypeInfo* type = module.GetEnumByIndex(i);
+		addSymbol(Kind::TYPE, type->GetName(), type->GetName(), nullptr);
+		addTypeMembers(*type);
+	}
+
+	finalize();
+}
+
+void ASCompletionIndex::finalize()
+{
+	m_sorted.resize(m_symbols.size());
+	for (u32 i = 0, c = m_symbols.size(); i < c; ++i) m_sorted[i] = i;
+	heapSort(m_sorted.begin(), m_sorted.size(), [this](u32 a, u32 b) {
+		const char* name_a = getString(m_symbols[a].name);
+		const char* name_b = getString(m_symbols[b].name);
+		// the terminator takes part, so shorter names come first
+		return compareInsensitive(name_a, name_b, stringLength(name_b) + 1) < 0;
+	});
+
+	m_trigrams.clear();
+	for (u32 i = 0, c = m_symbols.size(); i < c; ++i)
+	{
+		const char* name = getString(m_symbols[i].name);
+		for (const char* t = name; t[0] && t[1] && t[2]; ++t)
+		{
+			m_trigrams.push(((u64)getTrigram(t) << 32) | i);
+		}
+	}
+	heapSort(m_trigrams.begin(), m_trigrams.size(), [](u64 a, u64 b) { return a < b; });
+}
+
+void ASCompletionIndex::query(StringView text, StringView parent, u32 max_results, Array<u32>& out) const
+{
+	PROFILE_FUNCTION();
+	auto matchesParent = [&](const Symbol& symbol) {
+		const char* symbol_parent = getString(symbol.parent);
+		if (parent.size() == 0) return symbol_parent[0] == '\0';
+		return stringLength(symbol_parent) == parent.size()
+			&& compareInsensitive(symbol_parent, parent.begin, parent.size()) == 0;
+	};
+	const u32 out_start = out.size();
+
+	// first name not less than `text`
+	u32 lo = 0, hi = m_sorted.size();
+	while (lo < hi)
+	{
+		const u32 mid = (lo + hi) / 2;
+		const char* name = getString(m_symbols[m_sorted[mid]].name);
+		if (compareInsensitive(name, text.begin, text.size()) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+	for (u32 i = lo; i < (u32)m_sorted.size() && out.size() - out_start < max_results; ++i)
+	{
+		const Symbol& symbol = m_symbols[m_sorted[i]];
+		if (!startsWithInsensitive(getString(symbol.name), text)) break;
+		if (matchesParent(symbol)) out.push(m_sorted[i]);
+	}
+
+	if (text.size() < 3) return;
+
+	// candidates come from the rarest trigram of `text`, each is then checked as a whole
+	u32 best_from = 0, best_to = 0xffFFffFF;
+	for (u32 i = 0; i + 2 < text.size(); ++i)
+	{
+		const u64 key = (u64)getTrigram(text.begin + i) << 32;
+		u32 from = 0, to = m_trigrams.size();
+		while (from < to)
+		{
+			const u32 mid = (from + to) / 2;
+			if (m_trigrams[mid] < key) from = mid + 1;
+			else to = mid;
+		}
+		to = from;
+		while (to < (u32)m_trigrams.size() && (m_trigrams[to] >> 32) == (key >> 32)) ++to;
+		if (to - from < best_to - best_from)
+		{
+			best_from = from;
+			best_to = to;
+		}
+	}
+
+	for (u32 i = best_from; i < best_to && out.size() - out_start < max_results; ++i)
+	{
+		const u32 idx = u32(m_trigrams[i]);
+		const Symbol& symbol = m_symbols[idx];
+		const char* name = getString(symbol.name);
+		// prefix matches are already in `out`; a name with the trigram repeated is listed once
+		if (startsWithInsensitive(name, text) || !matchesParent(symbol)) continue;
+		if (i > best_from && u32(m_trigrams[i - 1]) == idx) continue;
+		if (containsInsensitive(name, text)) out.push(idx);
+	}
+}
+
+} // namespace Lumix
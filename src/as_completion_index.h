@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/string.h"
+
+class asIScriptEngine;
+class asIScriptModule;
+class asITypeInfo;
+
+namespace Lumix
+{
+
+// Symbols for autocompletion, from the registered API of an engine or from one module. Lookups are case
+// insensitive; names are found by prefix in a sorted array and by substring with a trigram index. An index is
+// immutable once built, the editor keeps one for the engine and rebuilds only the module's on every build.
+struct ASCompletionIndex
+{
+	enum class Kind : u8
+	{
+		TYPE,
+		FUNCTION,
+		METHOD,
+		PROPERTY,
+		GLOBAL,
+		ENUM_VALUE,
+		FUNCDEF
+	};
+
+	struct Symbol
+	{
+		// offsets in m_strings
+		u32 name;
+		u32 declaration;
+		// type of methods and properties, 0 for global symbols
+		u32 parent;
+		Kind kind;
+	};
+
+	explicit ASCompletionIndex(IAllocator& allocator);
+
+	void buildFromEngine(asIScriptEngine& engine);
+	// Only what the module declares, the engine API is not repeated
+	void buildFromModule(asIScriptModule& module);
+	void clear();
+
+	// Symbols starting with `text` first, then symbols containing it; at most `max_results`. Only members of
+	// `parent` if it is not empty, only global symbols otherwise.
+	void query(StringView text, StringView parent, u32 max_results, Array<u32>& out) const;
+
+	const char* getString(u32 offset) const { return m_strings.begin() + offset; }
+	const Symbol& getSymbol(u32 idx) const { return m_symbols[idx]; }
+
+	Array<char> m_strings;
+	Array<Symbol> m_symbols;
+	// symbol indices sorted by lowercase name
+	Array<u32> m_sorted;
+	// (trigram << 32) | symbol, sorted
+	Array<u64> m_trigrams;
+
+private:
+	u32 addString(const char* str);
+	void addSymbol(Kind kind, const char* name, const char* declaration, const char* parent);
+	void addTypeMembers(asITypeInfo& type);
+	void finalize();
+};
+
+} // namespace Lumix
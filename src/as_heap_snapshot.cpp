@@ -0,0 +1,362 @@
+#include "as_heap_snapshot.h"
+#include "core/hash.h"
+#include "core/stream.h"
+#include <angelscript.h>
+#include <scriptarray/scriptarray.h>
+
+namespace Lumix
+{
+
+static constexpr u32 SNAPSHOT_MAGIC = 0x53485341; // "ASHS"
+static constexpr u32 SNAPSHOT_VERSION = 1;
+
+namespace
+{
+
+struct SnapshotBuilder
+{
+	SnapshotBuilder(ASHeapSnapshot& snapshot, asIScriptEngine& engine)
+		: snapshot(snapshot)
+		, engine(engine)
+		, node_map(snapshot.m_allocator)
+		, objects(snapshot.m_allocator)
+		, types(snapshot.m_allocator)
+	{
+	}
+
+	static bool isArray(asITypeInfo* type) { return equalStrings(type->GetName(), "array"); }
+
+	u32 getSize(void* obj, asITypeInfo* type) const
+	{
+		if (!isArray(type)) return type->GetSize();
+
+		CScriptArray* array = (CScriptArray*)obj;
+		const int element_type_id = array->GetElementTypeId();
+		u32 element_size = sizeof(void*);
+		if ((element_type_id & asTYPEID_MASK_OBJECT) == 0)
+		{
+			element_size = engine.GetSizeOfPrimitiveType(element_type_id);
+		}
+		else if ((element_type_id & asTYPEID_OBJHANDLE) == 0)
+		{
+			asITypeInfo* element_type = engine.GetTypeInfoById(element_type_id);
+			if (element_type && (element_type->GetFlags() & asOBJ_VALUE)) element_size = element_type->GetSize();
+		}
+		return u32(sizeof(CScriptArray) + array->GetSize() * element_size);
+	}
+
+	u32 getNode(void* obj, asITypeInfo* type)
+	{
+		auto iter = node_map.find(obj);
+		if (iter.isValid()) return iter.value();
+
+		const u32 idx = snapshot.m_nodes.size();
+		ASHeapSnapshot::Node& node = snapshot.m_nodes.emplace();
+		node.type = snapshot.addString(engine.GetTypeDeclaration(type->GetTypeId(), true));
+		node.size = getSize(obj, type);
+		node.first_edge = 0;
+		node.edge_count = 0;
+		node_map.insert(obj, idx);
+		objects.push(obj);
+		types.push(type);
+		return idx;
+	}
+
+	// Object referenced by a variable at `address`, value types are not tracked
+	void* resolve(void* address, int type_id, asITypeInfo** type) const
+	{
+		if (!address || (type_id & asTYPEID_MASK_OBJECT) == 0) return nullptr;
+
+		*type = engine.GetTypeInfoById(type_id);
+		if (!*type) return nullptr;
+		if (type_id & asTYPEID_OBJHANDLE) return *(void**)address;
+		return ((*type)->GetFlags() & asOBJ_REF) ? address : nullptr;
+	}
+
+	void addEdge(void* address, int type_id, u32 name)
+	{
+		asITypeInfo* type;
+		void* obj = resolve(address, type_id, &type);
+		if (!obj) return;
+
+		const u32 to = getNode(obj, type);
+		snapshot.m_edges.push({to, name});
+	}
+
+	// Nodes are expanded in the order they were found, so edges of a node are contiguous
+	void expandPending()
+	{
+		for (; expanded < snapshot.m_nodes.size(); ++expanded)
+		{
+			void* obj = objects[expanded];
+			asITypeInfo* type = types[expanded];
+			const u32 first_edge = snapshot.m_edges.size();
+
+			if (type->GetFlags() & asOBJ_SCRIPT_OBJECT)
+			{
+				asIScriptObject* script_obj = (asIScriptObject*)obj;
+				for (asUINT i = 0, c = script_obj->GetPropertyCount(); i < c; ++i)
+				{
+					const u32 name = snapshot.addString(script_obj->GetPropertyName(i));
+					addEdge(script_obj->GetAddressOfProperty(i), script_obj->GetPropertyTypeId(i), name);
+				}
+			}
+			else if (isArray(type))
+			{
+				CScriptArray* array = (CScriptArray*)obj;
+				const int element_type_id = array->GetElementTypeId();
+				if (element_type_id & asTYPEID_MASK_OBJECT)
+				{
+					for (asUINT i = 0, c = array->GetSize(); i < c; ++i)
+					{
+						addEdge(array->At(i), element_type_id, ASHeapSnapshot::INDEX_EDGE | i);
+					}
+				}
+			}
+
+			// `node` can not be kept, addEdge adds nodes
+			snapshot.m_nodes[expanded].first_edge = first_edge;
+			snapshot.m_nodes[expanded].edge_count = snapshot.m_edges.size() - first_edge;
+		}
+	}
+
+	ASHeapSnapshot& snapshot;
+	asIScriptEngine& engine;
+	HashMap<void*, u32> node_map;
+	Array<void*> objects;
+	Array<asITypeInfo*> types;
+	u32 expanded = 0;
+};
+
+} // anonymous namespace
+
+ASHeapSnapshot::ASHeapSnapshot(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_strings(allocator)
+	, m_nodes(allocator)
+	, m_edges(allocator)
+	, m_roots(allocator)
+	, m_retainers(allocator)
+	, m_retainer_edges(allocator)
+	, m_string_map(allocator)
+{
+}
+
+void ASHeapSnapshot::clear()
+{
+	m_strings.clear();
+	m_string_map.clear();
+	m_nodes.clear();
+	m_edges.clear();
+	m_roots.clear();
+	m_retainers.clear();
+	m_retainer_edges.clear();
+}
+
+u32 ASHeapSnapshot::addString(const char* str)
+{
+	const StableHash hash(str);
+	auto iter = m_string_map.find(hash);
+	if (iter.isValid()) return iter.value();
+
+	const u32 idx = m_strings.size();
+	m_strings.emplace(str, m_allocator);
+	m_string_map.insert(hash, idx);
+	return idx;
+}
+
+void ASHeapSnapshot::capture(asIScriptEngine& engine)
+{
+	clear();
+	SnapshotBuilder builder(*this, engine);
+
+	for (asUINT module_idx = 0, module_count = engine.GetModuleCount(); module_idx < module_count; ++module_idx)
+	{
+		asIScriptModule* module = engine.GetModuleByIndex(module_idx);
+		for (asUINT i = 0, c = module->GetGlobalVarCount(); i < c; ++i)
+		{
+			const char* name;
+			const char* ns;
+			int type_id;
+			module->GetGlobalVar(i, &name, &ns, &type_id);
+			asITypeInfo* type;
+			void* obj = builder.resolve(module->GetAddressOfGlobalVar(i), type_id, &type);
+			if (!obj) continue;
+
+			const StaticString<MAX_PATH> root_name("global ", module->GetName(), " ", ns, ns[0] ? "::" : "", name);
+			const u32 node = builder.getNode(obj, type);
+			m_roots.push({node, addString(root_name)});
+		}
+	}
+	builder.expandPending();
+
+	// the rest is held by the application or by cycles
+	const u32 reachable_count = m_nodes.size();
+	void* obj;
+	asITypeInfo* type;
+	for (asUINT i = 0; engine.GetObjectInGC(i, nullptr, &obj, &type) >= 0; ++i)
+	{
+		if (obj && type) builder.getNode(obj, type);
+	}
+	builder.expandPending();
+
+	Array<bool> referenced(m_allocator);
+	referenced.resize(m_nodes.size());
+	for (bool& r : referenced) r = false;
+	for (const Edge& edge : m_edges) referenced[edge.to] = true;
+	const u32 native_name = addString("<application>");
+	for (u32 i = reachable_count, c = m_nodes.size(); i < c; ++i)
+	{
+		if (!referenced[i]) m_roots.push({i, native_name});
+	}
+
+	computeRetainers();
+}
+
+void ASHeapSnapshot::computeRetainers()
+{
+	m_retainers.resize(m_nodes.size());
+	m_retainer_edges.resize(m_nodes.size());
+	for (u32& r : m_retainers) r = UNREACHABLE;
+
+	Array<u32> queue(m_allocator);
+	queue.reserve(m_nodes.size());
+	for (u32 i = 0, c = m_roots.size(); i < c; ++i)
+	{
+		const u32 node = m_roots[i].node;
+		if (m_retainers[node] != UNREACHABLE) continue;
+		m_retainers[node] = ROOT;
+		m_retainer_edges[node] = i;
+		queue.push(node);
+	}
+
+	for (u32 head = 0; head < (u32)queue.size(); ++head)
+	{
+		const Node& node = m_nodes[queue[head]];
+		for (u32 i = node.first_edge, end = node.first_edge + node.edge_count; i < end; ++i)
+		{
+			const u32 to = m_edges[i].to;
+			if (m_retainers[to] != UNREACHABLE) continue;
+			m_retainers[to] = queue[head];
+			m_retainer_edges[to] = i;
+			queue.push(to);
+		}
+	}
+}
+
+void ASHeapSnapshot::getRetainingPath(u32 node, String& out) const
+{
+	out = "";
+	if (m_retainers[node] == UNREACHABLE) return;
+
+	Array<u32> edges(m_allocator);
+	while (m_retainers[node] != ROOT)
+	{
+		edges.push(m_retainer_edges[node]);
+		node = m_retainers[node];
+	}
+
+	out = getString(m_roots[m_retainer_edges[node]].name);
+	for (i32 i = edges.size() - 1; i >= 0; --i)
+	{
+		const u32 name = m_edges[edges[i]].name;
+		if (name & INDEX_EDGE)
+		{
+			const StaticString<32> index(" -> [", name & ~INDEX_EDGE, "]");
+			out.append(index.data);
+		}
+		else
+		{
+			out.append(" -> ");
+			out.append(getString(name));
+		}
+	}
+}
+
+void ASHeapSnapshot::serialize(OutputMemoryStream& stream) const
+{
+	stream.write(SNAPSHOT_MAGIC);
+	stream.write(SNAPSHOT_VERSION);
+	stream.write(m_strings.size());
+	for (const String& str : m_strings)
+	{
+		stream.writeString(str);
+	}
+	stream.write(m_nodes.size());
+	stream.write(m_nodes.begin(), m_nodes.byte_size());
+	stream.write(m_edges.size());
+	stream.write(m_edges.begin(), m_edges.byte_size());
+	stream.write(m_roots.size());
+	stream.write(m_roots.begin(), m_roots.byte_size());
+}
+
+bool ASHeapSnapshot::deserialize(InputMemoryStream& stream)
+{
+	clear();
+	u32 magic, version;
+	if (!stream.read(&magic, sizeof(magic)) || magic != SNAPSHOT_MAGIC) return false;
+	if (!stream.read(&version, sizeof(version)) || version != SNAPSHOT_VERSION) return false;
+
+	u32 count;
+	if (!stream.read(&count, sizeof(count)) || count > stream.remaining()) return false;
+	for (u32 i = 0; i < count; ++i)
+	{
+		addString(stream.readString());
+	}
+	// duplicates in a corrupted file would shift indices
+	if (m_strings.size() != count) return false;
+
+	auto readArray = [&](auto& array) {
+		u32 size;
+		if (!stream.read(&size, sizeof(size)) || size > stream.remaining() / sizeof(array[0])) return false;
+		array.resize(size);
+		return stream.read(array.begin(), array.byte_size());
+	};
+	if (!readArray(m_nodes) || !readArray(m_edges) || !readArray(m_roots)) return false;
+
+	for (const Node& node : m_nodes)
+	{
+		if (node.type >= count || node.first_edge + (u64)node.edge_count > m_edges.size()) return false;
+	}
+	for (const Edge& edge : m_edges)
+	{
+		if (edge.to >= (u32)m_nodes.size()) return false;
+		if ((edge.name & INDEX_EDGE) == 0 && edge.name >= count) return false;
+	}
+	for (const Root& root : m_roots)
+	{
+		if (root.node >= (u32)m_nodes.size() || root.name >= count) return false;
+	}
+
+	computeRetainers();
+	return true;
+}
+
+void ASHeapSnapshot::diff(const ASHeapSnapshot& before, const ASHeapSnapshot& after, Array<TypeDiff>& out)
+{
+	out.clear();
+	HashMap<StableHash, u32> indices(after.m_allocator);
+	const ASHeapSnapshot* snapshots[] = {&before, &after};
+	for (u32 s = 0; s < 2; ++s)
+	{
+		for (const Node& node : snapshots[s]->m_nodes)
+		{
+			const char* type = snapshots[s]->getString(node.type);
+			const StableHash hash(type);
+			auto iter = indices.find(hash);
+			if (!iter.isValid())
+			{
+				iter = indices.insert(hash, out.size());
+				TypeDiff& diff = out.emplace();
+				diff.type = type;
+				diff.count[0] = diff.count[1] = 0;
+				diff.bytes[0] = diff.bytes[1] = 0;
+			}
+			TypeDiff& diff = out[iter.value()];
+			++diff.count[s];
+			diff.bytes[s] += node.size;
+		}
+	}
+}
+
+} // namespace Lumix
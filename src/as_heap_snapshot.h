@@ -0,0 +1,85 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/hash_map.h"
+#include "core/string.h"
+
+class asIScriptEngine;
+
+namespace Lumix
+{
+
+struct InputMemoryStream;
+struct OutputMemoryStream;
+
+// Graph of live script objects, used to find leaks in long sessions. Roots are module globals and objects
+// the collector knows about which are neither reachable from globals nor referenced by another object, i.e. held
+// by the application. Objects kept alive only by a cycle have no root and are reported as unreachable. Edges are
+// handles and objects stored in script class members and arrays; references hidden in application types are not
+// visible.
+struct ASHeapSnapshot
+{
+	struct Node
+	{
+		u32 type; // string
+		u32 size;
+		u32 first_edge;
+		u32 edge_count;
+	};
+
+	struct Edge
+	{
+		u32 to;
+		// string, or array index with INDEX_EDGE set
+		u32 name;
+	};
+
+	struct Root
+	{
+		u32 node;
+		u32 name; // string
+	};
+
+	// Object counts of one type in two snapshots
+	struct TypeDiff
+	{
+		const char* type;
+		u32 count[2];
+		u64 bytes[2];
+	};
+
+	static constexpr u32 INDEX_EDGE = 0x80000000;
+	static constexpr u32 ROOT = 0xffFFfffe;
+	static constexpr u32 UNREACHABLE = 0xffFFffFF;
+
+	explicit ASHeapSnapshot(IAllocator& allocator);
+
+	void capture(asIScriptEngine& engine);
+	void serialize(OutputMemoryStream& stream) const;
+	bool deserialize(InputMemoryStream& stream);
+	void clear();
+
+	const char* getString(u32 idx) const { return m_strings[idx].c_str(); }
+	// Shortest path from any root, e.g. "global game.as Game::g_items -> [12] -> owner", empty if unreachable
+	void getRetainingPath(u32 node, String& out) const;
+	// Types present in `before` or `after`, `type` points to strings of the snapshots
+	static void diff(const ASHeapSnapshot& before, const ASHeapSnapshot& after, Array<TypeDiff>& out);
+
+	IAllocator& m_allocator;
+	Array<String> m_strings;
+	Array<Node> m_nodes;
+	Array<Edge> m_edges;
+	Array<Root> m_roots;
+	// Breadth-first parent of every node, ROOT or UNREACHABLE; filled by capture and deserialize
+	Array<u32> m_retainers;
+	// index to m_edges, or to m_roots for roots
+	Array<u32> m_retainer_edges;
+
+private:
+	u32 addString(const char* str);
+	void computeRetainers();
+
+	HashMap<StableHash, u32> m_string_map;
+};
+
+} // namespace Lumix
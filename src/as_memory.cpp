@@ -0,0 +1,132 @@
+#include "as_memory.h"
+#include "core/allocator.h"
+#include "core/crt.h"
+#include "core/log.h"
+#include <angelscript.h>
+#include <scriptarray/scriptarray.h>
+
+namespace Lumix
+{
+
+// Precedes every routed block, deallocation needs no scope
+struct alignas(16) ASMemoryHeader
+{
+	ASMemoryTag* tag;
+	u32 size;
+	// from the start of the underlying block
+	u16 offset;
+	ASMemoryTag::Kind kind;
+};
+
+static ASMemoryTag* s_fallback_tag = nullptr;
+static thread_local ASMemoryTag* t_tag = nullptr;
+static thread_local ASMemoryTag::Kind t_kind = ASMemoryTag::RUNTIME;
+
+static void* allocateRouted(size_t size, size_t align)
+{
+	ASMemoryTag* tag = t_tag ? t_tag : s_fallback_tag;
+	const size_t offset = align > sizeof(ASMemoryHeader) ? align : sizeof(ASMemoryHeader);
+	u8* block = (u8*)tag->allocator.allocate(size + offset, offset);
+	if (!block) return nullptr;
+
+	u8* mem = block + offset;
+	ASMemoryHeader* header = (ASMemoryHeader*)mem - 1;
+	header->tag = tag;
+	header->size = (u32)size;
+	header->offset = (u16)offset;
+	header->kind = t_kind;
+	const i64 prev_bytes = tag->bytes[t_kind].add((i64)size);
+	tag->allocations.add(1);
+	if (t_kind == ASMemoryTag::RUNTIME)
+	{
+		const i64 bytes = prev_bytes + (i64)size;
+		for (i64 peak = tag->peak_runtime_bytes; bytes > peak; peak = tag->peak_runtime_bytes)
+		{
+			if (tag->peak_runtime_bytes.compareExchange(bytes, peak)) break;
+		}
+	}
+	return mem;
+}
+
+static void deallocateRouted(void* ptr)
+{
+	if (!ptr) return;
+
+	ASMemoryHeader* header = (ASMemoryHeader*)ptr - 1;
+	ASMemoryTag* tag = header->tag;
+	tag->bytes[header->kind].add(-(i64)header->size);
+	tag->allocations.add(-1);
+	tag->allocator.deallocate((u8*)ptr - header->offset);
+}
+
+static void* asAllocate(size_t size) { return allocateRouted(size, 16); }
+
+// Script objects and arrays, null makes AngelScript raise an exception in the running script. Only these are
+// limited, other allocations of the VM do not expect failure.
+static void* allocateLimited(size_t size)
+{
+	ASMemoryTag* tag = t_tag ? t_tag : s_fallback_tag;
+	const i64 limit = tag->limit;
+	if (limit > 0 && t_kind == ASMemoryTag::RUNTIME && asGetActiveContext()
+		&& tag->bytes[ASMemoryTag::RUNTIME] + (i64)size > limit)
+	{
+		if (tag->limit_failures.add(1) == 0)
+		{
+			logError("Script memory limit of ", limit / 1024, " KB reached by ", tag->path.c_str());
+		}
+		return nullptr;
+	}
+	return allocateRouted(size, 16);
+}
+
+struct ASScopedAllocator final : IAllocator
+{
+	void* allocate(size_t size, size_t align) override { return allocateRouted(size, align); }
+	void deallocate(void* ptr) override { deallocateRouted(ptr); }
+
+	void* reallocate(void* ptr, size_t new_size, size_t old_size, size_t align) override
+	{
+		if (!ptr) return allocate(new_size, align);
+		void* mem = allocate(new_size, align);
+		if (!mem) return nullptr;
+		memcpy(mem, ptr, old_size < new_size ? old_size : new_size);
+		deallocate(ptr);
+		return mem;
+	}
+};
+
+static ASScopedAllocator s_scoped_allocator;
+
+ASMemoryScope::ASMemoryScope(ASMemoryTag* tag, ASMemoryTag::Kind kind)
+	: m_prev_tag(t_tag)
+	, m_prev_kind(t_kind)
+{
+	if (tag) t_tag = tag;
+	t_kind = kind;
+}
+
+ASMemoryScope::~ASMemoryScope()
+{
+	t_tag = m_prev_tag;
+	t_kind = m_prev_kind;
+}
+
+void installASMemoryHooks(ASMemoryTag& fallback)
+{
+	s_fallback_tag = &fallback;
+	asSetGlobalMemoryFunctions(asAllocate, deallocateRouted);
+	asSetScriptObjectAllocFunction(allocateLimited);
+	CScriptArray::SetMemoryFunctions(allocateLimited, deallocateRouted);
+}
+
+void uninstallASMemoryHooks()
+{
+	CScriptArray::SetMemoryFunctions(asAllocMem, asFreeMem);
+	asSetScriptObjectAllocFunction(nullptr);
+	asResetGlobalMemoryFunctions();
+	s_fallback_tag = nullptr;
+}
+
+IAllocator& getASScopedAllocator() { return s_scoped_allocator; }
+
+} // namespace Lumix
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/atomic.h"
+#include "core/path.h"
+#include "core/tag_allocator.h"
+
+namespace Lumix
+{
+
+// Memory of one script file. All AngelScript allocations are routed with asSetGlobalMemoryFunctions to the tag
+// of the script being compiled or executed on the calling thread, so bytecode, globals, string constants and
+// script objects are attributed to the file that created them. Tags outlive reloads of their script.
+struct ASMemoryTag
+{
+	enum Kind : u8
+	{
+		// made by Build(): bytecode, globals, string constants
+		COMPILED,
+		// made while executing: script objects, arrays, strings
+		RUNTIME,
+
+		KIND_COUNT
+	};
+
+	// TagAllocator keeps the name pointer, it must point to the member
+	ASMemoryTag(IAllocator& parent, const Path& path)
+		: path(path)
+		, allocator(parent, this->path.c_str())
+	{
+	}
+
+	Path path;
+	TagAllocator allocator;
+	AtomicI64 bytes[KIND_COUNT] = {0, 0};
+	AtomicI64 allocations = 0;
+	AtomicI64 peak_runtime_bytes = 0;
+	// RUNTIME bytes above which script objects and arrays can not be allocated, 0 is unlimited
+	AtomicI64 limit = 0;
+	// refused allocations of script objects and arrays
+	AtomicI64 limit_failures = 0;
+};
+
+// Makes `tag` the destination of allocations on this thread until the scope ends, null keeps the current one
+struct ASMemoryScope
+{
+	ASMemoryScope(ASMemoryTag* tag, ASMemoryTag::Kind kind);
+	~ASMemoryScope();
+
+	ASMemoryTag* m_prev_tag;
+	ASMemoryTag::Kind m_prev_kind;
+};
+
+// Allocations outside of any scope go to `fallback`. Install before asPrepareMultithread and the engine is
+// created, uninstall after everything allocated by AngelScript is freed. Script objects and arrays made by
+// running scripts respect the limit of their tag, the script gets an out of memory exception instead.
+void installASMemoryHooks(ASMemoryTag& fallback);
+void uninstallASMemoryHooks();
+// Allocator following the current scope, for memory the application makes on behalf of scripts
+IAllocator& getASScopedAllocator();
+
+} // namespace Lumix
@@ -0,0 +1,429 @@
+#include "as_network.h"
+#include "core/allocator.h"
+#include "core/profiler.h"
+#include "core/stream.h"
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#ifdef _MSC_VER
+		#pragma comment(lib, "ws2_32.lib")
+	#endif
+#else
+	#include <arpa/inet.h>
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <netdb.h>
+	#include <netinet/in.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+#endif
+
+namespace Lumix
+{
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+using PollFD = WSAPOLLFD;
+static const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+static void closeSocket(SocketHandle s) { closesocket(s); }
+static bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static bool isConnectInProgress() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static int pollSockets(PollFD* fds, u32 count) { return WSAPoll(fds, count, 0); }
+static const int SEND_FLAGS = 0;
+
+static bool configureSocket(SocketHandle s)
+{
+	u_long mode = 1;
+	return ioctlsocket(s, FIONBIO, &mode) == 0;
+}
+#else
+using SocketHandle = int;
+using PollFD = pollfd;
+static const SocketHandle INVALID_SOCKET_HANDLE = -1;
+static void closeSocket(SocketHandle s) { ::close(s); }
+static bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+static bool isConnectInProgress() { return errno == EINPROGRESS; }
+static int pollSockets(PollFD* fds, u32 count) { return ::poll(fds, count, 0); }
+// a write to a socket closed by the peer must fail with EPIPE instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static bool configureSocket(SocketHandle s)
+{
+#ifdef SO_NOSIGPIPE
+	const int no_sigpipe = 1;
+	if (setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe)) != 0) return false;
+#endif
+	const int flags = fcntl(s, F_GETFL, 0);
+	return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+static bool makeAddress(const char* ip, u16 port, sockaddr_in& addr)
+{
+	addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if (inet_pton(AF_INET, ip, &addr.sin_addr) == 1) return true;
+
+	// host names such as "localhost", the lookup blocks so numeric addresses are preferable
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(ip, nullptr, &hints, &result) != 0 || !result) return false;
+	addr.sin_addr = ((const sockaddr_in*)result->ai_addr)->sin_addr;
+	freeaddrinfo(result);
+	return true;
+}
+
+struct ASNetworkImpl final : ASNetwork
+{
+	enum class SocketType : u8
+	{
+		TCP,
+		TCP_LISTENER,
+		UDP
+	};
+
+	struct Socket
+	{
+		explicit Socket(IAllocator& allocator)
+			: outgoing(allocator)
+		{
+		}
+
+		u32 id;
+		SocketHandle handle;
+		SocketType type;
+		bool is_connecting = false;
+		bool is_closed = false;
+		OutputMemoryStream outgoing;
+		u32 outgoing_offset = 0;
+	};
+
+	static constexpr u32 READ_CHUNK = 64 * 1024;
+
+	explicit ASNetworkImpl(IAllocator& allocator)
+		: m_allocator(allocator)
+		, m_sockets(allocator)
+		, m_poll_fds(allocator)
+		, m_buffer(allocator)
+	{
+#ifdef _WIN32
+		WSADATA wsa_data;
+		WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+	}
+
+	~ASNetworkImpl()
+	{
+		for (Socket& socket : m_sockets)
+		{
+			closeSocket(socket.handle);
+		}
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+
+	// Scripts keep only a handful of sockets, linear search is fine
+	Socket* getSocket(u32 id)
+	{
+		for (Socket& socket : m_sockets)
+		{
+			if (socket.id == id && !socket.is_closed) return &socket;
+		}
+		return nullptr;
+	}
+
+	u32 addSocket(SocketHandle handle, SocketType type)
+	{
+		if (!configureSocket(handle))
+		{
+			closeSocket(handle);
+			return 0;
+		}
+		++m_last_id;
+		if (m_last_id == 0) ++m_last_id;
+		Socket& socket = m_sockets.emplace(m_allocator);
+		socket.id = m_last_id;
+		socket.handle = handle;
+		socket.type = type;
+		return socket.id;
+	}
+
+	u32 connect(const char* ip, u16 port) override
+	{
+		sockaddr_in addr;
+		if (!makeAddress(ip, port, addr)) return 0;
+		const SocketHandle handle = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (handle == INVALID_SOCKET_HANDLE) return 0;
+
+		const u32 id = addSocket(handle, SocketType::TCP);
+		if (!id) return 0;
+		if (::connect(handle, (const sockaddr*)&addr, sizeof(addr)) != 0)
+		{
+			if (!isConnectInProgress())
+			{
+				close(id);
+				return 0;
+			}
+		}
+		// reported as CONNECTED from poll even if it finished right away
+		getSocket(id)->is_connecting = true;
+		return id;
+	}
+
+	u32 bindSocket(const char* ip, u16 port, SocketType type)
+	{
+		sockaddr_in addr;
+		if (!makeAddress(ip, port, addr)) return 0;
+		const bool is_udp = type == SocketType::UDP;
+		const SocketHandle handle =
+			::socket(AF_INET, is_udp ? SOCK_DGRAM : SOCK_STREAM, is_udp ? IPPROTO_UDP : IPPROTO_TCP);
+		if (handle == INVALID_SOCKET_HANDLE) return 0;
+
+		const int reuse = 1;
+		setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+		if (::bind(handle, (const sockaddr*)&addr, sizeof(addr)) != 0 || (!is_udp && ::listen(handle, 16) != 0))
+		{
+			closeSocket(handle);
+			return 0;
+		}
+		return addSocket(handle, type);
+	}
+
+	u32 listen(const char* ip, u16 port) override { return bindSocket(ip, port, SocketType::TCP_LISTENER); }
+	u32 openUDP(const char* ip, u16 port) override { return bindSocket(ip, port, SocketType::UDP); }
+
+	bool send(u32 id, Span<const u8> data) override
+	{
+		Socket* socket = getSocket(id);
+		if (!socket || socket->type != SocketType::TCP) return false;
+		socket->outgoing.write(data.begin(), data.length());
+		if (!socket->is_connecting) flush(*socket);
+		return !socket->is_closed;
+	}
+
+	bool sendTo(u32 id, const char* ip, u16 port, Span<const u8> data) override
+	{
+		Socket* socket = getSocket(id);
+		if (!socket || socket->type != SocketType::UDP) return false;
+		sockaddr_in addr;
+		if (!makeAddress(ip, port, addr)) return false;
+		const int sent = ::sendto(socket->handle,
+			(const char*)data.begin(),
+			(int)data.length(),
+			SEND_FLAGS,
+			(const sockaddr*)&addr,
+			sizeof(addr));
+		return sent == (int)data.length();
+	}
+
+	void close(u32 id) override
+	{
+		for (i32 i = 0, c = m_sockets.size(); i < c; ++i)
+		{
+			if (m_sockets[i].id != id) continue;
+			closeSocket(m_sockets[i].handle);
+			m_sockets.swapAndPop(i);
+			return;
+		}
+	}
+
+	bool isEmpty() const override { return m_sockets.empty(); }
+
+	Span<const u8> getData(const Event& event) const override
+	{
+		return Span<const u8>(m_buffer.data() + event.offset, event.size);
+	}
+
+	// Sends as much of the queued data as the socket takes without blocking
+	void flush(Socket& socket)
+	{
+		while (socket.outgoing_offset < socket.outgoing.size())
+		{
+			const u32 remaining = u32(socket.outgoing.size() - socket.outgoing_offset);
+			const u8* begin = socket.outgoing.data() + socket.outgoing_offset;
+			const int sent = ::send(socket.handle, (const char*)begin, (int)remaining, SEND_FLAGS);
+			if (sent <= 0)
+			{
+				if (sent < 0 && !wouldBlock()) socket.is_closed = true;
+				break;
+			}
+			socket.outgoing_offset += sent;
+		}
+		if (socket.outgoing_offset == socket.outgoing.size())
+		{
+			socket.outgoing.clear();
+			socket.outgoing_offset = 0;
+		}
+	}
+
+	Event& pushEvent(Array<Event>& events, EventType type, u32 socket)
+	{
+		Event& event = events.emplace();
+		event = {};
+		event.type = type;
+		event.socket = socket;
+		return event;
+	}
+
+	void accept(Socket& listener, Array<Event>& events)
+	{
+		// `listener` is not used in the loop, m_sockets can grow
+		const u32 listener_id = listener.id;
+		const SocketHandle listener_handle = listener.handle;
+		for (;;)
+		{
+			const SocketHandle handle = ::accept(listener_handle, nullptr, nullptr);
+			if (handle == INVALID_SOCKET_HANDLE) break;
+			const u32 id = addSocket(handle, SocketType::TCP);
+			if (id) pushEvent(events, EventType::ACCEPTED, listener_id).peer = id;
+		}
+	}
+
+	// Reads everything available into m_buffer, returns false if the connection is gone
+	bool receive(Socket& socket, Array<Event>& events)
+	{
+		const u64 offset = m_buffer.size();
+		for (;;)
+		{
+			const u64 size = m_buffer.size();
+			m_buffer.resize(size + READ_CHUNK);
+			const int received = ::recv(socket.handle, (char*)m_buffer.getMutableData() + size, READ_CHUNK, 0);
+			m_buffer.resize(size + maximum(received, 0));
+			if (received > 0) continue;
+			if (received < 0 && wouldBlock()) break;
+			socket.is_closed = true;
+			break;
+		}
+		if (m_buffer.size() > offset)
+		{
+			Event& event = pushEvent(events, EventType::DATA, socket.id);
+			event.offset = (u32)offset;
+			event.size = u32(m_buffer.size() - offset);
+		}
+		return !socket.is_closed;
+	}
+
+	// One event per datagram
+	void receiveFrom(Socket& socket, Array<Event>& events)
+	{
+		for (;;)
+		{
+			const u64 size = m_buffer.size();
+			m_buffer.resize(size + READ_CHUNK);
+			sockaddr_in from;
+			socklen_t from_len = sizeof(from);
+			const int received = ::recvfrom(
+				socket.handle, (char*)m_buffer.getMutableData() + size, READ_CHUNK, 0, (sockaddr*)&from, &from_len);
+			m_buffer.resize(size + maximum(received, 0));
+			if (received < 0) break;
+
+			Event& event = pushEvent(events, EventType::DATA, socket.id);
+			event.offset = (u32)size;
+			event.size = (u32)received;
+			event.from_ip = ntohl(from.sin_addr.s_addr);
+			event.from_port = ntohs(from.sin_port);
+		}
+	}
+
+	void poll(Array<Event>& events) override
+	{
+		PROFILE_FUNCTION();
+		events.clear();
+		m_buffer.clear();
+		if (m_sockets.empty()) return;
+
+		m_poll_fds.clear();
+		for (const Socket& socket : m_sockets)
+		{
+			// send() failed since the last poll
+			if (socket.is_closed) pushEvent(events, EventType::FAILURE, socket.id);
+
+			PollFD& fd = m_poll_fds.emplace();
+			fd.fd = socket.handle;
+			fd.revents = 0;
+			if (socket.is_connecting)
+				fd.events = POLLOUT;
+			else if (socket.type == SocketType::TCP && socket.outgoing.size() > 0)
+				fd.events = POLLIN | POLLOUT;
+			else
+				fd.events = POLLIN;
+		}
+		const bool any_ready = pollSockets(m_poll_fds.begin(), m_poll_fds.size()) > 0;
+
+		// sockets accepted in this loop are appended after the polled ones
+		for (i32 i = 0, c = any_ready ? m_poll_fds.size() : 0; i < c; ++i)
+		{
+			const short revents = m_poll_fds[i].revents;
+			Socket& socket = m_sockets[i];
+			if (revents == 0 || socket.is_closed) continue;
+
+			switch (socket.type)
+			{
+				case SocketType::TCP_LISTENER:
+					if (revents & POLLIN) accept(socket, events);
+					break;
+				case SocketType::UDP:
+					if (revents & POLLIN) receiveFrom(socket, events);
+					break;
+				case SocketType::TCP:
+					if (socket.is_connecting)
+					{
+						int error = 0;
+						socklen_t len = sizeof(error);
+						getsockopt(socket.handle, SOL_SOCKET, SO_ERROR, (char*)&error, &len);
+						socket.is_connecting = false;
+						if (error != 0 || (revents & (POLLERR | POLLHUP | POLLNVAL)))
+						{
+							socket.is_closed = true;
+							pushEvent(events, EventType::FAILURE, socket.id);
+							break;
+						}
+						pushEvent(events, EventType::CONNECTED, socket.id);
+						flush(socket);
+						break;
+					}
+					if ((revents & (POLLIN | POLLHUP)) && !receive(socket, events))
+					{
+						pushEvent(events, EventType::CLOSED, socket.id);
+						break;
+					}
+					if (revents & POLLOUT) flush(socket);
+					if (revents & (POLLERR | POLLNVAL) || socket.is_closed)
+					{
+						socket.is_closed = true;
+						pushEvent(events, EventType::FAILURE, socket.id);
+					}
+					break;
+			}
+		}
+
+		for (i32 i = m_sockets.size() - 1; i >= 0; --i)
+		{
+			if (!m_sockets[i].is_closed) continue;
+			closeSocket(m_sockets[i].handle);
+			m_sockets.swapAndPop(i);
+		}
+	}
+
+	IAllocator& m_allocator;
+	Array<Socket> m_sockets;
+	Array<PollFD> m_poll_fds;
+	OutputMemoryStream m_buffer;
+	u32 m_last_id = 0;
+};
+
+UniquePtr<ASNetwork> ASNetwork::create(IAllocator& allocator)
+{
+	return UniquePtr<ASNetworkImpl>::create(allocator, allocator);
+}
+
+} // namespace Lumix
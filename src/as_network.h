@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/span.h"
+#include "core/unique_ptr.h"
+
+namespace Lumix
+{
+
+// Non-blocking TCP/UDP sockets for scripts. Only host name lookups block, all sockets are checked for readiness with
+// a single poll() per frame and everything received is appended to one reusable buffer.
+struct ASNetwork
+{
+	enum class EventType : u8
+	{
+		CONNECTED, // outgoing TCP connection established
+		ACCEPTED,  // listener accepted `peer`
+		DATA,      // getData(event) was received
+		CLOSED,    // closed by the remote side, the socket is destroyed
+		FAILURE    // connect or I/O failed, the socket is destroyed
+	};
+
+	struct Event
+	{
+		EventType type;
+		u32 socket;
+		u32 peer;
+		// DATA
+		u32 offset;
+		u32 size;
+		u32 from_ip; // IPv4, host byte order
+		u16 from_port;
+	};
+
+	static UniquePtr<ASNetwork> create(IAllocator& allocator);
+
+	virtual ~ASNetwork() {}
+	// All functions return socket 0 on failure. `ip` is a numeric IPv4 address or a host name.
+	virtual u32 connect(const char* ip, u16 port) = 0;
+	virtual u32 listen(const char* ip, u16 port) = 0;
+	virtual u32 openUDP(const char* ip, u16 port) = 0;
+	// TCP data is queued and flushed as the socket becomes writable
+	virtual bool send(u32 socket, Span<const u8> data) = 0;
+	// UDP datagrams are dropped if they can not be sent right away
+	virtual bool sendTo(u32 socket, const char* ip, u16 port, Span<const u8> data) = 0;
+	virtual void close(u32 socket) = 0;
+	virtual bool isEmpty() const = 0;
+	// Checks all sockets, `events` and the data buffer are valid until the next call
+	virtual void poll(Array<Event>& events) = 0;
+	virtual Span<const u8> getData(const Event& event) const = 0;
+};
+
+} // namespace Lumix
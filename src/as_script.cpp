@@ -1,17 +1,196 @@
 #include "as_script.h"
+#include "core/crt.h"
 #include "core/log.h"
 #include "core/stream.h"
 #include "engine/file_system.h"
 #include "engine/resource_manager.h"
+#include <angelscript.h>
 
 namespace Lumix
 {
 
+static const struct
+{
+	const char* name;
+	ASScriptHeader::Callbacks flag;
+} CALLBACKS[] = {
+	{"update", ASScriptHeader::UPDATE},
+	{"awake", ASScriptHeader::AWAKE},
+	{"onGUI", ASScriptHeader::ON_GUI},
+	{"onDrawGizmo", ASScriptHeader::ON_DRAW_GIZMO},
+	{"onInputEvent", ASScriptHeader::ON_INPUT_EVENT},
+};
+
+static bool isIdentifierChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// Text between `name =` and the end of the declarator in the global scope, comments and strings are skipped
+static StringView findInitializer(StringView source, const char* name)
+{
+	const u32 name_len = stringLength(name);
+	u32 depth = 0;
+	for (const char* c = source.begin; c < source.end; ++c)
+	{
+		if (c[0] == '/' && c + 1 < source.end && c[1] == '/')
+		{
+			while (c < source.end && *c != '\n') ++c;
+			continue;
+		}
+		if (c[0] == '/' && c + 1 < source.end && c[1] == '*')
+		{
+			c += 2;
+			while (c + 1 < source.end && !(c[0] == '*' && c[1] == '/')) ++c;
+			++c;
+			continue;
+		}
+		if (*c == '"' || *c == '\'')
+		{
+			const char quote = *c;
+			for (++c; c < source.end && *c != quote; ++c)
+			{
+				if (*c == '\\') ++c;
+			}
+			continue;
+		}
+		if (*c == '{') ++depth;
+		if (*c == '}' && depth > 0) --depth;
+		if (depth > 0 || !isIdentifierChar(*c)) continue;
+
+		const char* token = c;
+		while (c < source.end && isIdentifierChar(*c)) ++c;
+		const bool matches = u32(c - token) == name_len && memcmp(token, name, name_len) == 0;
+		--c;
+		if (!matches) continue;
+
+		const char* value = c + 1;
+		while (value < source.end && isSpace(*value)) ++value;
+		if (value + 1 >= source.end || value[0] != '=' || value[1] == '=') continue;
+
+		++value;
+		const char* end = value;
+		u32 parens = 0;
+		for (; end < source.end; ++end)
+		{
+			if (*end == '(' || *end == '[') ++parens;
+			else if ((*end == ')' || *end == ']') && parens > 0) --parens;
+			else if (parens == 0 && (*end == ';' || *end == ',')) break;
+		}
+		while (value < end && isSpace(*value)) ++value;
+		while (end > value && isSpace(end[-1])) --end;
+		return StringView(value, end);
+	}
+	return StringView();
+}
+
+ASScriptHeader::ASScriptHeader(IAllocator& allocator)
+	: allocator(allocator)
+	, callback_list(allocator)
+	, properties(allocator)
+{
+}
+
+void ASScriptHeader::clear()
+{
+	valid = false;
+	callbacks = 0;
+	callback_list.clear();
+	properties.clear();
+}
+
+void ASScriptHeader::build(asIScriptModule& module, StringView source)
+{
+	clear();
+	for (const auto& cb : CALLBACKS)
+	{
+		asIScriptFunction* func = module.GetFunctionByName(cb.name);
+		if (!func) continue;
+
+		callbacks |= cb.flag;
+		Callback& callback = callback_list.emplace(allocator);
+		callback.flag = cb.flag;
+		callback.declaration = func->GetDeclaration(true, false, true);
+	}
+
+	asIScriptEngine* engine = module.GetEngine();
+	for (asUINT i = 0, c = module.GetGlobalVarCount(); i < c; ++i)
+	{
+		const char* name;
+		const char* ns;
+		int type_id;
+		bool is_const;
+		module.GetGlobalVar(i, &name, &ns, &type_id, &is_const);
+		if (is_const || ns[0]) continue;
+
+		const char* type = engine->GetTypeDeclaration(type_id);
+		const bool is_primitive = type_id > asTYPEID_VOID && type_id <= asTYPEID_DOUBLE;
+		if (!is_primitive && !equalStrings(type, "String") && !equalStrings(type, "Entity")) continue;
+
+		Property& prop = properties.emplace(allocator);
+		prop.name = name;
+		prop.type = type;
+		prop.default_value = findInitializer(source, name);
+	}
+	valid = true;
+}
+
+void ASScriptHeader::serialize(OutputMemoryStream& stream) const
+{
+	stream.write(MAGIC);
+	stream.write(VERSION);
+	stream.write(valid);
+	stream.write(callbacks);
+	stream.write(callback_list.size());
+	for (const Callback& callback : callback_list)
+	{
+		stream.write(callback.flag);
+		stream.writeString(callback.declaration);
+	}
+	stream.write(properties.size());
+	for (const Property& prop : properties)
+	{
+		stream.writeString(prop.name);
+		stream.writeString(prop.type);
+		stream.writeString(prop.default_value);
+	}
+}
+
+bool ASScriptHeader::deserialize(InputMemoryStream& stream)
+{
+	clear();
+	u32 magic, version;
+	if (!stream.read(&magic, sizeof(magic)) || magic != MAGIC) return false;
+	if (!stream.read(&version, sizeof(version)) || version != VERSION) return false;
+	if (!stream.read(&valid, sizeof(valid)) || !stream.read(&callbacks, sizeof(callbacks))) return false;
+
+	u32 count;
+	if (!stream.read(&count, sizeof(count)) || count > stream.remaining()) return false;
+	for (u32 i = 0; i < count; ++i)
+	{
+		Callback& callback = callback_list.emplace(allocator);
+		if (!stream.read(&callback.flag, sizeof(callback.flag))) return false;
+		callback.declaration = stream.readString();
+	}
+	if (!stream.read(&count, sizeof(count)) || count > stream.remaining()) return false;
+	for (u32 i = 0; i < count; ++i)
+	{
+		Property& prop = properties.emplace(allocator);
+		prop.name = stream.readString();
+		prop.type = stream.readString();
+		prop.default_value = stream.readString();
+	}
+	return true;
+}
+
 ASScript::ASScript(const Path& path, ResourceManager& resource_manager, IAllocator& allocator)
 	: Resource(path, resource_manager, allocator)
 	, m_allocator(allocator, m_path.c_str())
 	, m_source_code(m_allocator)
 	, m_dependencies(m_allocator)
+	, m_header(m_allocator)
 {
 }
 
@@ -22,11 +201,34 @@ void ASScript::unload()
 	for (ASScript* scr : m_dependencies) scr->decRefCount();
 	m_dependencies.clear();
 	m_source_code = "";
+	m_header.clear();
+}
+
+bool ASScript::loadFromBundle(Span<const u8> header)
+{
+	InputMemoryStream blob(header.begin(), header.length());
+	if (!m_header.deserialize(blob))
+	{
+		logError(m_path, ": invalid header in the script bundle");
+		m_header.clear();
+		return false;
+	}
+	onCreated(State::READY);
+	return true;
 }
 
 bool ASScript::load(Span<const u8> mem)
 {
 	InputMemoryStream blob(mem.begin(), mem.length());
+	// assets compiled before the header was added start with the dependency count
+	u32 magic = 0;
+	if (mem.length() >= sizeof(magic)) memcpy(&magic, mem.begin(), sizeof(magic));
+	if (magic == ASScriptHeader::MAGIC && !m_header.deserialize(blob))
+	{
+		logError(m_path, ": invalid header, recompile the script");
+		return false;
+	}
+
 	u32 num_deps;
 	blob.read(num_deps);
 	for (u32 i = 0; i < num_deps; ++i)
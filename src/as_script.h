@@ -1,12 +1,75 @@
 #pragma once
 
+#include "core/array.h"
 #include "core/string.h"
 #include "core/tag_allocator.h"
 #include "engine/resource.h"
 
+class asIScriptModule;
+
 namespace Lumix
 {
 
+// Written by the asset compiler after a successful build, tells the runtime which callbacks and properties a script
+// has without building it. `valid` is false if the build failed or the asset is from an older version of the
+// plugin, the module is then the only source of truth.
+struct ASScriptHeader
+{
+	enum Callbacks : u32
+	{
+		UPDATE = 1 << 0,
+		AWAKE = 1 << 1,
+		ON_GUI = 1 << 2,
+		ON_DRAW_GIZMO = 1 << 3,
+		ON_INPUT_EVENT = 1 << 4
+	};
+
+	struct Callback
+	{
+		explicit Callback(IAllocator& allocator)
+			: declaration(allocator)
+		{
+		}
+
+		Callbacks flag;
+		String declaration;
+	};
+
+	// Non-const global of a type the property grid can edit
+	struct Property
+	{
+		explicit Property(IAllocator& allocator)
+			: name(allocator)
+			, type(allocator)
+			, default_value(allocator)
+		{
+		}
+
+		String name;
+		// AngelScript declaration, e.g. "float"
+		String type;
+		// initializer as written in the source, empty if there is none
+		String default_value;
+	};
+
+	static constexpr u32 MAGIC = 0x48535341; // "ASSH"
+	static constexpr u32 VERSION = 1;
+
+	explicit ASScriptHeader(IAllocator& allocator);
+
+	void clear();
+	void build(asIScriptModule& module, StringView source);
+	void serialize(OutputMemoryStream& stream) const;
+	bool deserialize(InputMemoryStream& stream);
+	bool has(Callbacks callback) const { return !valid || (callbacks & callback) != 0; }
+
+	IAllocator& allocator;
+	bool valid = false;
+	u32 callbacks = 0;
+	Array<Callback> callback_list;
+	Array<Property> properties;
+};
+
 struct ASScript final : Resource
 {
 public:
@@ -17,7 +80,11 @@ public:
 
 	void unload() override;
 	bool load(Span<const u8> mem) override;
+	// Makes the script ready from the serialized header in a bundle, without reading its compiled asset. The module
+	// is then loaded from the bundle's bytecode, the script has no source code and no dependencies.
+	bool loadFromBundle(Span<const u8> header);
 	StringView getSourceCode() const { return m_source_code; }
+	const ASScriptHeader& getHeader() const { return m_header; }
 
 	static inline const ResourceType TYPE = ResourceType("as_script");
 
@@ -25,6 +92,7 @@ private:
 	TagAllocator m_allocator;
 	Array<ASScript*> m_dependencies;
 	String m_source_code;
+	ASScriptHeader m_header;
 };
 
 } // namespace Lumix
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include "as_trace.h"
+#include "core/allocator.h"
+#include "core/os.h"
+#include "core/stream.h"
+#include "core/string.h"
+
+namespace Lumix
+{
+
+struct ASTrace::ThreadBuffer
+{
+	static constexpr u32 CAPACITY = 16 * 1024;
+
+	Event events[CAPACITY];
+	// total number of recorded events, written only by the owning thread
+	u64 count = 0;
+	u32 tid;
+};
+
+// Traces are told apart by id, a recreated trace may get the address of a destroyed one
+static u32 s_last_trace_id = 0;
+static thread_local ASTrace::ThreadBuffer* t_buffer = nullptr;
+static thread_local u32 t_trace_id = 0;
+
+ASTrace::ASTrace(IAllocator& allocator)
+	: m_allocator(allocator)
+	, m_buffers(allocator)
+	, m_id(++s_last_trace_id)
+{
+}
+
+ASTrace::~ASTrace()
+{
+	for (ThreadBuffer* buffer : m_buffers)
+	{
+		LUMIX_DELETE(m_allocator, buffer);
+	}
+}
+
+u64 ASTrace::now() { return os::Timer::getRawTimestamp(); }
+
+void ASTrace::start()
+{
+	MutexGuard guard(m_mutex);
+	for (ThreadBuffer* buffer : m_buffers)
+	{
+		buffer->count = 0;
+	}
+	m_start_time = now();
+	m_enabled = true;
+}
+
+ASTrace::ThreadBuffer& ASTrace::getThreadBuffer()
+{
+	if (t_trace_id == m_id) return *t_buffer;
+
+	MutexGuard guard(m_mutex);
+	ThreadBuffer* buffer = LUMIX_NEW(m_allocator, ThreadBuffer);
+	buffer->tid = m_buffers.size() + 1;
+	m_buffers.push(buffer);
+	t_buffer = buffer;
+	t_trace_id = m_id;
+	return *buffer;
+}
+
+void ASTrace::record(Phase phase, const char* category, const char* name, u64 time, u64 duration)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	Event& event = buffer.events[buffer.count % ThreadBuffer::CAPACITY];
+	event.time = time;
+	event.duration = duration;
+	event.category = category;
+	event.name = name;
+	event.phase = phase;
+	++buffer.count;
+}
+
+static void writeJSONString(OutputMemoryStream& stream, const char* str)
+{
+	stream.write('"');
+	for (const char* c = str; *c; ++c)
+	{
+		switch (*c)
+		{
+			case '"': stream.write("\\\"", 2); break;
+			case '\\': stream.write("\\\\", 2); break;
+			case '\n': stream.write("\\n", 2); break;
+			case '\t': stream.write("\\t", 2); break;
+			default:
+				if ((u8)*c >= 0x20) stream.write(*c);
+				break;
+		}
+	}
+	stream.write('"');
+}
+
+// Microseconds with nanosecond precision
+static void writeMicroseconds(OutputMemoryStream& stream, u64 ticks, double freq)
+{
+	const double us = ticks * 1e6 / freq;
+	const u64 whole = (u64)us;
+	const u32 fraction = u32((us - whole) * 1000);
+	const StaticString<48> str(whole, fraction < 10 ? ".00" : fraction < 100 ? ".0" : ".", fraction);
+	stream.write(str.data, stringLength(str.data));
+}
+
+// An overwritten BEGIN leaves its END without a pair and a scope still open at export leaves its BEGIN without one.
+// Both are dropped, so the exported BEGIN and END events always match. Indices are sorted: an unpaired END comes
+// only when no scope is open, i.e. before every BEGIN left open at the end.
+void ASTrace::getUnpairedEvents(const ThreadBuffer& buffer, u64 from, Array<u64>& unpaired) const
+{
+	unpaired.clear();
+	u32 open = 0;
+	for (u64 i = from; i < buffer.count; ++i)
+	{
+		const Event& event = buffer.events[i % ThreadBuffer::CAPACITY];
+		if (event.time < m_start_time) continue;
+		if (event.phase == Phase::BEGIN)
+		{
+			unpaired.push(i);
+			++open;
+		}
+		else if (event.phase == Phase::END)
+		{
+			if (open == 0)
+			{
+				unpaired.push(i);
+				continue;
+			}
+			unpaired.pop();
+			--open;
+		}
+	}
+}
+
+void ASTrace::writeJSON(OutputMemoryStream& stream) const
+{
+	const double freq = (double)os::Timer::getFrequency();
+	bool first = true;
+	auto writeText = [&](const char* text) { stream.write(text, stringLength(text)); };
+
+	Array<u64> unpaired(m_allocator);
+
+	writeText("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (const ThreadBuffer* buffer : m_buffers)
+	{
+		const StaticString<16> tid(buffer->tid);
+		const u64 from = buffer->count > ThreadBuffer::CAPACITY ? buffer->count - ThreadBuffer::CAPACITY : 0;
+		getUnpairedEvents(*buffer, from, unpaired);
+		u32 next_unpaired = 0;
+		for (u64 i = from; i < buffer->count; ++i)
+		{
+			const Event& event = buffer->events[i % ThreadBuffer::CAPACITY];
+			// recorded before the last start()
+			if (event.time < m_start_time) continue;
+			if (next_unpaired < (u32)unpaired.size() && unpaired[next_unpaired] == i)
+			{
+				++next_unpaired;
+				continue;
+			}
+
+			if (!first) writeText(",\n");
+			first = false;
+			writeText("{\"name\":");
+			writeJSONString(stream, event.name);
+			writeText(",\"cat\":");
+			writeJSONString(stream, event.category);
+			switch (event.phase)
+			{
+				case Phase::BEGIN: writeText(",\"ph\":\"B\""); break;
+				case Phase::END: writeText(",\"ph\":\"E\""); break;
+				case Phase::COMPLETE: writeText(",\"ph\":\"X\""); break;
+				case Phase::INSTANT: writeText(",\"ph\":\"i\",\"s\":\"t\""); break;
+			}
+			writeText(",\"ts\":");
+			writeMicroseconds(stream, event.time - m_start_time, freq);
+			if (event.phase == Phase::COMPLETE)
+			{
+				writeText(",\"dur\":");
+				writeMicroseconds(stream, event.duration, freq);
+			}
+			writeText(",\"pid\":1,\"tid\":");
+			writeText(tid.data);
+			writeText("}");
+		}
+	}
+	writeText("\n]}\n");
+}
+
+} // namespace Lumix
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "core/array.h"
+#include "core/sync.h"
+
+namespace Lumix
+{
+
+struct OutputMemoryStream;
+
+// Timeline of script activity for offline analysis, exported as Chrome trace-event JSON (chrome://tracing,
+// Perfetto). Every thread records into its own fixed ring without locking, the oldest events are overwritten
+// and BEGIN/END events are exported only in matching pairs.
+struct ASTrace
+{
+	enum class Phase : u8
+	{
+		BEGIN,
+		END,
+		COMPLETE,
+		INSTANT
+	};
+
+	explicit ASTrace(IAllocator& allocator);
+	~ASTrace();
+
+	bool isEnabled() const { return m_enabled; }
+	// Drops previously recorded events
+	void start();
+	void stop() { m_enabled = false; }
+
+	// `category` and `name` are not copied, they must outlive the trace
+	void begin(const char* category, const char* name)
+	{
+		if (m_enabled) record(Phase::BEGIN, category, name, now(), 0);
+	}
+
+	void end(const char* category, const char* name)
+	{
+		if (m_enabled) record(Phase::END, category, name, now(), 0);
+	}
+
+	void instant(const char* category, const char* name)
+	{
+		if (m_enabled) record(Phase::INSTANT, category, name, now(), 0);
+	}
+
+	// Event from `start_time` (see now()) to now
+	void complete(const char* category, const char* name, u64 start_time)
+	{
+		if (m_enabled) record(Phase::COMPLETE, category, name, start_time, now() - start_time);
+	}
+
+	// Reads rings of all threads, call while nothing records, e.g. between frames
+	void writeJSON(OutputMemoryStream& stream) const;
+
+	static u64 now();
+
+private:
+	struct Event
+	{
+		u64 time;
+		u64 duration;
+		const char* category;
+		const char* name;
+		Phase phase;
+	};
+
+	struct ThreadBuffer;
+
+	void record(Phase phase, const char* category, const char* name, u64 time, u64 duration);
+	void getUnpairedEvents(const ThreadBuffer& buffer, u64 from, Array<u64>& unpaired) const;
+	ThreadBuffer& getThreadBuffer();
+
+	IAllocator& m_allocator;
+	Mutex m_mutex;
+	Array<ThreadBuffer*> m_buffers;
+	u64 m_start_time = 0;
+	u32 m_id;
+	bool m_enabled = false;
+};
+
+} // namespace Lumix
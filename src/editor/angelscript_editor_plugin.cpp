@@ -4,18 +4,24 @@
 
 #include "../angelscript_system.h"
 #include "../angelscript_wrapper.h"
+#include "../as_bundle.h"
+#include "../as_completion_index.h"
+#include "../as_heap_snapshot.h"
 #include "../as_script.h"
 #include "core/allocator.h"
 #include "core/array.h"
+#include "core/atomic.h"
 #include "core/command_line_parser.h"
 #include "core/crt.h"
 #include "core/hash.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/math.h"
 #include "core/os.h"
 #include "core/path.h"
 #include "core/profiler.h"
 #include "core/stream.h"
+#include "core/sync.h"
 #include "editor/asset_browser.h"
 #include "editor/asset_compiler.h"
 #include "editor/editor_asset.h"
@@ -40,88 +46,24 @@ static const ComponentType ANGELSCRIPT_TYPE = reflection::getComponentType("ange
 namespace
 {
 
+// Script from editor/scripts/plugins, built into its own module which is kept until the plugin is destroyed.
+// Entry points are resolved once per build and the plugin is rebuilt when its file changes.
 struct StudioAngelScriptPlugin : StudioApp::GUIPlugin
 {
-	static StudioAngelScriptPlugin* create(StudioApp& app, StringView content, const Path& path)
+	// A plugin which fails to load is kept too, it is added to the editor once a change of its file fixes it
+	static StudioAngelScriptPlugin* create(StudioApp& app, const Path& path)
 	{
-		AngelScriptSystem* system = (AngelScriptSystem*)app.getEngine().getSystemManager().getSystem("angelscript");
-		asIScriptEngine* engine = system->getEngine();
-
-		// Create a temporary module to compile and run the plugin script
-		asIScriptModule* module = engine->GetModule("TempPlugin", asGM_CREATE_IF_NOT_EXISTS);
-
-		int r = module->AddScriptSection(path.c_str(), content.begin, content.size());
-		if (r < 0)
-		{
-			logError(path, ": failed to add script section");
-			return nullptr;
-		}
-
-		r = module->Build();
-		if (r < 0)
-		{
-			logError(path, ": failed to build script");
-			return nullptr;
-		}
-
-		// Look for plugin initialization function
-		asIScriptFunction* init_func = module->GetFunctionByDecl("void initPlugin()");
-		if (!init_func)
-		{
-			logError(path, ": missing initPlugin() function");
-			return nullptr;
-		}
-
-		// Execute the initialization
-		asIScriptContext* ctx = engine->CreateContext();
-		ctx->Prepare(init_func);
-		r = ctx->Execute();
-		if (r != asEXECUTION_FINISHED)
-		{
-			logError(path, ": failed to execute initPlugin()");
-			ctx->Release();
-			return nullptr;
-		}
-
-		// Get plugin name
-		asIScriptFunction* name_func = module->GetFunctionByDecl("string getPluginName()");
-		if (!name_func)
-		{
-			logError(path, ": missing getPluginName() function");
-			ctx->Release();
-			return nullptr;
-		}
-
-		ctx->Prepare(name_func);
-		r = ctx->Execute();
-		if (r != asEXECUTION_FINISHED)
-		{
-			logError(path, ": failed to execute getPluginName()");
-			ctx->Release();
-			return nullptr;
-		}
-
-		String* name_ptr = static_cast<String*>(ctx->GetReturnAddress());
-		String plugin_name = *name_ptr;
-
-		StudioAngelScriptPlugin* plugin =
-			LUMIX_NEW(app.getAllocator(), StudioAngelScriptPlugin)(app, plugin_name.c_str());
-
-		// Check for window menu action
-		asIScriptFunction* window_action_func = module->GetFunctionByDecl("void windowMenuAction()");
-		if (window_action_func)
-		{
-			char tmp[64];
-			convertToAngelScriptName(plugin_name.c_str(), tmp);
-			plugin->m_action.create(plugin_name.c_str(), plugin_name.c_str(), tmp, "", Action::WINDOW);
-		}
-
-		plugin->m_script_module = module;
-		plugin->m_script_context = ctx;
-		app.addPlugin(*plugin);
+		StudioAngelScriptPlugin* plugin = LUMIX_NEW(app.getAllocator(), StudioAngelScriptPlugin)(app, path);
+		if (plugin->load()) plugin->addToApp();
 		return plugin;
 	}
 
+	void addToApp()
+	{
+		m_app.addPlugin(*this);
+		m_is_added = true;
+	}
+
 	static void convertToAngelScriptName(const char* src, Span<char> out)
 	{
 		const u32 max_size = out.length();
@@ -149,24 +91,119 @@ struct StudioAngelScriptPlugin : StudioApp::GUIPlugin
 		*dest = 0;
 	}
 
-	StudioAngelScriptPlugin(StudioApp& app, const char* name)
+	StudioAngelScriptPlugin(StudioApp& app, const Path& path)
 		: m_app(app)
-		, m_name(name, app.getAllocator())
-		, m_script_module(nullptr)
-		, m_script_context(nullptr)
+		, m_path(path)
+		, m_name(app.getAllocator())
 	{
+		AngelScriptSystem* system = (AngelScriptSystem*)app.getEngine().getSystemManager().getSystem("angelscript");
+		m_engine = system->getEngine();
 	}
 
 	~StudioAngelScriptPlugin()
 	{
-		if (m_script_context)
+		if (m_script_module) m_script_module->Discard();
+	}
+
+	// Contexts come from the engine's pool, plugins do not own any
+	bool call(asIScriptFunction* func)
+	{
+		asIScriptContext* ctx = m_engine->RequestContext();
+		ctx->Prepare(func);
+		const int r = ctx->Execute();
+		if (r == asEXECUTION_EXCEPTION) logError(m_path, ": ", ctx->GetExceptionString());
+		m_engine->ReturnContext(ctx);
+		return r == asEXECUTION_FINISHED;
+	}
+
+	// Entry points are cleared first, a failed rebuild leaves the plugin inactive until the next change
+	bool load()
+	{
+		m_gui_func = nullptr;
+		m_window_action_func = nullptr;
+		m_settings_loaded_func = nullptr;
+		m_before_settings_saved_func = nullptr;
+
+		FileSystem& fs = m_app.getEngine().getFileSystem();
+		m_last_modified = fs.getLastModified(m_path);
+		OutputMemoryStream content(m_app.getAllocator());
+		if (!fs.getContentSync(m_path, content))
+		{
+			logError("Could not read ", m_path);
+			return false;
+		}
+
+		// module name is the path, so every plugin has its own
+		m_script_module = m_engine->GetModule(m_path.c_str(), asGM_ALWAYS_CREATE);
+		int r = m_script_module->AddScriptSection(m_path.c_str(), (const char*)content.data(), content.size());
+		if (r < 0)
+		{
+			logError(m_path, ": failed to add script section");
+			return false;
+		}
+
+		r = m_script_module->Build();
+		if (r < 0)
+		{
+			logError(m_path, ": failed to build script");
+			return false;
+		}
+
+		asIScriptFunction* init_func = m_script_module->GetFunctionByDecl("void initPlugin()");
+		if (!init_func)
+		{
+			logError(m_path, ": missing initPlugin() function");
+			return false;
+		}
+
+		if (!call(init_func))
+		{
+			logError(m_path, ": failed to execute initPlugin()");
+			return false;
+		}
+
+		// the name identifies the plugin in the editor, it is kept on reload
+		if (m_name.length() == 0)
 		{
-			m_script_context->Release();
+			asIScriptFunction* name_func = m_script_module->GetFunctionByDecl("string getPluginName()");
+			if (!name_func)
+			{
+				logError(m_path, ": missing getPluginName() function");
+				return false;
+			}
+
+			asIScriptContext* ctx = m_engine->RequestContext();
+			ctx->Prepare(name_func);
+			r = ctx->Execute();
+			if (r == asEXECUTION_FINISHED) m_name = *static_cast<String*>(ctx->GetReturnAddress());
+			m_engine->ReturnContext(ctx);
+			if (r != asEXECUTION_FINISHED)
+			{
+				logError(m_path, ": failed to execute getPluginName()");
+				return false;
+			}
 		}
-		if (m_script_module)
+
+		m_gui_func = m_script_module->GetFunctionByDecl("void gui()");
+		m_window_action_func = m_script_module->GetFunctionByDecl("void windowMenuAction()");
+		m_settings_loaded_func = m_script_module->GetFunctionByDecl("void onSettingsLoaded()");
+		m_before_settings_saved_func = m_script_module->GetFunctionByDecl("void onBeforeSettingsSaved()");
+
+		if (m_window_action_func && !m_action.get())
 		{
-			m_script_module->Discard();
+			char tmp[64];
+			convertToAngelScriptName(m_name.c_str(), tmp);
+			m_action.create(m_name.c_str(), m_name.c_str(), tmp, "", Action::WINDOW);
 		}
+		return true;
+	}
+
+	void reloadIfChanged()
+	{
+		if (m_app.getEngine().getFileSystem().getLastModified(m_path) == m_last_modified) return;
+
+		logInfo("Reloading ", m_path);
+		if (load() && !m_is_added) addToApp();
 	}
 
 	bool exportData(const char* dest_dir) override
@@ -177,81 +214,302 @@ struct StudioAngelScriptPlugin : StudioApp::GUIPlugin
 
 	void onGUI() override
 	{
-		if (!m_script_module || !m_script_context) return;
+		if (m_window_action_func && m_action.get() && m_app.checkShortcut(*m_action.get(), true))
+		{
+			call(m_window_action_func);
+		}
+		if (m_gui_func) call(m_gui_func);
+	}
+
+	void onSettingsLoaded() override
+	{
+		if (m_settings_loaded_func) call(m_settings_loaded_func);
+	}
+
+	void onBeforeSettingsSaved() override
+	{
+		if (m_before_settings_saved_func) call(m_before_settings_saved_func);
+	}
+
+	const char* getName() const override { return m_name.c_str(); }
+
+	StudioApp& m_app;
+	Path m_path;
+	Local<Action> m_action;
+	String m_name;
+	asIScriptEngine* m_engine;
+	asIScriptModule* m_script_module = nullptr;
+	u64 m_last_modified = 0;
+	// to the editor, after the first successful load
+	bool m_is_added = false;
+	asIScriptFunction* m_gui_func = nullptr;
+	asIScriptFunction* m_window_action_func = nullptr;
+	asIScriptFunction* m_settings_loaded_func = nullptr;
+	asIScriptFunction* m_before_settings_saved_func = nullptr;
+};
+
+// Builds edited scripts for the code editor on a worker, with an engine of its own, so the UI never waits for the
+// compiler. Requests are coalesced, a client has at most one queued text and only the newest one is built.
+struct ScriptDiagnostics
+{
+	struct Message
+	{
+		explicit Message(IAllocator& allocator)
+			: text(allocator)
+		{
+		}
+
+		// 0-based
+		u32 line;
+		u32 column;
+		bool is_error;
+		String text;
+	};
 
-		// Check window action
-		if (m_action.get() && m_app.checkShortcut(*m_action.get(), true))
+	struct Request
+	{
+		explicit Request(IAllocator& allocator)
+			: text(allocator)
 		{
-			asIScriptFunction* window_action_func = m_script_module->GetFunctionByDecl("void windowMenuAction()");
-			if (window_action_func)
-			{
-				m_script_context->Prepare(window_action_func);
-				m_script_context->Execute();
-			}
 		}
 
-		// Call GUI function
-		asIScriptFunction* gui_func = m_script_module->GetFunctionByDecl("void gui()");
-		if (gui_func)
+		u32 client;
+		Path path;
+		OutputMemoryStream text;
+	};
+
+	struct Result
+	{
+		explicit Result(IAllocator& allocator)
+			: messages(allocator)
+			, symbols(allocator)
 		{
-			m_script_context->Prepare(gui_func);
-			m_script_context->Execute();
 		}
+
+		u32 client;
+		Array<Message> messages;
+		// empty if the build failed
+		ASCompletionIndex symbols;
+		bool built = false;
+	};
+
+	explicit ScriptDiagnostics(StudioApp& app)
+		: m_allocator(app.getAllocator())
+		, m_queue(m_allocator)
+		, m_results(m_allocator)
+		, m_clients(m_allocator)
+		, m_engine_symbols(m_allocator)
+	{
+		m_system = (AngelScriptSystem*)app.getEngine().getSystemManager().getSystem("angelscript");
 	}
 
-	void onSettingsLoaded() override
+	// The registered API does not change after startup, so it is indexed once, on the main thread
+	const ASCompletionIndex& getEngineSymbols()
+	{
+		if (m_engine_symbols.m_symbols.empty()) m_engine_symbols.buildFromEngine(*m_system->getEngine());
+		return m_engine_symbols;
+	}
+
+	~ScriptDiagnostics()
+	{
+		jobs::wait(&m_counter);
+		if (m_engine) m_system->destroyCompileEngine(m_engine);
+	}
+
+	u32 createClient()
 	{
-		if (!m_script_module || !m_script_context) return;
+		MutexGuard guard(m_mutex);
+		m_clients.push(++m_last_client);
+		return m_last_client;
+	}
 
-		asIScriptFunction* settings_func = m_script_module->GetFunctionByDecl("void onSettingsLoaded()");
-		if (settings_func)
+	void destroyClient(u32 client)
+	{
+		MutexGuard guard(m_mutex);
+		m_clients.erase(m_clients.indexOf(client));
+		for (i32 i = m_queue.size() - 1; i >= 0; --i)
 		{
-			m_script_context->Prepare(settings_func);
-			m_script_context->Execute();
+			if (m_queue[i].client == client) m_queue.erase(i);
 		}
+		eraseResults(client);
 	}
 
-	void onBeforeSettingsSaved() override
+	void eraseResults(u32 client)
+	{
+		for (i32 i = m_results.size() - 1; i >= 0; --i)
+		{
+			if (m_results[i].client == client) m_results.erase(i);
+		}
+	}
+
+	void request(u32 client, const Path& path, Span<const u8> text)
 	{
-		if (!m_script_module || !m_script_context) return;
+		// the compile engine registers the whole API, it is made only once somebody needs it
+		if (!m_engine)
+		{
+			m_engine = m_system->createCompileEngine();
+			if (!m_engine) return;
+			m_engine->SetMessageCallback(asFUNCTION(onMessage), this, asCALL_CDECL);
+		}
 
-		asIScriptFunction* settings_func = m_script_module->GetFunctionByDecl("void onBeforeSettingsSaved()");
-		if (settings_func)
+		MutexGuard guard(m_mutex);
+		Request* req = nullptr;
+		for (Request& r : m_queue)
+		{
+			if (r.client == client) req = &r;
+		}
+		if (!req)
 		{
-			m_script_context->Prepare(settings_func);
-			m_script_context->Execute();
+			req = &m_queue.emplace(m_allocator);
+			req->client = client;
 		}
+		req->path = path;
+		req->text.clear();
+		req->text.write(text.begin(), text.length());
+
+		if (m_is_running) return;
+		m_is_running = true;
+		jobs::run(this, &ScriptDiagnostics::process, &m_counter);
 	}
 
-	const char* getName() const override { return m_name.c_str(); }
+	// Newest finished result of `client`, false if there is none since the last call. `symbols` is replaced
+	// only if the build succeeded, completion keeps working while the text is broken.
+	bool popResult(u32 client, Array<Message>& messages, ASCompletionIndex& symbols)
+	{
+		MutexGuard guard(m_mutex);
+		for (i32 i = m_results.size() - 1; i >= 0; --i)
+		{
+			if (m_results[i].client != client) continue;
+			messages = static_cast<Array<Message>&&>(m_results[i].messages);
+			if (m_results[i].built) symbols = static_cast<ASCompletionIndex&&>(m_results[i].symbols);
+			eraseResults(client);
+			return true;
+		}
+		return false;
+	}
 
-	StudioApp& m_app;
-	Path m_path;
-	Local<Action> m_action;
-	String m_name;
-	asIScriptModule* m_script_module;
-	asIScriptContext* m_script_context;
+	// called by the compiler on the worker
+	static void onMessage(const asSMessageInfo* msg, void* param)
+	{
+		// "Compiling ..." lines only give context to the following error
+		if (msg->type == asMSGTYPE_INFORMATION) return;
+
+		ScriptDiagnostics& diagnostics = *(ScriptDiagnostics*)param;
+		Message& message = diagnostics.m_current->emplace(diagnostics.m_allocator);
+		message.line = msg->row > 0 ? msg->row - 1 : 0;
+		message.column = msg->col > 0 ? msg->col - 1 : 0;
+		message.is_error = msg->type == asMSGTYPE_ERROR;
+		message.text = msg->message;
+	}
+
+	static void process(void* data)
+	{
+		PROFILE_FUNCTION();
+		ScriptDiagnostics& diagnostics = *(ScriptDiagnostics*)data;
+		Request req(diagnostics.m_allocator);
+		for (;;)
+		{
+			{
+				MutexGuard guard(diagnostics.m_mutex);
+				if (diagnostics.m_queue.empty())
+				{
+					diagnostics.m_is_running = false;
+					return;
+				}
+				Request& front = diagnostics.m_queue[0];
+				req.client = front.client;
+				req.path = front.path;
+				req.text.clear();
+				req.text.write(front.text.data(), front.text.size());
+				diagnostics.m_queue.erase(0);
+			}
+
+			Result result(diagnostics.m_allocator);
+			result.client = req.client;
+			diagnostics.m_current = &result.messages;
+			asIScriptModule* module = diagnostics.m_engine->GetModule("diagnostics", asGM_ALWAYS_CREATE);
+			module->AddScriptSection(req.path.c_str(), (const char*)req.text.data(), req.text.size());
+			if (module->Build() >= 0)
+			{
+				result.symbols.buildFromModule(*module);
+				result.built = true;
+			}
+			module->Discard();
+			diagnostics.m_current = nullptr;
+
+			MutexGuard guard(diagnostics.m_mutex);
+			// the window may have been closed while building
+			if (diagnostics.m_clients.indexOf(req.client) < 0) continue;
+			diagnostics.m_results.push(static_cast<Result&&>(result));
+		}
+	}
+
+	IAllocator& m_allocator;
+	AngelScriptSystem* m_system;
+	// used only by the worker, except creation and destruction
+	asIScriptEngine* m_engine = nullptr;
+	Array<Message>* m_current = nullptr;
+	Mutex m_mutex;
+	Array<Request> m_queue;
+	Array<Result> m_results;
+	Array<u32> m_clients;
+	u32 m_last_client = 0;
+	jobs::Counter m_counter;
+	bool m_is_running = false;
+	ASCompletionIndex m_engine_symbols;
 };
 
 struct EditorWindow : AssetEditorWindow
 {
-	EditorWindow(const Path& path, StudioApp& app)
+	EditorWindow(const Path& path, StudioApp& app, ScriptDiagnostics& diagnostics)
 		: AssetEditorWindow(app)
 		, m_app(app)
 		, m_path(path)
+		, m_diagnostics(diagnostics)
+		, m_messages(app.getAllocator())
+		, m_module_symbols(app.getAllocator())
+		, m_symbol_results(app.getAllocator())
 	{
+		m_diagnostics_client = diagnostics.createClient();
 		m_file_async_handle =
 			app.getEngine().getFileSystem().getContent(path, makeDelegate<&EditorWindow::onFileLoaded>(this));
 	}
 
 	~EditorWindow()
 	{
+		m_diagnostics.destroyClient(m_diagnostics_client);
 		if (m_file_async_handle.isValid())
 		{
 			m_app.getEngine().getFileSystem().cancel(m_file_async_handle);
 		}
 	}
 
+	// Text is sent once it did not change for DIAGNOSTICS_DELAY, and only if it differs from the last sent one
+	void updateDiagnostics()
+	{
+		Array<ScriptDiagnostics::Message> messages(m_app.getAllocator());
+		if (m_diagnostics.popResult(m_diagnostics_client, messages, m_module_symbols))
+		{
+			m_messages = static_cast<Array<ScriptDiagnostics::Message>&&>(messages);
+			m_code_editor->clearUnderlines();
+			for (const ScriptDiagnostics::Message& msg : m_messages)
+			{
+				m_code_editor->underlineTokens(msg.line, msg.column, msg.column + 1, msg.text.c_str());
+			}
+		}
+
+		if (!m_diagnostics_pending || m_edit_timer.getTimeSinceStart() < DIAGNOSTICS_DELAY) return;
+
+		m_diagnostics_pending = false;
+		OutputMemoryStream blob(m_app.getAllocator());
+		m_code_editor->serializeText(blob);
+		const StableHash hash(blob.data(), (u32)blob.size());
+		if (hash == m_diagnosed_hash) return;
+
+		m_diagnosed_hash = hash;
+		m_diagnostics.request(m_diagnostics_client, m_path, blob);
+	}
+
 	void onFileLoaded(Span<const u8> data, bool success)
 	{
 		m_file_async_handle = FileSystem::AsyncHandle::invalid();
@@ -262,6 +520,7 @@ struct EditorWindow : AssetEditorWindow
 			v.end = (const char*)data.end();
 			m_code_editor = createAngelScriptCodeEditor(m_app);
 			m_code_editor->setText(v);
+			m_diagnostics_pending = true;
 		}
 	}
 
@@ -282,6 +541,15 @@ struct EditorWindow : AssetEditorWindow
 			if (actions.save.iconButton(m_dirty, &m_app)) save();
 			if (actions.open_externally.iconButton(true, &m_app)) m_app.getAssetBrowser().openInExternalEditor(m_path);
 			if (actions.view_in_browser.iconButton(true, &m_app)) m_app.getAssetBrowser().locate(m_path);
+			u32 errors = 0;
+			for (const ScriptDiagnostics::Message& msg : m_messages)
+			{
+				if (msg.is_error) ++errors;
+			}
+			if (!m_messages.empty())
+			{
+				ImGui::TextDisabled("%d errors, %d warnings", errors, m_messages.size() - errors);
+			}
 			ImGui::EndMenuBar();
 		}
 
@@ -298,10 +566,59 @@ struct EditorWindow : AssetEditorWindow
 			if (m_code_editor->gui("codeeditor", ImVec2(0, 0), m_app.getDefaultFont()))
 			{
 				m_dirty = true;
+				m_diagnostics_pending = true;
+				m_edit_timer = os::Timer();
 			}
 
 			ImGui::PopFont();
+			updateDiagnostics();
+		}
+
+		const bool focused = ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows);
+		if (focused && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_Space))
+		{
+			m_symbol_filter[0] = '\0';
+			ImGui::OpenPopup("symbols");
+		}
+		symbolsGUI();
+	}
+
+	// "name" searches global symbols, "Type.name" members of Type; the module's own symbols are listed first
+	void symbolsGUI()
+	{
+		if (!ImGui::BeginPopup("symbols")) return;
+
+		if (ImGui::IsWindowAppearing()) ImGui::SetKeyboardFocusHere();
+		ImGui::SetNextItemWidth(400);
+		ImGui::InputTextWithHint("##filter", "Type.name or name", m_symbol_filter, sizeof(m_symbol_filter));
+
+		StringView text(m_symbol_filter);
+		StringView parent;
+		for (const char* c = m_symbol_filter; *c; ++c)
+		{
+			if (*c != '.') continue;
+			parent = StringView(m_symbol_filter, c);
+			text = StringView(c + 1);
+		}
+
+		const ASCompletionIndex* indices[] = {&m_module_symbols, &m_diagnostics.getEngineSymbols()};
+		for (const ASCompletionIndex* index : indices)
+		{
+			m_symbol_results.clear();
+			index->query(text, parent, MAX_SYMBOL_RESULTS, m_symbol_results);
+			for (u32 idx : m_symbol_results)
+			{
+				const ASCompletionIndex::Symbol& symbol = index->getSymbol(idx);
+				const char* name = index->getString(symbol.name);
+				ImGui::PushID(name);
+				// closes the popup
+				if (ImGui::Selectable(name)) ImGui::SetClipboardText(name);
+				ImGui::PopID();
+				ImGui::SameLine();
+				ImGui::TextDisabled("%s", index->getString(symbol.declaration));
+			}
 		}
+		ImGui::EndPopup();
 	}
 
 	const Path& getPath() override { return m_path; }
@@ -315,10 +632,25 @@ private:
 		return createLuaCodeEditor(app); // Reuse Lua editor for now
 	}
 
+	// seconds
+	static constexpr float DIAGNOSTICS_DELAY = 0.5f;
+	// per index
+	static constexpr u32 MAX_SYMBOL_RESULTS = 50;
+
 	StudioApp& m_app;
 	FileSystem::AsyncHandle m_file_async_handle = FileSystem::AsyncHandle::invalid();
 	Path m_path;
 	UniquePtr<CodeEditor> m_code_editor;
+	ScriptDiagnostics& m_diagnostics;
+	u32 m_diagnostics_client;
+	bool m_diagnostics_pending = false;
+	os::Timer m_edit_timer;
+	StableHash m_diagnosed_hash;
+	Array<ScriptDiagnostics::Message> m_messages;
+	// from the last successful build of the edited text
+	ASCompletionIndex m_module_symbols;
+	Array<u32> m_symbol_results;
+	char m_symbol_filter[64] = "";
 };
 
 static bool gatherIncludes(Span<const u8> src, Lumix::Array<Path>& dependencies, const Path& path)
@@ -357,10 +689,190 @@ static bool gatherIncludes(Span<const u8> src, Lumix::Array<Path>& dependencies,
 	return true;
 }
 
+// Builds scripts with compile engines that have the runtime API, so errors show up when assets are compiled and
+// not when an entity loads the script. Callable from any thread, an engine is used by one thread at a time and
+// there are as many engines as threads validating at once. Reports are cached by content hash.
+struct ScriptValidator
+{
+	struct Report
+	{
+		explicit Report(IAllocator& allocator)
+			: text(allocator)
+			, header(allocator)
+		{
+		}
+
+		void copyFrom(const Report& rhs)
+		{
+			errors = rhs.errors;
+			warnings = rhs.warnings;
+			text = rhs.text;
+			header.clear();
+			header.write(rhs.header.data(), rhs.header.size());
+		}
+
+		u32 errors = 0;
+		u32 warnings = 0;
+		// "(row, col): message" lines, without the path so a report is valid for any file with the same content
+		String text;
+		// serialized ASScriptHeader
+		OutputMemoryStream header;
+	};
+
+	explicit ScriptValidator(StudioApp& app)
+		: m_allocator(app.getAllocator())
+		, m_engines(m_allocator)
+		, m_free_engines(m_allocator)
+		, m_cache(m_allocator)
+	{
+		m_system = (AngelScriptSystem*)app.getEngine().getSystemManager().getSystem("angelscript");
+	}
+
+	~ScriptValidator()
+	{
+		for (asIScriptEngine* engine : m_engines)
+		{
+			m_system->destroyCompileEngine(engine);
+		}
+		for (Report* report : m_cache)
+		{
+			LUMIX_DELETE(m_allocator, report);
+		}
+	}
+
+	// Scripts in editor/ use the editor API, which compile engines do not have
+	static bool isValidated(const Path& path) { return !startsWith(path.c_str(), "editor/"); }
+
+	static void onMessage(const asSMessageInfo* msg, void* param)
+	{
+		Report& report = *(Report*)param;
+		const char* type = "info";
+		if (msg->type == asMSGTYPE_ERROR)
+		{
+			type = "error";
+			++report.errors;
+		}
+		else if (msg->type == asMSGTYPE_WARNING)
+		{
+			type = "warning";
+			++report.warnings;
+		}
+		const StaticString<64> location("(", msg->row, ", ", msg->col, "): ", type, ": ");
+		report.text.append(location.data);
+		report.text.append(msg->message);
+		report.text.append("\n");
+	}
+
+	void validate(Span<const u8> source, Report& report)
+	{
+		PROFILE_FUNCTION();
+		const StableHash hash(source.begin(), (u32)source.length());
+		{
+			MutexGuard guard(m_mutex);
+			auto iter = m_cache.find(hash);
+			if (iter.isValid())
+			{
+				report.copyFrom(*iter.value());
+				return;
+			}
+		}
+
+		asIScriptEngine* engine = acquireEngine();
+		ASScriptHeader header(m_allocator);
+		report.errors = report.warnings = 0;
+		report.text = "";
+		report.header.clear();
+		if (!engine)
+		{
+			report.errors = 1;
+			report.text = "failed to create compile engine\n";
+			header.serialize(report.header);
+			return;
+		}
+
+		engine->SetMessageCallback(asFUNCTION(onMessage), &report, asCALL_CDECL);
+		asIScriptModule* module = engine->GetModule("validation", asGM_ALWAYS_CREATE);
+		const StringView source_view((const char*)source.begin(), (u32)source.length());
+		module->AddScriptSection("script", source_view.begin, source_view.size());
+		if (module->Build() >= 0) header.build(*module, source_view);
+		header.serialize(report.header);
+		module->Discard();
+		engine->ClearMessageCallback();
+
+		MutexGuard guard(m_mutex);
+		m_free_engines.push(engine);
+		if (m_cache.find(hash).isValid()) return;
+		Report* cached = LUMIX_NEW(m_allocator, Report)(m_allocator);
+		cached->copyFrom(report);
+		m_cache.insert(hash, cached);
+	}
+
+	// Not cached, bundles are built rarely. Debug info is kept so errors in shipping builds still have lines.
+	bool compileBytecode(Span<const u8> source, const Path& path, OutputMemoryStream& bytecode)
+	{
+		PROFILE_FUNCTION();
+		asIScriptEngine* engine = acquireEngine();
+		if (!engine) return false;
+
+		asIScriptModule* module = engine->GetModule("bundle", asGM_ALWAYS_CREATE);
+		module->AddScriptSection(path.c_str(), (const char*)source.begin(), (u32)source.length());
+		bool res = module->Build() >= 0;
+		if (res)
+		{
+			ASBytecodeWriter writer(bytecode);
+			res = module->SaveByteCode(&writer, false) >= 0;
+		}
+		module->Discard();
+
+		MutexGuard guard(m_mutex);
+		m_free_engines.push(engine);
+		return res;
+	}
+
+	// Compile engines have the API of shipping builds, without the editor's
+	u64 getAPIHash()
+	{
+		asIScriptEngine* engine = acquireEngine();
+		if (!engine) return 0;
+		const u64 hash = ASBundle::computeAPIHash(*engine, m_allocator);
+		MutexGuard guard(m_mutex);
+		m_free_engines.push(engine);
+		return hash;
+	}
+
+	asIScriptEngine* acquireEngine()
+	{
+		{
+			MutexGuard guard(m_mutex);
+			if (!m_free_engines.empty())
+			{
+				asIScriptEngine* engine = m_free_engines.back();
+				m_free_engines.pop();
+				return engine;
+			}
+		}
+		// createCompileEngine serializes registration, other threads can reuse free engines meanwhile
+		asIScriptEngine* engine = m_system->createCompileEngine();
+		if (!engine) return nullptr;
+		MutexGuard guard(m_mutex);
+		m_engines.push(engine);
+		return engine;
+	}
+
+	IAllocator& m_allocator;
+	AngelScriptSystem* m_system;
+	Mutex m_mutex;
+	Array<asIScriptEngine*> m_engines;
+	Array<asIScriptEngine*> m_free_engines;
+	HashMap<StableHash, Report*> m_cache;
+};
+
 struct AssetPlugin : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 {
 	explicit AssetPlugin(StudioApp& app)
 		: m_app(app)
+		, m_diagnostics(app)
+		, m_validator(app)
 	{
 		app.getAssetCompiler().registerExtension("as", ASScript::TYPE);
 	}
@@ -368,7 +880,7 @@ struct AssetPlugin : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 	void openEditor(const Path& path) override
 	{
 		IAllocator& allocator = m_app.getAllocator();
-		UniquePtr<EditorWindow> win = UniquePtr<EditorWindow>::create(allocator, path, m_app);
+		UniquePtr<EditorWindow> win = UniquePtr<EditorWindow>::create(allocator, path, m_app, m_diagnostics);
 		m_app.getAssetBrowser().addWindow(win.move());
 	}
 
@@ -381,7 +893,20 @@ struct AssetPlugin : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 		Array<Path> deps(m_app.getAllocator());
 		if (!gatherIncludes(src_data, deps, src)) return false;
 
+		// errors are reported, the source is still written so the runtime shows the same errors on load
 		OutputMemoryStream out(m_app.getAllocator());
+		if (ScriptValidator::isValidated(src))
+		{
+			ScriptValidator::Report report(m_app.getAllocator());
+			m_validator.validate(src_data, report);
+			if (report.errors > 0) logError(src, ":\n", report.text.c_str());
+			out.write(report.header.data(), report.header.size());
+		}
+		else
+		{
+			ASScriptHeader(m_app.getAllocator()).serialize(out);
+		}
+
 		out.write(deps.size());
 		for (const Path& dep : deps)
 		{
@@ -399,6 +924,8 @@ struct AssetPlugin : AssetBrowser::IPlugin, AssetCompiler::IPlugin
 	void createResource(OutputMemoryStream& blob) override { blob << "void update(float time_delta)\n{\n}\n"; }
 
 	StudioApp& m_app;
+	ScriptDiagnostics m_diagnostics;
+	ScriptValidator m_validator;
 };
 
 struct AddComponentPlugin final : StudioApp::IAddComponentPlugin
@@ -503,13 +1030,824 @@ struct PropertyGridPlugin final : PropertyGrid::IPlugin
 	}
 };
 
-struct AngelScriptAction
+// Results of the sampling profiler, the hottest folded stacks first, and per-function stats
+struct ProfilerWindow final : StudioApp::GUIPlugin
 {
-	void run()
+	static constexpr u32 MAX_ROWS = 200;
+	static constexpr u32 MAX_RETAINING_PATHS = 50;
+
+	explicit ProfilerWindow(StudioApp& app)
+		: m_app(app)
+		, m_rows(app.getAllocator())
+		, m_function_rows(app.getAllocator())
+		, m_native_rows(app.getAllocator())
+		, m_object_counts(app.getAllocator())
+		, m_script_memory(app.getAllocator())
+		, m_heap_before(app.getAllocator())
+		, m_heap_after(app.getAllocator())
+		, m_heap_diff(app.getAllocator())
+		, m_heap_selected_type(app.getAllocator())
+	{
+		m_system = (AngelScriptSystem*)app.getEngine().getSystemManager().getSystem("angelscript");
+		m_action.create("AngelScript profiler", "AngelScript profiler", "angelscript_profiler", "", Action::WINDOW);
+	}
+
+	~ProfilerWindow() { m_system->stopSampling(); }
+
+	void onGUI() override
+	{
+		if (m_app.checkShortcut(*m_action.get(), true)) m_is_open = !m_is_open;
+		if (!m_is_open) return;
+
+		if (ImGui::Begin("AngelScript profiler", &m_is_open)) windowGUI();
+		ImGui::End();
+	}
+
+	void windowGUI()
+	{
+		i32 zones = (i32)m_system->getProfilerZones();
+		ImGui::SetNextItemWidth(120);
+		if (ImGui::Combo("Zones", &zones, "None\0Callbacks\0Functions\0"))
+		{
+			m_system->setProfilerZones((AngelScriptSystem::ProfilerZones)zones);
+		}
+
+		if (!ImGui::BeginTabBar("tabs")) return;
+		if (ImGui::BeginTabItem("Samples"))
+		{
+			samplesGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Functions"))
+		{
+			functionsGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("VM"))
+		{
+			vmGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Memory"))
+		{
+			memoryGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Natives"))
+		{
+			nativesGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Trace"))
+		{
+			traceGUI();
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Heap"))
+		{
+			heapGUI();
+			ImGui::EndTabItem();
+		}
+		ImGui::EndTabBar();
+	}
+
+	void vmGUI()
+	{
+		const AngelScriptSystem::VMStats& stats = m_system->getVMStats();
+		ImGui::Text("Callbacks: %u", stats.callbacks);
+		ImGui::Text("Script calls: %u", stats.script_calls);
+		ImGui::Text("Native calls: %u", stats.native_calls);
+		ImGui::Text("Instructions: %llu", (unsigned long long)stats.instructions);
+		ImGui::Text("Contexts: %u (%u pooled, %u peak active)",
+			stats.contexts,
+			stats.pooled_contexts,
+			stats.peak_active_contexts);
+		ImGui::Text("Stack: %.1f KB", stats.stack_bytes / 1024.f);
+		ImGui::Text("GC objects: %u (%u new, %u old)", stats.gc_objects, stats.gc_new_objects, stats.gc_old_objects);
+		ImGui::Text("GC destroyed: %llu, detected: %llu",
+			(unsigned long long)stats.gc_destroyed,
+			(unsigned long long)stats.gc_detected);
+		ImGui::Text("String constants: %u", stats.string_constants);
+		ImGui::Text("Modules: %u, bytecode %.1f KB", stats.modules, stats.bytecode_bytes / 1024.f);
+		ImGui::Text("Compile: %.3f ms, total %.3f s", stats.compile_time * 1000, stats.total_compile_time);
+
+		ImGui::Separator();
+		i32 watchdog_ticks = (i32)m_system->getWatchdogTicks();
+		i32 watchdog_ms = (i32)m_system->getWatchdogTime();
+		ImGui::SetNextItemWidth(120);
+		bool watchdog_changed = ImGui::DragInt("Watchdog ticks", &watchdog_ticks, 1024, 0, 0x7fFFffFF);
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(80);
+		watchdog_changed = ImGui::DragInt("Watchdog (ms)", &watchdog_ms, 1, 0, 60000) || watchdog_changed;
+		if (watchdog_changed) m_system->setWatchdog((u32)watchdog_ticks, (u32)watchdog_ms);
+
+		ImGui::Separator();
+		if (ImGui::Button("Count objects")) m_system->getObjectTypeCounts(m_object_counts);
+		for (const AngelScriptSystem::ObjectTypeCount& count : m_object_counts)
+		{
+			ImGui::Text("%s: %u", count.type, count.count);
+		}
+	}
+
+	void memoryGUI()
+	{
+		m_system->getScriptMemory(m_script_memory);
+		// biggest first
+		for (u32 i = 1, c = m_script_memory.size(); i < c; ++i)
+		{
+			const AngelScriptSystem::ScriptMemory mem = m_script_memory[i];
+			const u64 total = mem.compiled_bytes + mem.runtime_bytes;
+			u32 j = i;
+			for (; j > 0 && m_script_memory[j - 1].compiled_bytes + m_script_memory[j - 1].runtime_bytes < total; --j)
+			{
+				m_script_memory[j] = m_script_memory[j - 1];
+			}
+			m_script_memory[j] = mem;
+		}
+
+		const ImGuiTableFlags flags =
+			ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+		if (!ImGui::BeginTable("memory", 7, flags)) return;
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Script");
+		ImGui::TableSetupColumn("Compiled (KB)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Runtime (KB)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Peak (KB)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Limit (KB)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Refused", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Allocations", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableHeadersRow();
+		for (const AngelScriptSystem::ScriptMemory& mem : m_script_memory)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(mem.path);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", mem.compiled_bytes / 1024.f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", mem.runtime_bytes / 1024.f);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", mem.peak_runtime_bytes / 1024.f);
+			ImGui::TableNextColumn();
+			if (mem.limit)
+			{
+				ImGui::Text("%.1f", mem.limit / 1024.f);
+			}
+			else
+			{
+				ImGui::TextUnformatted("-");
+			}
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)mem.limit_failures);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)mem.allocations);
+		}
+		ImGui::EndTable();
+	}
+
+	void nativesGUI()
+	{
+		if (!m_system->isNativeCallTracingAvailable())
+		{
+			ImGui::TextUnformatted("Native call tracing is compiled out, build with --angelscript-native-trace");
+			return;
+		}
+
+		bool enabled = m_system->isNativeCallTracing();
+		if (ImGui::Checkbox("Enabled", &enabled)) m_system->setNativeCallTracing(enabled);
+		ImGui::SameLine();
+		if (ImGui::Button("Reset")) m_system->resetNativeCallStats();
+		ImGui::SameLine();
+		i32 threshold = (i32)m_system->getNativeTraceThreshold();
+		ImGui::SetNextItemWidth(80);
+		if (ImGui::DragInt("Trace threshold (us)", &threshold, 1, 0, 100000))
+		{
+			m_system->setNativeTraceThreshold((u32)threshold);
+		}
+
+		const Span<const AngelScriptSystem::NativeCallStats> stats = m_system->getNativeCallStats();
+		m_native_rows.clear();
+		for (u32 i = 0, c = stats.length(); i < c; ++i)
+		{
+			if (stats[i].calls == 0) continue;
+			// by time, descending
+			u32 pos = m_native_rows.size();
+			while (pos > 0 && stats[m_native_rows[pos - 1]].time < stats[i].time) --pos;
+			m_native_rows.insert(pos, i);
+		}
+
+		const ImGuiTableFlags flags =
+			ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+		if (!ImGui::BeginTable("natives", 4, flags)) return;
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Function");
+		ImGui::TableSetupColumn("Caller");
+		ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Time (ms)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableHeadersRow();
+		for (u32 idx : m_native_rows)
+		{
+			const AngelScriptSystem::NativeCallStats& ns = stats[idx];
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(ns.name);
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(ns.caller ? ns.caller : "-");
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)ns.calls);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", ns.time * 1000);
+		}
+		ImGui::EndTable();
+	}
+
+	void traceGUI()
+	{
+		if (m_system->isTracing())
+		{
+			if (ImGui::Button("Stop")) m_system->stopTrace();
+		}
+		else if (ImGui::Button("Start"))
+		{
+			m_system->startTrace();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Export")) exportTrace();
+		ImGui::TextUnformatted("Callbacks, compiles and slow native calls, Chrome trace-event format");
+	}
+
+	void exportTrace()
+	{
+		char path[MAX_PATH];
+		if (!os::getSaveFilename(Span(path), "Chrome trace\0*.json\0", "json")) return;
+
+		OutputMemoryStream blob(m_app.getAllocator());
+		m_system->writeTrace(blob);
+		saveFile(path, blob);
+	}
+
+	void heapSlotGUI(const char* label, ASHeapSnapshot& snapshot)
+	{
+		ImGui::PushID(label);
+		ImGui::AlignTextToFramePadding();
+		ImGui::TextUnformatted(label);
+		ImGui::SameLine();
+		if (ImGui::Button("Take"))
+		{
+			OutputMemoryStream blob(m_app.getAllocator());
+			m_system->writeHeapSnapshot(blob);
+			InputMemoryStream input(blob);
+			snapshot.deserialize(input);
+			updateHeapDiff();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Save")) saveHeapSnapshot(snapshot);
+		ImGui::SameLine();
+		if (ImGui::Button("Load")) loadHeapSnapshot(snapshot);
+		ImGui::SameLine();
+		u64 bytes = 0;
+		for (const ASHeapSnapshot::Node& node : snapshot.m_nodes) bytes += node.size;
+		ImGui::Text("%u objects, %.1f KB, %u roots", snapshot.m_nodes.size(), bytes / 1024.f, snapshot.m_roots.size());
+		ImGui::PopID();
+	}
+
+	void saveHeapSnapshot(const ASHeapSnapshot& snapshot)
+	{
+		char path[MAX_PATH];
+		if (!os::getSaveFilename(Span(path), "Heap snapshot\0*.ashs\0", "ashs")) return;
+
+		OutputMemoryStream blob(m_app.getAllocator());
+		snapshot.serialize(blob);
+		saveFile(path, blob);
+	}
+
+	void loadHeapSnapshot(ASHeapSnapshot& snapshot)
+	{
+		char path[MAX_PATH];
+		if (!os::getOpenFilename(Span(path), "Heap snapshot\0*.ashs\0", nullptr)) return;
+
+		os::InputFile file;
+		if (!file.open(path))
+		{
+			logError("Failed to open ", path);
+			return;
+		}
+		OutputMemoryStream blob(m_app.getAllocator());
+		blob.resize(file.size());
+		const bool read = file.read(blob.getMutableData(), blob.size());
+		file.close();
+		InputMemoryStream input(blob);
+		if (!read || !snapshot.deserialize(input)) logError(path, " is not a valid heap snapshot");
+		updateHeapDiff();
+	}
+
+	// By growth in bytes, the likely leaks first
+	void updateHeapDiff()
+	{
+		ASHeapSnapshot::diff(m_heap_before, m_heap_after, m_heap_diff);
+		auto growth = [](const ASHeapSnapshot::TypeDiff& diff) { return (i64)diff.bytes[1] - (i64)diff.bytes[0]; };
+		for (u32 i = 1, c = m_heap_diff.size(); i < c; ++i)
+		{
+			const ASHeapSnapshot::TypeDiff diff = m_heap_diff[i];
+			u32 j = i;
+			for (; j > 0 && growth(m_heap_diff[j - 1]) < growth(diff); --j) m_heap_diff[j] = m_heap_diff[j - 1];
+			m_heap_diff[j] = diff;
+		}
+	}
+
+	void heapGUI()
+	{
+		heapSlotGUI("Before", m_heap_before);
+		heapSlotGUI("After", m_heap_after);
+
+		const ImGuiTableFlags flags =
+			ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+		const ImVec2 size(0, ImGui::GetContentRegionAvail().y * 0.6f);
+		if (ImGui::BeginTable("heap", 5, flags, size))
+		{
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableSetupColumn("Type");
+			ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableSetupColumn("Count diff", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableSetupColumn("KB", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableSetupColumn("KB diff", ImGuiTableColumnFlags_WidthFixed);
+			ImGui::TableHeadersRow();
+			for (const ASHeapSnapshot::TypeDiff& diff : m_heap_diff)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				const bool selected = equalStrings(m_heap_selected_type.c_str(), diff.type);
+				if (ImGui::Selectable(diff.type, selected, ImGuiSelectableFlags_SpanAllColumns))
+				{
+					m_heap_selected_type = diff.type;
+				}
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", diff.count[1]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%+d", (i32)diff.count[1] - (i32)diff.count[0]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", diff.bytes[1] / 1024.f);
+				ImGui::TableNextColumn();
+				ImGui::Text("%+.1f", ((i64)diff.bytes[1] - (i64)diff.bytes[0]) / 1024.f);
+			}
+			ImGui::EndTable();
+		}
+
+		if (m_heap_selected_type.length() == 0) return;
+
+		// shortest retaining paths of the selected type in the newer snapshot
+		ImGui::Text("Retained %s:", m_heap_selected_type.c_str());
+		if (ImGui::BeginChild("retainers"))
+		{
+			String path(m_app.getAllocator());
+			u32 shown = 0;
+			for (u32 i = 0, c = m_heap_after.m_nodes.size(); i < c && shown < MAX_RETAINING_PATHS; ++i)
+			{
+				const char* type = m_heap_after.getString(m_heap_after.m_nodes[i].type);
+				if (!equalStrings(type, m_heap_selected_type.c_str())) continue;
+				m_heap_after.getRetainingPath(i, path);
+				ImGui::TextUnformatted(path.length() ? path.c_str() : "unreachable, waiting for GC");
+				++shown;
+			}
+		}
+		ImGui::EndChild();
+	}
+
+	void saveFile(const char* path, const OutputMemoryStream& blob)
+	{
+		os::OutputFile file;
+		if (!file.open(path))
+		{
+			logError("Failed to create ", path);
+			return;
+		}
+		if (!file.write(blob.data(), blob.size())) logError("Failed to write ", path);
+		file.close();
+	}
+
+	void functionsGUI()
+	{
+		using Mode = AngelScriptSystem::FunctionStatsMode;
+		i32 mode = (i32)m_system->getFunctionStatsMode();
+		ImGui::SetNextItemWidth(120);
+		if (ImGui::Combo("Mode", &mode, "Disabled\0Per frame\0Session\0")) m_system->setFunctionStatsMode((Mode)mode);
+		ImGui::SameLine();
+		if (ImGui::Button("Reset")) m_system->resetFunctionStats();
+		if (mode == (i32)Mode::DISABLED) return;
+
+		const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable
+									  | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Sortable;
+		if (!ImGui::BeginTable("functions", 5, flags)) return;
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Function", ImGuiTableColumnFlags_NoSort);
+		ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Instructions", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Inclusive (ms)", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn(
+			"Exclusive (ms)", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultSort);
+		ImGui::TableHeadersRow();
+
+		const Span<const AngelScriptSystem::FunctionStats> stats = m_system->getFunctionStats();
+		// the order is kept between frames, new functions are only appended; per-frame stats are empty after reset
+		if (m_function_rows.size() > stats.length()) m_function_rows.clear();
+		for (u32 i = m_function_rows.size(), c = stats.length(); i < c; ++i)
+		{
+			m_function_rows.push(i);
+		}
+		if (ImGuiTableSortSpecs* specs = ImGui::TableGetSortSpecs())
+		{
+			if (specs->SpecsCount > 0)
+			{
+				m_sort_column = specs->Specs[0].ColumnIndex;
+				m_sort_ascending = specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+			}
+		}
+		sortFunctionRows(stats);
+
+		for (u32 idx : m_function_rows)
+		{
+			const AngelScriptSystem::FunctionStats& fs = stats[idx];
+			if (fs.calls == 0) continue;
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(fs.name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)fs.calls);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", (unsigned long long)fs.instructions);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", fs.inclusive_time * 1000);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", fs.exclusive_time * 1000);
+		}
+		ImGui::EndTable();
+	}
+
+	static double getSortValue(const AngelScriptSystem::FunctionStats& fs, i32 column)
+	{
+		switch (column)
+		{
+			case 1: return (double)fs.calls;
+			case 2: return (double)fs.instructions;
+			case 3: return fs.inclusive_time;
+			default: return fs.exclusive_time;
+		}
+	}
+
+	// Insertion sort, rows are mostly sorted from the previous frame
+	void sortFunctionRows(Span<const AngelScriptSystem::FunctionStats> stats)
+	{
+		for (u32 i = 1, c = m_function_rows.size(); i < c; ++i)
+		{
+			const u32 row = m_function_rows[i];
+			const double value = getSortValue(stats[row], m_sort_column);
+			u32 j = i;
+			for (; j > 0; --j)
+			{
+				const double prev = getSortValue(stats[m_function_rows[j - 1]], m_sort_column);
+				if (m_sort_ascending ? prev <= value : prev >= value) break;
+				m_function_rows[j] = m_function_rows[j - 1];
+			}
+			m_function_rows[j] = row;
+		}
+	}
+
+	void samplesGUI()
+	{
+		if (m_system->isSampling())
+		{
+			if (ImGui::Button("Stop")) m_system->stopSampling();
+		}
+		else
+		{
+			ImGui::SetNextItemWidth(80);
+			ImGui::DragInt("Interval (ms)", &m_interval_ms, 1, 1, 100);
+			ImGui::SameLine();
+			if (ImGui::Button("Start")) m_system->startSampling((u32)m_interval_ms);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear")) m_system->clearSamples();
+		ImGui::SameLine();
+		if (ImGui::Button("Export")) exportFoldedStacks();
+
+		const u32 total = m_system->getSampleCount();
+		ImGui::Text("%u samples, %u dropped", total, m_system->getDroppedSampleCount());
+		if (total == 0) return;
+
+		const Span<const AngelScriptSystem::SampledStack> stacks = m_system->getSampledStacks();
+		gatherRows(stacks);
+
+		const ImGuiTableFlags flags =
+			ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+		if (!ImGui::BeginTable("stacks", 3, flags)) return;
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Samples", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("%", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Function");
+		ImGui::TableHeadersRow();
+		for (u32 idx : m_rows)
+		{
+			const AngelScriptSystem::SampledStack& stack = stacks[idx];
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", stack.count);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", 100.f * stack.count / total);
+			ImGui::TableNextColumn();
+			// innermost function, the whole stack is in the tooltip
+			const char* leaf = stack.stack.c_str();
+			for (const char* c = leaf; *c; ++c)
+			{
+				if (*c == ';') leaf = c + 1;
+			}
+			ImGui::TextUnformatted(leaf);
+			if (ImGui::IsItemHovered()) ImGui::SetTooltip("%s", stack.stack.c_str());
+		}
+		ImGui::EndTable();
+	}
+
+	// Top MAX_ROWS stacks by sample count, insertion sorted
+	void gatherRows(Span<const AngelScriptSystem::SampledStack> stacks)
+	{
+		m_rows.clear();
+		for (u32 i = 0, c = stacks.length(); i < c; ++i)
+		{
+			const u32 count = stacks[i].count;
+			if (m_rows.size() == MAX_ROWS && stacks[m_rows.back()].count >= count) continue;
+			if (m_rows.size() == MAX_ROWS) m_rows.pop();
+
+			u32 pos = m_rows.size();
+			while (pos > 0 && stacks[m_rows[pos - 1]].count < count) --pos;
+			m_rows.insert(pos, i);
+		}
+	}
+
+	void exportFoldedStacks()
+	{
+		char path[MAX_PATH];
+		if (!os::getSaveFilename(Span(path), "Folded stacks\0*.folded\0", "folded")) return;
+
+		OutputMemoryStream blob(m_app.getAllocator());
+		m_system->writeFoldedStacks(blob);
+		saveFile(path, blob);
+	}
+
+	const char* getName() const override { return "angelscript_profiler"; }
+
+	StudioApp& m_app;
+	AngelScriptSystem* m_system;
+	Local<Action> m_action;
+	Array<u32> m_rows;
+	Array<u32> m_function_rows;
+	Array<u32> m_native_rows;
+	Array<AngelScriptSystem::ObjectTypeCount> m_object_counts;
+	Array<AngelScriptSystem::ScriptMemory> m_script_memory;
+	ASHeapSnapshot m_heap_before;
+	ASHeapSnapshot m_heap_after;
+	Array<ASHeapSnapshot::TypeDiff> m_heap_diff;
+	String m_heap_selected_type;
+	i32 m_sort_column = 4;
+	bool m_sort_ascending = false;
+	i32 m_interval_ms = 1;
+	bool m_is_open = false;
+};
+
+// Validates every script of the project at once, files are read and built on all workers
+struct ValidationWindow final : StudioApp::GUIPlugin
+{
+	struct Entry
+	{
+		explicit Entry(IAllocator& allocator)
+			: report(allocator)
+			, bytecode(allocator)
+		{
+		}
+
+		Path path;
+		ScriptValidator::Report report;
+		// only when building a bundle, empty if the script failed
+		OutputMemoryStream bytecode;
+		bool read_failed = false;
+	};
+
+	ValidationWindow(StudioApp& app, ScriptValidator& validator)
+		: m_app(app)
+		, m_validator(validator)
+		, m_entries(app.getAllocator())
+		, m_bundle_path(app.getAllocator())
+	{
+		const char* name = "AngelScript validation";
+		m_action.create(name, name, "angelscript_validation", "", Action::WINDOW);
+	}
+
+	~ValidationWindow() { jobs::wait(&m_counter); }
+
+	static void gatherScripts(FileSystem& fs, const Path& dir, Array<Entry>& entries, IAllocator& allocator)
+	{
+		os::FileIterator* iter = fs.createFileIterator(dir);
+		os::FileInfo info;
+		while (os::getNextFile(iter, &info))
+		{
+			if (info.filename[0] == '.') continue;
+
+			const Path path = dir.isEmpty() ? Path(info.filename) : Path(dir, "/", info.filename);
+			if (info.is_directory)
+			{
+				gatherScripts(fs, path, entries, allocator);
+			}
+			else if (Path::hasExtension(info.filename, "as") && ScriptValidator::isValidated(path))
+			{
+				entries.emplace(allocator).path = path;
+			}
+		}
+		os::destroyFileIterator(iter);
+	}
+
+	// `bundle_path` is empty to only validate
+	void start(const char* bundle_path)
+	{
+		m_bundle_path = bundle_path;
+		m_entries.clear();
+		gatherScripts(m_app.getEngine().getFileSystem(), Path(), m_entries, m_app.getAllocator());
+		m_next = 0;
+		m_finished = 0;
+		m_done = 0;
+		m_start_time = os::Timer::getRawTimestamp();
+		m_running = true;
+		jobs::run(this, &ValidationWindow::process, &m_counter);
+	}
+
+	static void process(void* data)
+	{
+		PROFILE_FUNCTION();
+		ValidationWindow& window = *(ValidationWindow*)data;
+		FileSystem& fs = window.m_app.getEngine().getFileSystem();
+		jobs::runOnWorkers([&]() {
+			OutputMemoryStream content(window.m_app.getAllocator());
+			for (;;)
+			{
+				const i32 idx = window.m_next.add(1);
+				if (idx >= window.m_entries.size()) return;
+
+				Entry& entry = window.m_entries[idx];
+				content.clear();
+				if (fs.getContentSync(entry.path, content))
+				{
+					window.m_validator.validate(content, entry.report);
+					if (!window.m_bundle_path.empty() && entry.report.errors == 0)
+					{
+						window.m_validator.compileBytecode(content, entry.path, entry.bytecode);
+					}
+				}
+				else
+				{
+					entry.read_failed = true;
+				}
+				window.m_finished.add(1);
+			}
+		});
+		if (!window.m_bundle_path.empty()) window.writeBundle();
+		window.m_duration = os::Timer::getRawTimestamp() - window.m_start_time;
+		window.m_done = 1;
+	}
+
+	void writeBundle()
+	{
+		PROFILE_FUNCTION();
+		IAllocator& allocator = m_app.getAllocator();
+		ASBundleWriter writer(allocator);
+		u32 missing = 0;
+		for (const Entry& entry : m_entries)
+		{
+			if (entry.bytecode.size() == 0) ++missing;
+			else writer.add(entry.path, entry.report.header, entry.bytecode);
+		}
+		OutputMemoryStream blob(allocator);
+		writer.write(blob, m_validator.getAPIHash());
+
+		os::OutputFile file;
+		const char* path = m_bundle_path.c_str();
+		if (!file.open(path))
+		{
+			logError("Failed to create ", path);
+			return;
+		}
+		if (!file.write(blob.data(), blob.size())) logError("Failed to write ", path);
+		file.close();
+		if (missing > 0) logError(missing, " scripts failed to compile and are not in ", path);
+		else logInfo("Script bundle ", path, " with ", m_entries.size(), " scripts");
+	}
+
+	void onGUI() override
+	{
+		if (m_app.checkShortcut(*m_action.get(), true)) m_is_open = !m_is_open;
+		if (!m_is_open) return;
+
+		if (ImGui::Begin("AngelScript validation", &m_is_open)) windowGUI();
+		ImGui::End();
+	}
+
+	void windowGUI()
+	{
+		// entries are written by the jobs until all of them are finished
+		if (m_running && m_done) m_running = false;
+		if (m_running)
+		{
+			ImGui::Text("Validating %d / %d", (i32)m_finished, m_entries.size());
+			return;
+		}
+
+		if (ImGui::Button("Validate all")) start("");
+		ImGui::SameLine();
+		if (ImGui::Button("Build bundle"))
+		{
+			char path[MAX_PATH];
+			if (os::getSaveFilename(Span(path), "AngelScript bundle\0*.asb\0", "asb")) start(path);
+		}
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::SetTooltip("Compiled scripts in one file, load it with -angelscript_bundle <path>");
+		}
+		if (m_running || m_entries.empty()) return;
+
+		u32 errors = 0, failed_files = 0;
+		for (const Entry& entry : m_entries)
+		{
+			errors += entry.report.errors;
+			if (entry.report.errors > 0 || entry.read_failed) ++failed_files;
+		}
+		ImGui::SameLine();
+		const float seconds = float(m_duration / (double)os::Timer::getFrequency());
+		ImGui::Text("%d scripts, %d with errors, %d errors, %.2f s", m_entries.size(), failed_files, errors, seconds);
+		ImGui::Checkbox("Only failed", &m_only_failed);
+
+		if (!ImGui::BeginTable("scripts", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY)) return;
+		ImGui::TableSetupColumn("Script");
+		ImGui::TableSetupColumn("Errors", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableSetupColumn("Warnings", ImGuiTableColumnFlags_WidthFixed);
+		ImGui::TableHeadersRow();
+		for (const Entry& entry : m_entries)
+		{
+			const bool failed = entry.report.errors > 0 || entry.read_failed;
+			if (m_only_failed && !failed) continue;
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::PushID(entry.path.c_str());
+			if (ImGui::Selectable(entry.path.c_str(), false, ImGuiSelectableFlags_SpanAllColumns))
+			{
+				m_app.getAssetBrowser().openEditor(entry.path);
+			}
+			if (ImGui::IsItemHovered() && !entry.report.text.empty())
+			{
+				ImGui::SetTooltip("%s", entry.report.text.c_str());
+			}
+			ImGui::PopID();
+			ImGui::TableNextColumn();
+			if (entry.read_failed) ImGui::TextUnformatted("could not read");
+			else ImGui::Text("%d", entry.report.errors);
+			ImGui::TableNextColumn();
+			ImGui::Text("%d", entry.report.warnings);
+		}
+		ImGui::EndTable();
+	}
+
+	const char* getName() const override { return "angelscript_validation"; }
+
+	StudioApp& m_app;
+	ScriptValidator& m_validator;
+	Local<Action> m_action;
+	bool m_is_open = false;
+	bool m_only_failed = true;
+	Array<Entry> m_entries;
+	String m_bundle_path;
+	jobs::Counter m_counter;
+	AtomicI32 m_next = 0;
+	AtomicI32 m_finished = 0;
+	// set by the job once m_entries and m_duration are written
+	AtomicI32 m_done = 0;
+	bool m_running = false;
+	u64 m_start_time = 0;
+	u64 m_duration = 0;
+};
+
+struct AngelScriptAction
+{
+	void run()
 	{
 		if (!script_module || !script_context) return;
 
-		asIScriptFunction* run_func = script_module->GetFunctionByDecl("void run()");
+		// resolved on the first run
+		if (!run_func_resolved)
+		{
+			run_func = script_module->GetFunctionByDecl("void run()");
+			run_func_resolved = true;
+		}
 		if (run_func)
 		{
 			script_context->Prepare(run_func);
@@ -520,6 +1858,8 @@ struct AngelScriptAction
 	Local<Action> action;
 	asIScriptModule* script_module;
 	asIScriptContext* script_context;
+	asIScriptFunction* run_func = nullptr;
+	bool run_func_resolved = false;
 };
 
 struct StudioAppPlugin : StudioApp::IPlugin
@@ -529,6 +1869,8 @@ struct StudioAppPlugin : StudioApp::IPlugin
 		, m_asset_plugin(app)
 		, m_angelscript_actions(app.getAllocator())
 		, m_plugins(app.getAllocator())
+		, m_profiler_window(app)
+		, m_validation_window(app, m_asset_plugin.m_validator)
 	{
 		AngelScriptSystem* system = (AngelScriptSystem*)app.getEngine().getSystemManager().getSystem("angelscript");
 		asIScriptEngine* engine = system->getEngine();
@@ -539,12 +1881,20 @@ struct StudioAppPlugin : StudioApp::IPlugin
 		initPlugins();
 	}
 
-	void update(float) override
+	void update(float time_delta) override
 	{
 		for (AngelScriptAction* action : m_angelscript_actions)
 		{
 			if (m_app.checkShortcut(*action->action, true)) action->run();
 		}
+
+		m_plugin_reload_timer -= time_delta;
+		if (m_plugin_reload_timer > 0) return;
+		m_plugin_reload_timer = PLUGIN_RELOAD_CHECK_INTERVAL;
+		for (StudioAngelScriptPlugin* plugin : m_plugins)
+		{
+			plugin->reloadIfChanged();
+		}
 	}
 
 	void registerEditorAPI(asIScriptEngine* engine)
@@ -585,15 +1935,8 @@ struct StudioAppPlugin : StudioApp::IPlugin
 			if (info.is_directory) continue;
 			if (!Path::hasExtension(info.filename, "as")) continue;
 
-			OutputMemoryStream blob(m_app.getAllocator());
 			const Path path("editor/scripts/plugins/", info.filename);
-			if (!fs.getContentSync(path, blob)) continue;
-
-			StringView content;
-			content.begin = (const char*)blob.data();
-			content.end = content.begin + blob.size();
-			StudioAngelScriptPlugin* plugin = StudioAngelScriptPlugin::create(m_app, content, path);
-			if (plugin) m_plugins.push(plugin);
+			m_plugins.push(StudioAngelScriptPlugin::create(m_app, path));
 		}
 		os::destroyFileIterator(iter);
 	}
@@ -648,6 +1991,8 @@ struct StudioAppPlugin : StudioApp::IPlugin
 		m_app.getAssetCompiler().addPlugin(m_asset_plugin, Span(exts));
 		m_app.getAssetBrowser().addPlugin(m_asset_plugin, Span(exts));
 		m_app.getPropertyGrid().addPlugin(m_property_grid_plugin);
+		m_app.addPlugin(m_profiler_window);
+		m_app.addPlugin(m_validation_window);
 
 		checkScriptCommandLine();
 	}
@@ -691,10 +2036,12 @@ struct StudioAppPlugin : StudioApp::IPlugin
 		m_app.getAssetCompiler().removePlugin(m_asset_plugin);
 		m_app.getAssetBrowser().removePlugin(m_asset_plugin);
 		m_app.getPropertyGrid().removePlugin(m_property_grid_plugin);
+		m_app.removePlugin(m_profiler_window);
+		m_app.removePlugin(m_validation_window);
 
 		for (StudioAngelScriptPlugin* plugin : m_plugins)
 		{
-			m_app.removePlugin(*plugin);
+			if (plugin->m_is_added) m_app.removePlugin(*plugin);
 			LUMIX_DELETE(m_app.getAllocator(), plugin);
 		}
 
@@ -725,8 +2072,13 @@ struct StudioAppPlugin : StudioApp::IPlugin
 	StudioApp& m_app;
 	AssetPlugin m_asset_plugin;
 	PropertyGridPlugin m_property_grid_plugin;
+	ProfilerWindow m_profiler_window;
+	ValidationWindow m_validation_window;
 	Array<AngelScriptAction*> m_angelscript_actions;
 	Array<StudioAngelScriptPlugin*> m_plugins;
+	// seconds
+	static constexpr float PLUGIN_RELOAD_CHECK_INTERVAL = 1;
+	float m_plugin_reload_timer = PLUGIN_RELOAD_CHECK_INTERVAL;
 };
 
 } // anonymous namespace